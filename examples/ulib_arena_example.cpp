@@ -0,0 +1,61 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+#define IMPLEMENTATION
+#include "ulib_file_io.h"
+#include "ulib_vector.h"
+
+// Reads the files given as arguments, the memory of each batch is given back
+// with one rewind of the arena.
+int main(int argc, char** argv)
+{
+    ulib::ulib_arena arena;
+    ulib::ulib_arena_mark mark;
+    ulib::ulib__SizeType size = 0;
+    ulib::ulib__SizeType total = 0;
+    INIT_ULIB_ARENA(arena, ULIB_MEGABYTE);
+
+    for (int batch = 0; batch < 10; ++batch)
+    {
+        mark = ulib::UlibArenaMark(&arena);
+        for (int i = 1; i < argc; ++i)
+        {
+            ulib::ulib__uint8* contents =
+                ulib::_tReadEntireFileArena(argv[i], &size, &arena);
+            if (contents)
+            {
+                total += size;
+            }
+        }
+        ulib::UlibArenaRewind(&arena, mark);
+    }
+
+    // A vector with its buffers in the arena
+    ulib::ulib_vector vec;
+    INIT_ULIB_VECTOR_FIXED_ARENA(vec, ULIB_KILOBYTE, sizeof(int), &arena);
+    for (int i = 0; i < 10000; ++i)
+    {
+        ulib::UlibVectorPush(&vec, &i, 1u);
+    }
+    printf("Read: %zu bytes, arena peak: %zu bytes, vector elements: %zu\n",
+           total, arena.peakAllocated, ulib::UlibVectorCount(&vec));
+    ulib::UlibVectorFree(&vec);
+    ULIB_FREE(vec.bufferTable);
+    ulib::UlibArenaFree(&arena);
+    return (ULIB_SUCCESS);
+}
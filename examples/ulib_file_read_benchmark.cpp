@@ -0,0 +1,337 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/*
+ Reads many small files whole, the ways ulib_file_io.h has:
+   stdio  - fopen / fseek / ftell / malloc / fread / free, the reference
+   malloc - _tReadEntireFile and free
+   arena  - _tReadEntireFileArena, rewound after every file
+   buffer - _tReadEntireFileBuffer, one buffer for all the files
+   batch_uring - UlibReadFiles with io_uring, depth reads in flight
+   batch_pool  - UlibReadFiles with the worker pool, depth threads
+ Usage: ulib_file_read_benchmark [work dir] [files] [runs] [depth]
+ 100000 files of 4 KB by default, made once in the work dir (the temp dir
+ by default), 1000 per directory. The fastest of the runs after a warm up
+ is reported, as CSV. The files are in the page cache after the warm up, so
+ the batch modes show the cost of the reads more than the device speed.
+*/
+#define IMPLEMENTATION
+#include "ulib_file_io.h"
+#include "ulib_file_batch.h"
+#include "version.h"
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+static const ulib::ulib__uint32 filesPerDir = 1000u;
+static const ulib::ulib__SizeType fileBytes = 4096u;
+#ifdef _WIN32
+static const _TCHAR separator = _T('\\');
+#else
+static const _TCHAR separator = _T('/');
+#endif
+
+enum
+{
+    MODE_STDIO,
+    MODE_MALLOC,
+    MODE_ARENA,
+    MODE_BUFFER,
+    MODE_URING,
+    MODE_POOL,
+    MODE_COUNT
+};
+
+static const char* modeNames[MODE_COUNT] =
+{
+    "stdio", "malloc", "arena", "buffer", "batch_uring", "batch_pool"
+};
+
+static bool MakeDir(const _TCHAR* path)
+{
+#ifdef _WIN32
+    return (CreateDirectory(path, ULIB_NULL) || GetLastError() == ERROR_ALREADY_EXISTS);
+#else
+    return (mkdir(path, 0755) == 0 || errno == EEXIST);
+#endif
+}
+
+// Path of file n of the set in root
+static void FilePath(_TCHAR* path, const _TCHAR* root, const ulib::ulib__uint32 n)
+{
+    _stprintf(path, _T("%s%cd%u%cf%u"), root, separator, n / filesPerDir,
+              separator, n % filesPerDir);
+}
+
+// The files are made in root, a marker file next to it says they are complete
+static bool Generate(const _TCHAR* root, const ulib::ulib__uint32 count)
+{
+    static ulib::ulib__uint8 data[fileBytes];
+    _TCHAR path[4096];
+    FILE* file = ULIB_NULL;
+    _stprintf(path, _T("%s.done"), root);
+    _tfopen_s(&file, path, _TEXT("rb"));
+    if (file)
+    {
+        fclose(file);
+        return (true);
+    }
+    if (!MakeDir(root))
+    {
+        return (false);
+    }
+    for (ulib::ulib__uint32 n = 0; n < count; ++n)
+    {
+        if (n % filesPerDir == 0)
+        {
+            _stprintf(path, _T("%s%cd%u"), root, separator, n / filesPerDir);
+            if (!MakeDir(path))
+            {
+                return (false);
+            }
+        }
+        for (ulib::ulib__SizeType i = 0; i < fileBytes; ++i)
+        {
+            data[i] = (ulib::ulib__uint8)(n + i);
+        }
+        FilePath(path, root, n);
+        if (ulib::_tWriteEntireFile(path, data, fileBytes) != ULIB_SUCCESS)
+        {
+            return (false);
+        }
+    }
+    _stprintf(path, _T("%s.done"), root);
+    return (ulib::_tWriteEntireFile(path, data, 0) == ULIB_SUCCESS);
+}
+
+// _tReadEntireFile as it was, through stdio
+static ulib::ulib__uint8* ReadStdio(const _TCHAR* fileName, ulib::ulib__SizeType* fileSize)
+{
+    FILE* file = ULIB_NULL;
+    ulib::ulib__uint8* contents;
+    long size;
+    _tfopen_s(&file, fileName, _TEXT("rb"));
+    if (file == ULIB_NULL)
+    {
+        return (ULIB_NULL);
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents = size < 0 ? ULIB_NULL : (ulib::ulib__uint8*)malloc((ulib::ulib__SizeType)size + 1u);
+    if (contents == ULIB_NULL ||
+        fread(contents, 1u, (ulib::ulib__SizeType)size, file) != (ulib::ulib__SizeType)size)
+    {
+        fclose(file);
+        free(contents);
+        return (ULIB_NULL);
+    }
+    fclose(file);
+    contents[size] = 0;
+    *fileSize = (ulib::ulib__SizeType)size;
+    return (contents);
+}
+
+// Adds a file given by the batch to the checksum
+static ulib::ulib__bool SumFile(const ulib::ulib_batch_file* file, void* context)
+{
+    ulib::ulib__uint64* checksum = (ulib::ulib__uint64*)context;
+    if (file->status != ULIB_SUCCESS)
+    {
+        return (ULIB_FALSE);
+    }
+    *checksum += file->data[0] + file->data[file->size - 1u] + file->size;
+    return (ULIB_TRUE);
+}
+
+// Reads all the files with a batch of depth reads in flight
+static bool ReadBatch(const int mode, _TCHAR** names, const ulib::ulib__uint32 count,
+                      const ulib::ulib__uint32 depth, double* elapsed,
+                      ulib::ulib__uint64* checksum)
+{
+    ulib::ulib_file_batch batch;
+    ulib::ulib_batch_file file;
+    bool status = true;
+    *checksum = 0;
+    BEGIN_TIMED_BLOCK(read);
+    if (ulib::UlibFileBatchOpen(&batch, names, count, depth,
+                                mode == MODE_POOL ? ULIB_BATCH_NO_URING : 0) != ULIB_SUCCESS)
+    {
+        return (false);
+    }
+    if (mode == MODE_URING && batch.engine != ULIB_BATCH_URING)
+    {
+        ulib::UlibFileBatchClose(&batch);
+        return (false);
+    }
+    while (status && ulib::UlibFileBatchNext(&batch, &file))
+    {
+        status = SumFile(&file, checksum) == ULIB_TRUE;
+    }
+    ulib::UlibFileBatchClose(&batch);
+    END_TIMED_BLOCK(read, (*elapsed));
+    return (status && batch.status == ULIB_SUCCESS);
+}
+
+// Reads all the files once, the time is in seconds
+static bool ReadAll(const int mode, _TCHAR** names, const ulib::ulib__uint32 count,
+                    const ulib::ulib__uint32 depth, double* elapsed,
+                    ulib::ulib__uint64* checksum)
+{
+    _TCHAR* path;
+    ulib::ulib_arena arena;
+    ulib::ulib_arena_mark mark;
+    ulib::ulib_file_buffer buffer;
+    ulib::ulib__uint8* contents = ULIB_NULL;
+    ulib::ulib__SizeType size = 0;
+    bool status = true;
+    if (mode == MODE_URING || mode == MODE_POOL)
+    {
+        return (ReadBatch(mode, names, count, depth, elapsed, checksum));
+    }
+    INIT_ULIB_ARENA(arena, 64u * ULIB_KILOBYTE);
+    INIT_ULIB_FILE_BUFFER(buffer);
+    *checksum = 0;
+    BEGIN_TIMED_BLOCK(read);
+    for (ulib::ulib__uint32 n = 0; n < count && status; ++n)
+    {
+        path = names[n];
+        switch (mode)
+        {
+        case MODE_STDIO:
+            contents = ReadStdio(path, &size);
+            break;
+        case MODE_MALLOC:
+            contents = ulib::_tReadEntireFile(path, &size);
+            break;
+        case MODE_ARENA:
+            mark = ulib::UlibArenaMark(&arena);
+            contents = ulib::_tReadEntireFileArena(path, &size, &arena);
+            break;
+        default:
+            contents = ulib::_tReadEntireFileBuffer(path, &size, &buffer);
+            break;
+        }
+        if (contents == ULIB_NULL)
+        {
+            status = false;
+            continue;
+        }
+        *checksum += contents[0] + contents[size - 1u] + size;
+        if (mode == MODE_STDIO || mode == MODE_MALLOC)
+        {
+            free(contents);
+        }
+        else if (mode == MODE_ARENA)
+        {
+            ulib::UlibArenaRewind(&arena, mark);
+        }
+    }
+    END_TIMED_BLOCK(read, (*elapsed));
+    ulib::UlibArenaFree(&arena);
+    ulib::UlibFileBufferFree(&buffer);
+    return (status);
+}
+
+int main(int argc, char** argv)
+{
+    _TCHAR root[4000];
+    ulib::ulib__uint32 count = argc > 2 ? (ulib::ulib__uint32)atoi(argv[2]) : 100000u;
+    int runs = argc > 3 ? atoi(argv[3]) : 3;
+    ulib::ulib__uint32 depth = argc > 4 ? (ulib::ulib__uint32)atoi(argv[4]) : 64u;
+    _TCHAR** names;
+    ulib::ulib__uint64 checksum;
+    ulib::ulib__uint64 expected = 0;
+    double elapsed = 0.0;
+    double best;
+    if (runs < 1)
+    {
+        runs = 1;
+    }
+#ifdef _WIN32
+    _TCHAR temp[MAX_PATH];
+    if (argc > 1)
+    {
+        _stprintf(temp, _T("%hs"), argv[1]);
+    }
+    else
+    {
+        GetTempPath(MAX_PATH, temp);
+    }
+    _stprintf(root, _T("%sulib_read_bench_%u"), temp, count);
+#else
+    _stprintf(root, _T("%s/ulib_read_bench_%u"),
+              argc > 1 ? argv[1] : (getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp"), count);
+#endif
+    if (count == 0 || !Generate(root, count))
+    {
+        fprintf(stderr, "Can't make the files\n");
+        return (ULIB_ERROR);
+    }
+    // The paths are made once, the modes read the same list
+    names = (_TCHAR**)malloc(count * sizeof(_TCHAR*));
+    for (ulib::ulib__uint32 n = 0; n < count; ++n)
+    {
+        names[n] = (_TCHAR*)malloc((_tcslen(root) + 32u) * sizeof(_TCHAR));
+        FilePath(names[n], root, n);
+    }
+    printf("version,mode,files,file_bytes,depth,seconds,files_per_s,mb_per_s\n");
+    for (int mode = 0; mode < MODE_COUNT; ++mode)
+    {
+        // The warm up run
+        if (!ReadAll(mode, names, count, depth, &elapsed, &checksum))
+        {
+            if (mode == MODE_URING)
+            {
+                fprintf(stderr, "No io_uring here, batch_uring skipped\n");
+                continue;
+            }
+            fprintf(stderr, "Can't read the files\n");
+            return (ULIB_ERROR);
+        }
+        if (mode == 0)
+        {
+            expected = checksum;
+        }
+        best = elapsed;
+        for (int i = 0; i < runs; ++i)
+        {
+            ReadAll(mode, names, count, depth, &elapsed, &checksum);
+            if (i == 0 || elapsed < best)
+            {
+                best = elapsed;
+            }
+        }
+        if (checksum != expected)
+        {
+            fprintf(stderr, "%s read different contents\n", modeNames[mode]);
+            return (ULIB_ERROR);
+        }
+        printf("%s,%s,%u,%zu,%u,%.6f,%.0f,%.1f\n", ulib::ulib_version, modeNames[mode],
+               count, fileBytes, mode == MODE_URING || mode == MODE_POOL ? depth : 1u,
+               best, (double)count / best, (double)count * fileBytes / best / 1000000.0);
+    }
+    for (ulib::ulib__uint32 n = 0; n < count; ++n)
+    {
+        free(names[n]);
+    }
+    free(names);
+    return (ULIB_SUCCESS);
+}
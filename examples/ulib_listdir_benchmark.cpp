@@ -0,0 +1,439 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/*
+ ListDir on generated trees, in each of its modes.
+ Usage: ulib_listdir_benchmark [work dir] [scale %] [runs]
+ The trees are made once in the work dir (the temp dir by default) and kept
+ for the next runs, a tree is the same for the same scale. Each mode runs
+ after a warm up scan and the fastest of the runs is reported, so the
+ numbers are for a warm cache. A scan that doesn't list every entry of the
+ tree fails the mode.
+ The output is CSV, one line per tree and mode:
+   entries/s, system calls per entry made by the walk, peak resident
+   memory of the mode, and the dir stack allocations from ulib_vector
+   (0 with threads, where there is no dir stack).
+ On Linux the peak is reset before each mode through /proc/self/clear_refs,
+ where that is not allowed and on Windows it is the peak of the process.
+*/
+#define IMPLEMENTATION
+#include "ulib_listdir.h"
+#include "version.h"
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+// Room left in the path for one more directory and a file name in it
+#define NAMES_ROOM 32u
+
+// A start directory with dirs directories, nested or side by side, each
+// with files files of 0 to fileBytes - 1 bytes
+struct tree_spec
+{
+    const char*        name;        // In the output
+    const _TCHAR*      dirName;
+    ulib::ulib__uint32 dirs;
+    ulib::ulib__uint32 files;
+    ulib::ulib__bool   nested;
+    ulib::ulib__uint32 fileBytes;
+};
+
+static const tree_spec trees[] =
+{
+    { "wide",  _T("wide"),  1u,     100000u, ULIB_FALSE, 0u    },
+#ifdef _WIN32
+    // Without the \\?\ prefix paths stop at MAX_PATH
+    { "deep",  _T("deep"),  100u,   10u,     ULIB_TRUE,  0u    },
+#else
+    { "deep",  _T("deep"),  1000u,  10u,     ULIB_TRUE,  0u    },
+#endif
+    { "small", _T("small"), 200u,   100u,    ULIB_FALSE, 4096u },
+    { "large", _T("large"), 1000u,  1000u,   ULIB_FALSE, 0u    },
+};
+
+enum
+{
+    MODE_CALLBACKS,
+    MODE_BATCH,
+    MODE_METADATA,
+    MODE_PARALLEL,
+    MODE_ITERATOR,
+    MODE_USAGE,
+    MODE_COUNT
+};
+
+static const char* modeNames[MODE_COUNT] =
+{
+    "callbacks", "batch", "metadata", "parallel", "iterator", "usage"
+};
+
+static char fileData[4096];
+static ulib::ulib__uint64 checksum = 0;
+
+static void FileCallBack(_TCHAR* fullPath, _TCHAR* fileName)
+{
+    ULIB_UNUSED(fullPath);
+    checksum += (ulib::ulib__uint64)fileName[0];
+}
+
+static void EntriesCallBack(const ulib::ListDirEntry* entries,
+                            ulib::ulib__SizeType count, void* context)
+{
+    ULIB_UNUSED(context);
+    for (ulib::ulib__SizeType i = 0; i < count; ++i)
+    {
+        checksum += entries[i].nameLength + entries[i].size;
+    }
+}
+
+static bool MakeDir(const _TCHAR* path)
+{
+#ifdef _WIN32
+    return (CreateDirectory(path, ULIB_NULL) || GetLastError() == ERROR_ALREADY_EXISTS);
+#else
+    return (mkdir(path, 0755) == 0 || errno == EEXIST);
+#endif
+}
+
+static bool Exists(const _TCHAR* path)
+{
+    FILE* file = ULIB_NULL;
+    _tfopen_s(&file, path, _TEXT("rb"));
+    if (file == ULIB_NULL)
+    {
+        return (false);
+    }
+    fclose(file);
+    return (true);
+}
+
+static bool MakeFile(const _TCHAR* path, const ulib::ulib__SizeType size)
+{
+    FILE* file = ULIB_NULL;
+    bool result;
+    _tfopen_s(&file, path, _TEXT("wb"));
+    if (file == ULIB_NULL)
+    {
+        return (false);
+    }
+    result = fwrite(fileData, 1u, size, file) == size;
+    return (fclose(file) == 0 && result);
+}
+
+// The tree is made in path, of size chars, a marker file next to it says
+// it is complete. A nested tree too deep for path is not made.
+static bool Generate(const tree_spec* spec, _TCHAR* path, ulib::ulib__SizeType length,
+                     const ulib::ulib__SizeType size)
+{
+    _TCHAR marker[4096 + 8];
+    ulib::ulib__SizeType dirLength = length;
+    ulib::ulib__uint32 n = 0;
+    _stprintf(marker, _T("%s.done"), path);
+    if (Exists(marker))
+    {
+        return (true);
+    }
+    if (!MakeDir(path))
+    {
+        return (false);
+    }
+    for (ulib::ulib__uint32 d = 0; d < spec->dirs; ++d)
+    {
+        if (!spec->nested)
+        {
+            dirLength = length;
+        }
+        if (dirLength + NAMES_ROOM > size)
+        {
+            fprintf(stderr, "The %s tree is %u levels deep, %u fit in the path\n",
+                    spec->name, spec->dirs, d);
+            return (false);
+        }
+        // A short name for the nested ones, 2 chars per level
+        dirLength += spec->nested ?
+                     _stprintf(&path[dirLength], _T("%cd"), ULIB_DIR_SEPARATOR) :
+                     _stprintf(&path[dirLength], _T("%cd%u"), ULIB_DIR_SEPARATOR, d);
+        if (!MakeDir(path))
+        {
+            return (false);
+        }
+        for (ulib::ulib__uint32 f = 0; f < spec->files; ++f, ++n)
+        {
+            _stprintf(&path[dirLength], _T("%cf%u"), ULIB_DIR_SEPARATOR, f);
+            if (!MakeFile(path, spec->fileBytes ? (n * 37u) % spec->fileBytes : 0u))
+            {
+                return (false);
+            }
+        }
+        path[dirLength] = _T('\0');
+    }
+    path[length] = _T('\0');
+    return (MakeFile(marker, 0u));
+}
+
+static void PeakMemoryReset()
+{
+#ifndef _WIN32
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file)
+    {
+        // 5 resets the peak resident set size
+        fputs("5", file);
+        fclose(file);
+    }
+#endif
+}
+
+// Peak resident memory in KB
+static ulib::ulib__uint64 PeakMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == 0)
+    {
+        return (0);
+    }
+    return (counters.PeakWorkingSetSize / ULIB_KILOBYTE);
+#else
+    char line[256];
+    unsigned long long peak = 0;
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file == ULIB_NULL)
+    {
+        return (0);
+    }
+    while (fgets(line, sizeof(line), file))
+    {
+        if (sscanf(line, "VmHWM: %llu", &peak) == 1)
+        {
+            break;
+        }
+    }
+    fclose(file);
+    return (peak);
+#endif
+}
+
+// One scan in the mode, the time is in seconds
+static ulib::ulib__uint8 Scan(const int mode, _TCHAR* dir, ulib::ListDirData* listDirData,
+                              double* elapsed)
+{
+    ulib::ListDirIterator it;
+    ulib::ListDirUsage usage;
+    const ulib::ListDirEntry* entries;
+    ulib::ulib__SizeType count;
+    ulib::ulib__uint8 status;
+    INIT_LISTDIRDATA((*listDirData));
+    INIT_LISTDIRUSAGE(usage);
+    listDirData->dir = dir;
+    listDirData->recurse = ULIB_TRUE;
+    switch (mode)
+    {
+    case MODE_CALLBACKS:
+        listDirData->processFile = FileCallBack;
+        listDirData->processDirectory = FileCallBack;
+        break;
+    case MODE_METADATA:
+        listDirData->entryMetadata = ULIB_TRUE;
+        listDirData->processEntries = EntriesCallBack;
+        break;
+    case MODE_PARALLEL:
+        // At least 2, so the parallel walk runs on one processor too
+        listDirData->threads = ulib::UlibCpuCount() > 1u ? ulib::UlibCpuCount() : 2u;
+        listDirData->processEntries = EntriesCallBack;
+        break;
+    case MODE_USAGE:
+        usage.topCount = 10u;
+        listDirData->usage = &usage;
+        break;
+    default:
+        listDirData->processEntries = EntriesCallBack;
+        break;
+    }
+    BEGIN_TIMED_BLOCK(scan);
+    if (mode == MODE_ITERATOR)
+    {
+        status = ulib::ListDirOpen(&it, listDirData, ULIB_NULL);
+        if (status == ULIB_SUCCESS)
+        {
+            while ((count = ulib::ListDirNextBatch(&it, &entries)) != 0)
+            {
+                EntriesCallBack(entries, count, ULIB_NULL);
+            }
+            ulib::ListDirClose(&it);
+            status = it.status;
+        }
+    }
+    else
+    {
+        status = ulib::ListDir(listDirData);
+    }
+    END_TIMED_BLOCK(scan, (*elapsed));
+    ulib::ListDirUsageFree(&usage);
+    return (status);
+}
+
+// One scan in the mode, the walk must have listed the whole tree
+static bool ScanAll(const tree_spec* spec, const int mode, _TCHAR* dir,
+                    ulib::ListDirData* listDirData, double* elapsed)
+{
+    // The start directory is not listed
+    ulib::ulib__uint64 expected = (ulib::ulib__uint64)spec->dirs * (1u + spec->files);
+    ulib::ulib__uint64 entries;
+    if (Scan(mode, dir, listDirData, elapsed) != ULIB_SUCCESS)
+    {
+        return (false);
+    }
+    entries = listDirData->totalFiles + listDirData->totalDirs;
+    if (entries != expected)
+    {
+        fprintf(stderr, "The %s mode listed %llu entries of %llu\n",
+                modeNames[mode], (unsigned long long)entries, (unsigned long long)expected);
+        return (false);
+    }
+    return (true);
+}
+
+static bool Run(const tree_spec* spec, const int mode, _TCHAR* dir, const int runs)
+{
+    ulib::ListDirData listDirData;
+    double best = 0.0;
+    double elapsed = 0.0;
+    ulib::ulib__uint64 entries;
+    PeakMemoryReset();
+    // The warm up scan
+    if (!ScanAll(spec, mode, dir, &listDirData, &elapsed))
+    {
+        return (false);
+    }
+    for (int i = 0; i < runs; ++i)
+    {
+        if (!ScanAll(spec, mode, dir, &listDirData, &elapsed))
+        {
+            return (false);
+        }
+        if (i == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    entries = listDirData.totalFiles + listDirData.totalDirs;
+    printf("%s,%s,%s,%u,%llu,%.6f,%.0f,%.3f,%llu",
+             ulib::ulib_version, spec->name, modeNames[mode],
+             listDirData.threads > 1u ? listDirData.threads : 1u,
+             entries, best, best > 0.0 ? (double)entries / best : 0.0,
+             entries ? (double)listDirData.systemCalls / (double)entries : 0.0,
+             PeakMemory());
+#ifndef ULIB_VECTOR_NO_STATS
+    printf(",%zu,%zu,%zu\n", listDirData.vectorStats.allocations,
+             listDirData.vectorStats.peakBuffers,
+             listDirData.vectorStats.peakReservedBytes);
+#else
+    printf(",0,0,0\n");
+#endif
+    return (true);
+}
+
+int main(int argc, char** argv)
+{
+    _TCHAR path[4096];
+    ulib::ulib__SizeType length;
+    unsigned scale = argc > 2 ? (unsigned)atoi(argv[2]) : 100u;
+    int runs = argc > 3 ? atoi(argv[3]) : 3;
+    tree_spec spec;
+    for (ulib::ulib__SizeType i = 0; i < sizeof(fileData); ++i)
+    {
+        fileData[i] = (char)('a' + i % 26u);
+    }
+    if (runs < 1)
+    {
+        runs = 1;
+    }
+#ifdef _WIN32
+    if (argc > 1)
+    {
+        if (strlen(argv[1]) + 64u > sizeof(path) / sizeof(path[0]))
+        {
+            fprintf(stderr, "The work dir path is too long\n");
+            return (ULIB_ERROR);
+        }
+        _stprintf(path, _T("%hs"), argv[1]);
+    }
+    else
+    {
+        GetTempPath(MAX_PATH, path);
+    }
+#else
+    if (argc > 1 || getenv("TMPDIR"))
+    {
+        const char* dir = argc > 1 ? argv[1] : getenv("TMPDIR");
+        if (strlen(dir) + 64u > sizeof(path) / sizeof(path[0]))
+        {
+            fprintf(stderr, "The work dir path is too long\n");
+            return (ULIB_ERROR);
+        }
+        _stprintf(path, _T("%s"), dir);
+    }
+    else
+    {
+        _stprintf(path, _T("/tmp"));
+    }
+#endif
+    length = _tcslen(path);
+    while (length && ULIB_IS_DIR_SEPARATOR(path[length - 1u]))
+    {
+        path[--length] = _T('\0');
+    }
+    printf("version,tree,mode,threads,entries,seconds,entries_per_s,"
+           "syscalls_per_entry,peak_rss_kb,allocations,peak_buffers,peak_bytes\n");
+    for (ulib::ulib__SizeType t = 0; t < sizeof(trees) / sizeof(trees[0]); ++t)
+    {
+        // The bigger of the two counts is scaled
+        spec = trees[t];
+        if (spec.dirs >= spec.files)
+        {
+            spec.dirs = spec.dirs * scale / 100u ? spec.dirs * scale / 100u : 1u;
+        }
+        else
+        {
+            spec.files = spec.files * scale / 100u ? spec.files * scale / 100u : 1u;
+        }
+        ulib::ulib__SizeType treeLength = length +
+            _stprintf(&path[length], _T("%culib_bench_%s_%ux%u"), ULIB_DIR_SEPARATOR,
+                      spec.dirName, spec.dirs, spec.files);
+        if (!Generate(&spec, path, treeLength, sizeof(path) / sizeof(path[0])))
+        {
+            fprintf(stderr, "Can't make the %s tree\n", spec.name);
+            return (ULIB_ERROR);
+        }
+        for (int mode = 0; mode < MODE_COUNT; ++mode)
+        {
+            if (!Run(&spec, mode, path, runs))
+            {
+                fprintf(stderr, "Can't scan the %s tree\n", spec.name);
+                return (ULIB_ERROR);
+            }
+        }
+        path[length] = _T('\0');
+    }
+    return (checksum ? ULIB_SUCCESS : ULIB_ERROR);
+}
@@ -0,0 +1,54 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+#define IMPLEMENTATION
+#include "ulib_listdir_snapshot.h"
+
+static void DeltaCallBack(ulib::ulib__uint8 change, const _TCHAR* fullPath,
+                          const ulib::ListDirEntry* entry, void* context)
+{
+    static const _TCHAR* changes[] = { _T("+"), _T("-"), _T("*") };
+    ULIB_UNUSED(entry);
+    ULIB_UNUSED(context);
+    _tprintf(_T("%s %s\r\n"), changes[change], fullPath);
+}
+
+// Prints what changed in the directory since the last run. The first run
+// prints everything.
+int main(int, char**)
+{
+    ulib::ListDirDeltaData deltaData;
+    INIT_LISTDIRDELTADATA(deltaData);
+    deltaData.processDelta = DeltaCallBack;
+#ifdef _WIN32
+    deltaData.dir = (_TCHAR*)_T("c:\\Users");
+    deltaData.snapshotFile = (_TCHAR*)_T("users.snapshot");
+#else
+    deltaData.dir = (_TCHAR*)_T("/home");
+    deltaData.snapshotFile = (_TCHAR*)_T("home.snapshot");
+#endif
+    if (ulib::ListDirDelta(&deltaData) != ULIB_SUCCESS)
+    {
+        return (ULIB_ERROR);
+    }
+    _tprintf(_T("Directories read: %llu, unchanged: %llu\r\n"),
+             deltaData.dirsRead, deltaData.dirsReused);
+    _tprintf(_T("Added: %llu, removed: %llu, modified: %llu\r\n"),
+             deltaData.added, deltaData.removed, deltaData.modified);
+    return (ULIB_SUCCESS);
+}
@@ -0,0 +1,77 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+#define IMPLEMENTATION
+#include "ulib_listdir_index.h"
+
+static ulib::ulib__bool MatchCallBack(const _TCHAR* fullPath, ulib::ulib__uint32 entry,
+                                      ulib::ulib__uint8 type, void* context)
+{
+    ULIB_UNUSED(entry);
+    ULIB_UNUSED(type);
+    ULIB_UNUSED(context);
+    _tprintf(_T("%s\r\n"), fullPath);
+    return (ULIB_TRUE);
+}
+
+// Indexes the directory on the first run, then prints the names matching
+// the pattern given on the command line, optionally under a directory:
+//   ulib_listdir_index_example "*.h" [dir]
+int main(int argc, char** argv)
+{
+    ulib::ListDirIndex index;
+#ifdef _WIN32
+    const _TCHAR* dir = _T("c:\\Users");
+    const _TCHAR* indexFile = _T("users.index");
+#else
+    const _TCHAR* dir = _T("/home");
+    const _TCHAR* indexFile = _T("home.index");
+#endif
+    if (argc < 2)
+    {
+        return (ULIB_ERROR);
+    }
+    if (ulib::ListDirIndexOpen(&index, indexFile) != ULIB_SUCCESS)
+    {
+        ulib::ListDirIndexBuilder builder;
+        ulib::ListDirData listDirData;
+        ulib::ulib__uint8 result;
+        INIT_LISTDIRDATA(listDirData);
+        listDirData.dir = (_TCHAR*)dir;
+        listDirData.recurse = ULIB_TRUE;
+        listDirData.processEntries = ulib::ListDirIndexAdd;
+        listDirData.entriesContext = &builder;
+        ulib::ListDirIndexBuilderInit(&builder);
+        result = ulib::ListDir(&listDirData);
+        if (result == ULIB_SUCCESS)
+        {
+            result = ulib::ListDirIndexWrite(&builder, dir, indexFile);
+        }
+        ulib::ListDirIndexBuilderFree(&builder);
+        if (result != ULIB_SUCCESS ||
+            ulib::ListDirIndexOpen(&index, indexFile) != ULIB_SUCCESS)
+        {
+            return (ULIB_ERROR);
+        }
+    }
+    _tprintf(_T("%llu matches\r\n"),
+             ulib::ListDirIndexFind(&index, argc > 2 ? argv[2] : ULIB_NULL, argv[1],
+                                    MatchCallBack, ULIB_NULL));
+    ulib::ListDirIndexClose(&index);
+    return (ULIB_SUCCESS);
+}
@@ -0,0 +1,84 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+#define IMPLEMENTATION
+#include "ulib_listdir.h"
+
+static void UsageCallBack(const _TCHAR* fullPath, const ulib::ListDirTotals* totals,
+                          ulib::ulib__uint32 depth, void* context)
+{
+    ULIB_UNUSED(context);
+    // The first two levels, as du --max-depth=2
+    if (depth <= 2u)
+    {
+        _tprintf(_T("%12llu %s\r\n"), totals->bytes, fullPath);
+    }
+}
+
+// Disk usage of the directory, walked with a thread per processor, and
+// its largest directories and files. Bind mounts and hard links are
+// counted once.
+int main(int, char**)
+{
+    ulib::ListDirData listDirData;
+    ulib::ListDirUsage usage;
+    ulib::ulib_visited visited;
+    ulib::ulib__uint8 result;
+    ulib::ulib__uint32 i;
+    INIT_LISTDIRDATA(listDirData);
+    INIT_LISTDIRUSAGE(usage);
+    usage.topCount = 10u;
+    usage.processUsage = UsageCallBack;
+#ifdef _WIN32
+    listDirData.dir = (_TCHAR*)_T("c:\\Users");
+#else
+    listDirData.dir = (_TCHAR*)_T("/usr");
+#endif
+    listDirData.recurse = ULIB_TRUE;
+    listDirData.threads = ulib::UlibCpuCount();
+    listDirData.usage = &usage;
+    if (ulib::UlibVisitedInit(&visited, 0) != ULIB_SUCCESS)
+    {
+        return (ULIB_ERROR);
+    }
+    listDirData.visited = &visited;
+    listDirData.visitFiles = ULIB_TRUE;
+    result = ulib::ListDir(&listDirData);
+    ulib::UlibVisitedFree(&visited);
+    if (result != ULIB_SUCCESS)
+    {
+        ulib::ListDirUsageFree(&usage);
+        return (ULIB_ERROR);
+    }
+    _tprintf(_T("Total: %llu bytes, %llu files, %llu directories\r\n"),
+             usage.total.bytes, usage.total.files, usage.total.dirs);
+    _tprintf(_T("Largest directories:\r\n"));
+    for (i = 0; i < usage.largestDirs.count; ++i)
+    {
+        _tprintf(_T("%12llu %s\r\n"), usage.largestDirs.items[i].totals.bytes,
+                 usage.largestDirs.items[i].path);
+    }
+    _tprintf(_T("Largest files:\r\n"));
+    for (i = 0; i < usage.largestFiles.count; ++i)
+    {
+        _tprintf(_T("%12llu %s\r\n"), usage.largestFiles.items[i].totals.bytes,
+                 usage.largestFiles.items[i].path);
+    }
+    ulib::ListDirUsageFree(&usage);
+    return (ULIB_SUCCESS);
+}
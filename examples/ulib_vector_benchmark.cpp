@@ -0,0 +1,86 @@
+/*
+
+Copyright (c) 2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/*
+ Compares the variable length and the fixed stride mode of ulib_vector
+ for 8 byte elements: memory used per element and push / pop throughput.
+*/
+#define IMPLEMENTATION
+#include "ulib_vector.h"
+
+static const ulib::ulib__uint64 elementCount = 10000000u;
+static const ulib::ulib__SizeType bufferSize = 64u * ULIB_KILOBYTE;
+
+static double Push(ulib::ulib_vector* vec)
+{
+    double elapsed = 0.0;
+    BEGIN_TIMED_BLOCK(push);
+    for (ulib::ulib__uint64 i = 0; i < elementCount; ++i)
+    {
+        ulib::UlibVectorPush(vec, &i, 1u);
+    }
+    END_TIMED_BLOCK(push, elapsed);
+    return (elapsed);
+}
+
+static double Pop(ulib::ulib_vector* vec)
+{
+    double elapsed = 0.0;
+    ulib::ulib__uint64 value = 0;
+    ulib::ulib__uint64 sum = 0;
+    BEGIN_TIMED_BLOCK(pop);
+    while (ulib::UlibVectorPop(vec, &value) == ULIB_SUCCESS)
+    {
+        sum += value;
+    }
+    END_TIMED_BLOCK(pop, elapsed);
+    if (sum != elementCount * (elementCount - 1u) / 2u)
+    {
+        printf("Wrong sum of popped values\n");
+    }
+    return (elapsed);
+}
+
+static void Run(const char* name, ulib::ulib_vector* vec)
+{
+    ulib::ulib_vector_stats stats;
+    double pushTime = Push(vec);
+    ulib::UlibVectorGetStats(vec, &stats);
+    double popTime = Pop(vec);
+    printf("%-10s bytes/element: %5.2f  buffers: %6zu  "
+           "push: %7.2f Melem/s  pop: %7.2f Melem/s\n",
+           name,
+           (double)stats.usedBytes / (double)elementCount,
+           stats.liveBuffers,
+           (double)elementCount / pushTime / 1000000.0,
+           (double)elementCount / popTime / 1000000.0);
+}
+
+int main(int, char**)
+{
+    ulib::ulib_vector variable;
+    ulib::ulib_vector fixed;
+    INIT_ULIB_VECTOR(variable, bufferSize, sizeof(ulib::ulib__uint64));
+    INIT_ULIB_VECTOR_FIXED(fixed, bufferSize, sizeof(ulib::ulib__uint64));
+    printf("Elements: %llu of %zu bytes, buffer size: %zu bytes\n",
+           elementCount, sizeof(ulib::ulib__uint64), bufferSize);
+    Run("variable", &variable);
+    Run("fixed", &fixed);
+    return (ULIB_SUCCESS);
+}
@@ -0,0 +1,69 @@
+/*
+
+Copyright (c) 2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+#define IMPLEMENTATION
+#include "ulib_vector.hpp"
+#include <memory>
+#include <string>
+
+struct Data
+{
+    Data() : firstEntry(0), secondEntry(0.0f), thirdEntry(0) {}
+    Data(int f, float s, short t) : firstEntry(f), secondEntry(s), thirdEntry(t) {}
+    int firstEntry;
+    float secondEntry;
+    short thirdEntry;
+};
+
+int main(int, char**)
+{
+    // Elements are constructed in place, no copy in
+    ulib::Vector<Data> vec;
+    float f = 15.0f;
+    short s = 10;
+    for (int i = 0; i < 10; ++i, --s)
+    {
+        f += 0.10f;
+        vec.emplace(i, f, s);
+    }
+    for (ulib::Vector<Data>::iterator it = vec.begin(); it != vec.end(); ++it)
+    {
+        printf("peek data.firstEntry: %d\n", it->firstEntry);
+    }
+    Data data;
+    while (vec.pop(data) == ULIB_SUCCESS)
+    {
+        printf("data.firstEntry: %d\n", data.firstEntry);
+        printf("data.secondEntry: %f\n", data.secondEntry);
+        printf("data.thirdEntry: %d\n", data.thirdEntry);
+    }
+
+    // Move-only and non trivial types are moved in and out
+    ulib::Vector<std::unique_ptr<std::string> > strings(4u);
+    for (int i = 0; i < 10; ++i)
+    {
+        strings.push(std::unique_ptr<std::string>(new std::string(std::to_string(i))));
+    }
+    std::unique_ptr<std::string> str;
+    while (strings.pop(str) == ULIB_SUCCESS)
+    {
+        printf("string: %s\n", str->c_str());
+    }
+    return (ULIB_SUCCESS);
+}
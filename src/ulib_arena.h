@@ -0,0 +1,268 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  Region (arena) allocator
+*  Allocations bump a pointer in a block, the memory is given back all at once
+*  with UlibArenaReset() or down to a mark with UlibArenaRewind().
+*  Example:
+*   ulib_arena arena;
+*   INIT_ULIB_ARENA(arena, ULIB_MEGABYTE);
+*   for (...){
+*       ulib_arena_mark mark = UlibArenaMark(&arena);
+*       data = _tReadEntireFileArena(name, &size, &arena);
+*       Process(data, size);
+*       UlibArenaRewind(&arena, mark);
+*   }
+*   UlibArenaFree(&arena);
+* NOTES:
+*   1. Blocks are blockSize bytes, a larger allocation gets a block of its own.
+*   2. Allocations are aligned to ULIB_ARENA_ALIGNMENT bytes.
+*   3. UlibArenaReset() keeps the first block for reuse, UlibArenaFree()
+*      frees all the blocks.
+*   4. UlibScratchArena() returns an arena private to the calling thread.
+*      Call UlibScratchArenaRelease() before the thread exits.
+*   5. An arena is not thread safe, use one per thread.
+*   6. In case of an error, the error code is stored in ulibError global variable
+***********************************************************************************/
+#ifndef _ulib_arena_h_
+#define _ulib_arena_h_
+
+#include "ulib_common.h"
+
+#ifdef __cplusplus
+namespace ulib{
+#endif
+
+#define ULIB_ARENA_ALIGNMENT 16u
+
+// Block size of the per thread scratch arena
+#ifndef ULIB_SCRATCH_ARENA_SIZE
+#define ULIB_SCRATCH_ARENA_SIZE ULIB_MEGABYTE
+#endif
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+    typedef struct ulib_arena_block_ {
+        struct ulib_arena_block_* previousBlock;
+        ulib__SizeType            size;  // Bytes available after the header
+        ulib__SizeType            used;
+    }ulib_arena_block;
+
+    typedef struct ulib_arena_ {
+        ulib_arena_block*  block;        // Current block, ULIB_NULL if none
+        ulib__SizeType     blockSize;    // Size of a new block
+        ulib__SizeType     allocated;    // Bytes held in blocks
+        ulib__SizeType     peakAllocated;
+    }ulib_arena;
+
+    // Position in an arena, see UlibArenaMark()
+    typedef struct ulib_arena_mark_ {
+        ulib_arena_block*  block;
+        ulib__SizeType     used;
+    }ulib_arena_mark;
+
+#define INIT_ULIB_ARENA(arena, BlockSize)\
+    arena.block = ULIB_NULL;\
+    arena.blockSize = BlockSize;\
+    arena.allocated = 0u;\
+    arena.peakAllocated = 0u;
+
+/* Public functions */
+/******************************************************************************
+* Function:
+*          void* UlibArenaAlloc(IN ulib_arena* a,
+*                               IN const ulib__SizeType size);
+* Allocates size bytes from the arena, aligned to ULIB_ARENA_ALIGNMENT.
+* The memory is not initialized.
+* Parameters:
+*      Input:  ulib_arena* a
+*              const ulib__SizeType size
+*      Return: pointer to the memory
+*              ULIB_NULL if a new block could not be allocated, or size
+*              is too big to fit in one
+******************************************************************************/
+    void* UlibArenaAlloc(IN ulib_arena* a,
+                         IN const ulib__SizeType size);
+
+/******************************************************************************
+* Function:
+*          ulib_arena_mark UlibArenaMark(IN ulib_arena* a);
+* Returns the current position of the arena, for UlibArenaRewind()
+* Parameters:
+*      Input:  ulib_arena* a
+*      Return: ulib_arena_mark
+******************************************************************************/
+    ulib_arena_mark UlibArenaMark(IN ulib_arena* a);
+
+/******************************************************************************
+* Function:
+*          void UlibArenaRewind(IN ulib_arena* a,
+*                               IN const ulib_arena_mark mark);
+* Gives back everything allocated after mark was taken. Blocks allocated
+* after the mark are freed.
+* Parameters:
+*      Input:  ulib_arena* a
+*              const ulib_arena_mark mark
+*      Return: none
+******************************************************************************/
+    void UlibArenaRewind(IN ulib_arena* a,
+                         IN const ulib_arena_mark mark);
+
+/******************************************************************************
+* Function:
+*          void UlibArenaReset(IN ulib_arena* a);
+* Gives back all the allocations, the first block is kept for reuse
+* Parameters:
+*      Input:  ulib_arena* a
+*      Return: none
+******************************************************************************/
+    void UlibArenaReset(IN ulib_arena* a);
+
+/******************************************************************************
+* Function:
+*          void UlibArenaFree(IN ulib_arena* a);
+* Frees all the blocks of the arena. The arena can be used again after.
+* Parameters:
+*      Input:  ulib_arena* a
+*      Return: none
+******************************************************************************/
+    void UlibArenaFree(IN ulib_arena* a);
+
+/******************************************************************************
+* Function:
+*          ulib_arena* UlibScratchArena(void);
+* Returns the scratch arena of the calling thread, with blocks of
+* ULIB_SCRATCH_ARENA_SIZE bytes. Use a mark / rewind pair around its uses,
+* since other code on the same thread may use it too.
+* Parameters:
+*      Return: ulib_arena*
+******************************************************************************/
+    ulib_arena* UlibScratchArena(void);
+
+/******************************************************************************
+* Function:
+*          void UlibScratchArenaRelease(void);
+* Frees the scratch arena of the calling thread
+* Parameters:
+*      Return: none
+******************************************************************************/
+    void UlibScratchArenaRelease(void);
+#ifdef __cplusplus
+} // extern "C" {
+#endif
+
+/* ========================================================================= */
+#ifdef IMPLEMENTATION
+// Size of the block header, rounded so the data following it is aligned
+#define ULIB_ARENA_HEADER_SIZE ((sizeof(ulib_arena_block) + ULIB_ARENA_ALIGNMENT - 1u) &\
+                                ~(ulib__SizeType)(ULIB_ARENA_ALIGNMENT - 1u))
+
+static ULIB_THREAD_LOCAL ulib_arena scratchArena;
+static ULIB_THREAD_LOCAL ulib__bool scratchArenaInit = ULIB_FALSE;
+
+static void ArenaFreeBlock(ulib_arena* a){
+    ulib_arena_block* block = a->block;
+    a->block = block->previousBlock;
+    a->allocated -= block->size;
+    free(block);
+}
+
+void* UlibArenaAlloc(ulib_arena* a, const ulib__SizeType size){
+    ulib_arena_block* block = a->block;
+    ulib__SizeType aligned;
+    void* p;
+    // The rounding and the block header must not wrap around
+    if (size > (ulib__SizeType)-1 - ULIB_ARENA_HEADER_SIZE - ULIB_ARENA_ALIGNMENT){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_NULL);
+    }
+    aligned = (size + ULIB_ARENA_ALIGNMENT - 1u) & ~(ulib__SizeType)(ULIB_ARENA_ALIGNMENT - 1u);
+    if (block == ULIB_NULL || block->size - block->used < aligned){
+        ulib__SizeType blockSize = aligned > a->blockSize ? aligned : a->blockSize;
+        block = blockSize > (ulib__SizeType)-1 - ULIB_ARENA_HEADER_SIZE ? ULIB_NULL :
+                (ulib_arena_block*)malloc(ULIB_ARENA_HEADER_SIZE + blockSize);
+        if (block == ULIB_NULL){
+            ulibError = ULIB_MALLOC_ERROR;
+            return (ULIB_NULL);
+        }
+        block->previousBlock = a->block;
+        block->size = blockSize;
+        block->used = 0;
+        a->block = block;
+        a->allocated += blockSize;
+        if (a->allocated > a->peakAllocated){
+            a->peakAllocated = a->allocated;
+        }
+    }
+    p = (ulib__uint8*)block + ULIB_ARENA_HEADER_SIZE + block->used;
+    block->used += aligned;
+    return (p);
+}
+
+ulib_arena_mark UlibArenaMark(ulib_arena* a){
+    ulib_arena_mark mark;
+    mark.block = a->block;
+    mark.used = a->block ? a->block->used : 0u;
+    return (mark);
+}
+
+void UlibArenaRewind(ulib_arena* a, const ulib_arena_mark mark){
+    while (a->block && a->block != mark.block){
+        ArenaFreeBlock(a);
+    }
+    if (a->block){
+        a->block->used = mark.used;
+    }
+}
+
+void UlibArenaReset(ulib_arena* a){
+    while (a->block && a->block->previousBlock){
+        ArenaFreeBlock(a);
+    }
+    if (a->block){
+        a->block->used = 0;
+    }
+}
+
+void UlibArenaFree(ulib_arena* a){
+    while (a->block){
+        ArenaFreeBlock(a);
+    }
+}
+
+ulib_arena* UlibScratchArena(void){
+    if (scratchArenaInit == ULIB_FALSE){
+        INIT_ULIB_ARENA(scratchArena, ULIB_SCRATCH_ARENA_SIZE);
+        scratchArenaInit = ULIB_TRUE;
+    }
+    return (&scratchArena);
+}
+
+void UlibScratchArenaRelease(void){
+    if (scratchArenaInit){
+        UlibArenaFree(&scratchArena);
+    }
+}
+#endif // #ifdef IMPLEMENTATION
+#ifdef __cplusplus // namespace ulib{
+}
+#endif
+#endif // #ifndef _ulib_arena_h_
@@ -0,0 +1,751 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  Batch file reads
+*  UlibFileBatchOpen() takes a list of files and reads several of them at a
+*  time, depth reads are in flight. UlibFileBatchNext() gives the files
+*  whole, with a 0 after them as _tReadEntireFile() does, in the order their
+*  reads complete. UlibReadFiles() does the same with a callback.
+*  Two engines read the files:
+*   io_uring - Linux 5.6 or newer. The opens and reads of all the files in
+*              flight are submitted with one system call, the kernel runs
+*              them in parallel. Used when the kernel has it.
+*   pool     - worker threads, each reading one file at a time with the
+*              _tReadEntireFileBuffer() loader. Used on Windows, on older
+*              kernels and where io_uring is not allowed.
+*  Example:
+*   ulib_file_batch batch;
+*   ulib_batch_file file;
+*   if (UlibFileBatchOpen(&batch, fileNames, count, 64u, 0) == ULIB_SUCCESS){
+*       while (UlibFileBatchNext(&batch, &file))
+*           if (file.status == ULIB_SUCCESS) Process(file.data, file.size);
+*       UlibFileBatchClose(&batch);
+*   }
+* NOTES:
+*   1. Each file in flight has its own buffer, reused from file to file, so
+*      the memory used is depth times the biggest file read.
+*   2. file.data is valid until the next UlibFileBatchNext() call.
+*   3. The file names must stay valid until UlibFileBatchClose(), the
+*      reads use them.
+*   4. On Linux, link with -pthread. Define ULIB_NO_IO_URING to build
+*      without io_uring.
+*   5. In case of an error, the error code is stored in ulibError.
+***********************************************************************************/
+#ifndef _ulib_file_batch_h_
+#define _ulib_file_batch_h_
+
+#include "ulib_file_io.h"
+#include "ulib_thread.h"
+#if !defined(_WIN32) && !defined(ULIB_NO_IO_URING)
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// OPENAT and READ came with Linux 5.6, as did this feature flag
+#ifdef IORING_FEAT_RW_CUR_POS
+#define ULIB_IO_URING
+#endif
+#endif
+#endif
+#endif
+
+// Engine of a batch, ulib_file_batch.engine
+#define ULIB_BATCH_URING     0u  // io_uring
+#define ULIB_BATCH_POOL      1u  // Worker threads
+
+// Flags of UlibFileBatchOpen()
+#define ULIB_BATCH_NO_URING  0x01u  // The worker pool also where io_uring works
+
+// Reads in flight when none is given
+#ifndef ULIB_BATCH_DEPTH
+#define ULIB_BATCH_DEPTH     32u
+#endif
+// Worker threads of the pool at most, whatever the depth
+#ifndef ULIB_BATCH_THREADS
+#define ULIB_BATCH_THREADS   64u
+#endif
+#define ULIB_BATCH_MAX_DEPTH 4096u
+
+#ifdef __cplusplus
+namespace ulib{
+#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
+    struct batch_state_;
+
+    // A file read by the batch
+    typedef struct ulib_batch_file_
+    {
+        const _TCHAR*        fileName;
+        ulib__SizeType       index;      // In the list of files
+        const ulib__uint8*   data;       // The contents and a 0, ULIB_NULL if not read
+        ulib__SizeType       size;       // Bytes in the file
+        ulib__uint8          status;     // ULIB_SUCCESS, ULIB_FILE_NOT_FOUND, ULIB_MALLOC_ERROR, ULIB_ERROR
+    }ulib_batch_file;
+
+    typedef struct ulib_file_batch_
+    {
+        const _TCHAR* const* fileNames;
+        ulib__SizeType       count;
+        ulib__SizeType       given;      // Files given by UlibFileBatchNext()
+        ulib__SizeType       failed;     // Of them, the ones not read
+        ulib__uint64         bytes;      // Read
+        ulib__uint32         depth;      // Reads in flight
+        ulib__uint8          engine;     // ULIB_BATCH_URING or ULIB_BATCH_POOL
+        ulib__uint8          status;     // ULIB_ERROR if io_uring failed in the middle of the batch
+        struct batch_state_* state;
+    }ulib_file_batch;
+
+    //
+    // Called by UlibReadFiles() for every file, on the calling thread.
+    // file->data is valid during the call.
+    // Return ULIB_FALSE to stop reading.
+    //
+    typedef ulib__bool (*ProcessBatchFile)(const ulib_batch_file* file,
+                                           void* context);
+
+/******************************************************************************
+* Function:
+*           ulib__uint8 UlibFileBatchOpen(OUT ulib_file_batch* batch,
+*                                         IN  const _TCHAR* const* fileNames,
+*                                         IN  const ulib__SizeType count,
+*                                         IN  const ulib__uint32 depth,
+*                                         IN  const ulib__uint32 flags);
+*           ulib__bool UlibFileBatchNext(IN  ulib_file_batch* batch,
+*                                        OUT ulib_batch_file* file);
+*           void UlibFileBatchClose(IN ulib_file_batch* batch);
+* Starts reading the count files of fileNames, depth at a time. With depth 0
+* ULIB_BATCH_DEPTH reads are in flight, at most ULIB_BATCH_MAX_DEPTH. The
+* pool has one thread per read in flight, at most ULIB_BATCH_THREADS.
+* UlibFileBatchNext() waits for a file to be read and gives it, also a file
+* that could not be read, then file->status tells why.
+* flags are ULIB_BATCH_* flags.
+* NOTES:
+*   1. UlibFileBatchClose() can be called before all the files are given,
+*      it waits for the reads in flight and the threads.
+*   2. UlibFileBatchClose() must be called after a successful
+*      UlibFileBatchOpen().
+* Parameters:
+*       Input:  const _TCHAR* const* fileNames
+*               const ulib__SizeType count
+*               const ulib__uint32 depth
+*               const ulib__uint32 flags
+*       Output: ulib_file_batch* batch
+*               ulib_batch_file* file
+*       Return: UlibFileBatchOpen(): ULIB_SUCCESS if successful
+*               ULIB_MALLOC_ERROR if the memory ran out
+*               ULIB_ERROR if no worker thread could be started
+*               UlibFileBatchNext(): ULIB_TRUE if a file was given
+*               ULIB_FALSE when all of them were given, or batch->status
+*               is ULIB_ERROR
+******************************************************************************/
+    ulib__uint8 UlibFileBatchOpen(OUT ulib_file_batch* batch,
+                                  IN  const _TCHAR* const* fileNames,
+                                  IN  const ulib__SizeType count,
+                                  IN  const ulib__uint32 depth,
+                                  IN  const ulib__uint32 flags);
+    ulib__bool UlibFileBatchNext(IN  ulib_file_batch* batch,
+                                 OUT ulib_batch_file* file);
+    void UlibFileBatchClose(IN ulib_file_batch* batch);
+
+/******************************************************************************
+* Function:
+*           ulib__uint8 UlibReadFiles(IN const _TCHAR* const* fileNames,
+*                                     IN const ulib__SizeType count,
+*                                     IN const ulib__uint32 depth,
+*                                     IN ProcessBatchFile process,
+*                                     IN void* context);
+* Reads the files with a batch, process is called for each one
+* Parameters:
+*       Input:  const _TCHAR* const* fileNames
+*               const ulib__SizeType count
+*               const ulib__uint32 depth, reads in flight, 0 for the default
+*               ProcessBatchFile process
+*               void* context, passed to process
+*       Return: ULIB_SUCCESS if all the files were read, also when stopped
+*               by process
+*               ULIB_ERROR if some were not, error code in ulibError
+*               The error of UlibFileBatchOpen() if it failed
+******************************************************************************/
+    ulib__uint8 UlibReadFiles(IN const _TCHAR* const* fileNames,
+                              IN const ulib__SizeType count,
+                              IN const ulib__uint32 depth,
+                              IN ProcessBatchFile process,
+                              IN void* context);
+#ifdef __cplusplus
+} // extern "C" {
+#endif
+
+/* ========================================================================= */
+#ifdef IMPLEMENTATION
+// batch_slot.state
+#define BATCH_FREE      0
+#define BATCH_BUSY      1   // The file is being read
+#define BATCH_READY     2   // Read, not given yet
+#define BATCH_GIVEN     3   // Given by UlibFileBatchNext(), its buffer is in use
+
+// Bytes asked by one io_uring read
+#define BATCH_READ_MAX  0x40000000u
+
+// A read in flight, with the buffer it reads into
+typedef struct batch_slot_
+{
+    ulib_file_buffer     buffer;
+    struct batch_state_* owner;
+    ulib__SizeType       index;      // File in the slot
+    ulib__SizeType       size;
+    ulib__SizeType       done;       // Bytes read, io_uring
+    ulib_atomic32        state;      // BATCH_*
+    int                  file;       // io_uring, -1 until it is opened
+    ulib__uint8          status;
+}batch_slot;
+
+typedef struct batch_state_
+{
+    ulib_file_batch*     batch;
+    batch_slot*          slots;
+    ulib__uint32         slotCount;
+    ulib__uint32         cursor;     // Slot looked at first for a read file
+    ulib__int64          given;      // Slot of the file given last, -1 for none
+    ulib_atomic64        next;       // File to read next
+    ulib_atomic32        stop;
+    ulib_thread*         threads;
+    ulib__uint32         threadCount;
+#ifdef ULIB_IO_URING
+    int                  ring;
+    void*                sqMap;
+    ulib__SizeType       sqMapSize;
+    void*                cqMap;
+    ulib__SizeType       cqMapSize;
+    struct io_uring_sqe* sqes;
+    ulib__SizeType       sqesSize;
+    unsigned*            sqTail;
+    unsigned*            sqMask;
+    unsigned*            sqArray;
+    unsigned*            cqHead;
+    unsigned*            cqTail;
+    unsigned*            cqMask;
+    struct io_uring_cqe* cqes;
+    unsigned             toSubmit;   // Queued, not given to the kernel yet
+    ulib__uint32         inFlight;   // Submitted or queued, not completed
+#endif
+}batch_state;
+
+// Yields at first, then sleeps
+static void FileBatchWait(ulib__uint32* idle){
+    if (++(*idle) < 64u){
+        UlibThreadYield();
+    }
+    else{
+        UlibThreadSleep(1u);
+    }
+}
+
+// A slot with a read file, -1 if there is none
+static ulib__int64 FileBatchReady(batch_state* state){
+    ulib__uint32 i;
+    ulib__uint32 s;
+    for (i = 0; i < state->slotCount; ++i){
+        s = (state->cursor + i) % state->slotCount;
+        if (UlibAtomicLoad(&state->slots[s].state) == BATCH_READY){
+            state->cursor = s + 1u;
+            return ((ulib__int64)s);
+        }
+    }
+    return (-1);
+}
+
+#ifdef ULIB_IO_URING
+static int RingEnter(batch_state* state, const unsigned minComplete){
+    return ((int)syscall(__NR_io_uring_enter, state->ring, state->toSubmit, minComplete,
+                         minComplete ? IORING_ENTER_GETEVENTS : 0u, ULIB_NULL, 0));
+}
+
+static void RingFree(batch_state* state){
+    if (state->sqes){
+        munmap(state->sqes, state->sqesSize);
+    }
+    if (state->cqMap){
+        munmap(state->cqMap, state->cqMapSize);
+    }
+    if (state->sqMap){
+        munmap(state->sqMap, state->sqMapSize);
+    }
+    if (state->ring >= 0){
+        close(state->ring);
+    }
+    state->ring = -1;
+}
+
+// Maps the rings, ULIB_ERROR if io_uring can't be used here
+static ulib__uint8 RingOpen(batch_state* state, const ulib__uint32 depth){
+    struct io_uring_params params;
+    void* sqes;
+    memset(&params, 0, sizeof(params));
+    state->ring = (int)syscall(__NR_io_uring_setup, depth, &params);
+    if (state->ring < 0){
+        return (ULIB_ERROR);
+    }
+    if ((params.features & IORING_FEAT_RW_CUR_POS) == 0){
+        RingFree(state);
+        return (ULIB_ERROR);
+    }
+    state->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    state->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    state->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    state->sqMap = mmap(ULIB_NULL, state->sqMapSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, state->ring, IORING_OFF_SQ_RING);
+    state->sqMap = state->sqMap == MAP_FAILED ? ULIB_NULL : state->sqMap;
+    state->cqMap = mmap(ULIB_NULL, state->cqMapSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, state->ring, IORING_OFF_CQ_RING);
+    state->cqMap = state->cqMap == MAP_FAILED ? ULIB_NULL : state->cqMap;
+    sqes = mmap(ULIB_NULL, state->sqesSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, state->ring, IORING_OFF_SQES);
+    state->sqes = sqes == MAP_FAILED ? ULIB_NULL : (struct io_uring_sqe*)sqes;
+    if (state->sqMap == ULIB_NULL || state->cqMap == ULIB_NULL || state->sqes == ULIB_NULL){
+        RingFree(state);
+        return (ULIB_ERROR);
+    }
+    state->sqTail = (unsigned*)((ulib__uint8*)state->sqMap + params.sq_off.tail);
+    state->sqMask = (unsigned*)((ulib__uint8*)state->sqMap + params.sq_off.ring_mask);
+    state->sqArray = (unsigned*)((ulib__uint8*)state->sqMap + params.sq_off.array);
+    state->cqHead = (unsigned*)((ulib__uint8*)state->cqMap + params.cq_off.head);
+    state->cqTail = (unsigned*)((ulib__uint8*)state->cqMap + params.cq_off.tail);
+    state->cqMask = (unsigned*)((ulib__uint8*)state->cqMap + params.cq_off.ring_mask);
+    state->cqes = (struct io_uring_cqe*)((ulib__uint8*)state->cqMap + params.cq_off.cqes);
+    return (ULIB_SUCCESS);
+}
+
+// Queues an operation of the slot. A slot has one at a time, so the
+// submission queue, as deep as the batch, is never full.
+static void RingQueue(batch_state* state, batch_slot* slot, const ulib__uint8 opcode,
+                      const int fd, const void* address, const ulib__uint32 length,
+                      const ulib__uint64 offset, const ulib__uint32 openFlags){
+    unsigned tail = *state->sqTail;
+    unsigned index = tail & *state->sqMask;
+    struct io_uring_sqe* sqe = &state->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (ulib__uint64)(ulib__SizeType)address;
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->open_flags = openFlags;
+    sqe->user_data = (ulib__uint64)(slot - state->slots);
+    state->sqArray[index] = index;
+    // The entry is written before the kernel sees the new tail
+    __atomic_store_n(state->sqTail, tail + 1u, __ATOMIC_RELEASE);
+    state->toSubmit++;
+    state->inFlight++;
+}
+
+static void RingStart(batch_state* state, batch_slot* slot){
+    slot->index = (ulib__SizeType)state->next++;
+    slot->file = -1;
+    slot->size = 0;
+    slot->done = 0;
+    slot->status = ULIB_SUCCESS;
+    UlibAtomicStore(&slot->state, BATCH_BUSY);
+    RingQueue(state, slot, IORING_OP_OPENAT, AT_FDCWD, state->batch->fileNames[slot->index],
+              0, 0, O_RDONLY | O_CLOEXEC);
+}
+
+static void RingRead(batch_state* state, batch_slot* slot){
+    ulib__SizeType rest = slot->size - slot->done;
+    RingQueue(state, slot, IORING_OP_READ, slot->file, slot->buffer.data + slot->done,
+              rest < BATCH_READ_MAX ? (ulib__uint32)rest : BATCH_READ_MAX, slot->done, 0);
+}
+
+static void RingDone(batch_slot* slot, const ulib__uint8 status){
+    if (slot->file >= 0){
+        close(slot->file);
+        slot->file = -1;
+    }
+    slot->status = status;
+    if (status == ULIB_SUCCESS){
+        slot->buffer.data[slot->size] = 0;
+    }
+    UlibAtomicStore(&slot->state, BATCH_READY);
+}
+
+// The open, then the reads, as FileLoad() does them
+static void RingComplete(batch_state* state, batch_slot* slot, const int result){
+    struct stat st;
+    if (slot->file < 0 && result >= 0){
+        slot->file = result;
+        if (UlibAtomicLoad(&state->stop)){
+            RingDone(slot, ULIB_ERROR);
+        }
+        else if (fstat(slot->file, &st) != 0 ||
+            (ulib__uint64)st.st_size >= (ulib__uint64)(ulib__SizeType)-1){
+            RingDone(slot, ULIB_ERROR);
+        }
+        else if (FileAllocateBuffer(&slot->buffer, (ulib__SizeType)st.st_size + 1u) == ULIB_NULL){
+            RingDone(slot, ULIB_MALLOC_ERROR);
+        }
+        else if (st.st_size == 0){
+            RingDone(slot, ULIB_SUCCESS);
+        }
+        else{
+            slot->size = (ulib__SizeType)st.st_size;
+            RingRead(state, slot);
+        }
+    }
+    else if (slot->file < 0){
+        RingDone(slot, ULIB_FILE_NOT_FOUND);
+    }
+    else if (UlibAtomicLoad(&state->stop)){
+        RingDone(slot, ULIB_ERROR);
+    }
+    else if (result == -EINTR || result == -EAGAIN){
+        RingRead(state, slot);
+    }
+    else if (result <= 0){
+        // Made shorter while it is read, or a read error
+        RingDone(slot, ULIB_ERROR);
+    }
+    else{
+        slot->done += (ulib__SizeType)result;
+        if (slot->done < slot->size){
+            RingRead(state, slot);
+        }
+        else{
+            RingDone(slot, ULIB_SUCCESS);
+        }
+    }
+}
+
+// Submits the queued operations, waits for minComplete of them and
+// handles the completed ones
+static ulib__uint8 RingWait(batch_state* state, const unsigned minComplete){
+    unsigned head;
+    unsigned tail;
+    struct io_uring_cqe* cqe;
+    int submitted = RingEnter(state, minComplete);
+    if (submitted < 0 && errno != EINTR && errno != EAGAIN){
+        return (ULIB_ERROR);
+    }
+    if (submitted > 0){
+        state->toSubmit -= (unsigned)submitted;
+    }
+    head = *state->cqHead;
+    tail = __atomic_load_n(state->cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail){
+        cqe = &state->cqes[head & *state->cqMask];
+        state->inFlight--;
+        RingComplete(state, &state->slots[cqe->user_data], cqe->res);
+        ++head;
+    }
+    __atomic_store_n(state->cqHead, head, __ATOMIC_RELEASE);
+    return (ULIB_SUCCESS);
+}
+
+static ulib__int64 RingNext(batch_state* state){
+    ulib__int64 ready;
+    for (;;){
+        ready = FileBatchReady(state);
+        if (ready >= 0){
+            return (ready);
+        }
+        if (state->inFlight == 0 || RingWait(state, 1u) != ULIB_SUCCESS){
+            return (-1);
+        }
+    }
+}
+
+static void RingRelease(batch_state* state, batch_slot* slot){
+    if ((ulib__SizeType)state->next < state->batch->count){
+        RingStart(state, slot);
+        // Submitted with others, but not so late that the depth runs low
+        if (state->toSubmit * 4u >= state->slotCount){
+            RingWait(state, 0);
+        }
+    }
+    else{
+        UlibAtomicStore(&slot->state, BATCH_FREE);
+    }
+}
+
+// The reads in flight complete before their buffers are freed
+static void RingClose(batch_state* state){
+    ulib__uint32 i;
+    while (state->inFlight && RingWait(state, 1u) == ULIB_SUCCESS);
+    for (i = 0; i < state->slotCount; ++i){
+        if (state->slots[i].file >= 0){
+            close(state->slots[i].file);
+        }
+    }
+    RingFree(state);
+}
+#else
+static ulib__uint8 RingOpen(batch_state* state, const ulib__uint32 depth){
+    ULIB_UNUSED(state);
+    ULIB_UNUSED(depth);
+    return (ULIB_ERROR);
+}
+
+static void RingStart(batch_state* state, batch_slot* slot){
+    ULIB_UNUSED(state);
+    ULIB_UNUSED(slot);
+}
+
+static ulib__uint8 RingWait(batch_state* state, const unsigned minComplete){
+    ULIB_UNUSED(state);
+    ULIB_UNUSED(minComplete);
+    return (ULIB_ERROR);
+}
+
+static ulib__int64 RingNext(batch_state* state){
+    ULIB_UNUSED(state);
+    return (-1);
+}
+
+static void RingRelease(batch_state* state, batch_slot* slot){
+    ULIB_UNUSED(state);
+    ULIB_UNUSED(slot);
+}
+
+static void RingClose(batch_state* state){
+    ULIB_UNUSED(state);
+}
+#endif // #ifdef ULIB_IO_URING
+
+// A pool thread, reads a file into its slot and waits for it to be given
+// and released before taking the next one
+static void PoolWorker(void* arg){
+    batch_slot* slot = (batch_slot*)arg;
+    batch_state* state = slot->owner;
+    ulib__uint8* contents;
+    ulib__int64 index;
+    ulib__uint32 idle;
+    for (;;){
+        index = UlibAtomicAdd64(&state->next, 1) - 1;
+        if ((ulib__SizeType)index >= state->batch->count || UlibAtomicLoad(&state->stop)){
+            break;
+        }
+        slot->index = (ulib__SizeType)index;
+        slot->status = FileLoad(state->batch->fileNames[index], FileAllocateBuffer,
+                                &slot->buffer, &contents, &slot->size);
+        UlibAtomicStore(&slot->state, BATCH_READY);
+        idle = 0;
+        while (UlibAtomicLoad(&slot->state) != BATCH_FREE && !UlibAtomicLoad(&state->stop)){
+            FileBatchWait(&idle);
+        }
+    }
+}
+
+static ulib__int64 PoolNext(batch_state* state){
+    ulib__int64 ready;
+    ulib__uint32 idle = 0;
+    for (;;){
+        ready = FileBatchReady(state);
+        if (ready >= 0){
+            return (ready);
+        }
+        FileBatchWait(&idle);
+    }
+}
+
+static ulib__uint8 PoolOpen(batch_state* state){
+    ulib__uint32 i;
+    if (state->slotCount == 0){
+        return (ULIB_SUCCESS);
+    }
+    state->threads = (ulib_thread*)malloc(state->slotCount * sizeof(ulib_thread));
+    if (state->threads == ULIB_NULL){
+        return (ULIB_MALLOC_ERROR);
+    }
+    for (i = 0; i < state->slotCount; ++i){
+        if (UlibThreadStart(&state->threads[state->threadCount], PoolWorker,
+                            &state->slots[i]) == ULIB_SUCCESS){
+            state->threadCount++;
+        }
+    }
+    // The started threads read all the files, fewer of them at a time
+    return (state->threadCount ? ULIB_SUCCESS : ULIB_ERROR);
+}
+
+static void PoolClose(batch_state* state){
+    ulib__uint32 i;
+    for (i = 0; i < state->threadCount; ++i){
+        UlibThreadJoin(&state->threads[i]);
+    }
+    ULIB_FREE(state->threads);
+}
+
+static void FileBatchFree(batch_state* state){
+    ulib__uint32 i;
+    for (i = 0; i < state->slotCount; ++i){
+        UlibFileBufferFree(&state->slots[i].buffer);
+    }
+    free(state->slots);
+    free(state);
+}
+
+ulib__uint8 UlibFileBatchOpen(ulib_file_batch* batch,
+                              const _TCHAR* const* fileNames,
+                              const ulib__SizeType count,
+                              const ulib__uint32 depth,
+                              const ulib__uint32 flags){
+    batch_state* state;
+    ulib__uint32 slotCount;
+    ulib__uint32 i;
+    ulib__uint8 status;
+    batch->fileNames = fileNames;
+    batch->count = count;
+    batch->given = 0;
+    batch->failed = 0;
+    batch->bytes = 0;
+    batch->depth = depth == 0 ? ULIB_BATCH_DEPTH :
+                   depth < ULIB_BATCH_MAX_DEPTH ? depth : ULIB_BATCH_MAX_DEPTH;
+    batch->engine = ULIB_BATCH_POOL;
+    batch->status = ULIB_SUCCESS;
+    state = (batch_state*)calloc(1u, sizeof(batch_state));
+    if (state == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_MALLOC_ERROR);
+    }
+    state->batch = batch;
+    state->given = -1;
+#ifdef ULIB_IO_URING
+    state->ring = -1;
+#endif
+    if ((flags & ULIB_BATCH_NO_URING) == 0 && count &&
+        RingOpen(state, batch->depth) == ULIB_SUCCESS){
+        batch->engine = ULIB_BATCH_URING;
+    }
+    slotCount = batch->engine == ULIB_BATCH_URING || batch->depth < ULIB_BATCH_THREADS ?
+                batch->depth : ULIB_BATCH_THREADS;
+    slotCount = count < slotCount ? (ulib__uint32)count : slotCount;
+    state->slots = (batch_slot*)calloc(slotCount ? slotCount : 1u, sizeof(batch_slot));
+    if (state->slots == ULIB_NULL){
+        RingClose(state);
+        free(state);
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_MALLOC_ERROR);
+    }
+    state->slotCount = slotCount;
+    for (i = 0; i < slotCount; ++i){
+        INIT_ULIB_FILE_BUFFER(state->slots[i].buffer);
+        state->slots[i].owner = state;
+        state->slots[i].file = -1;
+    }
+    batch->state = state;
+    if (batch->engine == ULIB_BATCH_URING){
+        for (i = 0; i < slotCount; ++i){
+            RingStart(state, &state->slots[i]);
+        }
+        // The reads start now, UlibFileBatchNext() waits for them
+        RingWait(state, 0);
+        return (ULIB_SUCCESS);
+    }
+    status = PoolOpen(state);
+    if (status != ULIB_SUCCESS){
+        ULIB_FREE(state->threads);
+        FileBatchFree(state);
+        batch->state = ULIB_NULL;
+        ulibError = status;
+    }
+    return (status);
+}
+
+ulib__bool UlibFileBatchNext(ulib_file_batch* batch, ulib_batch_file* file){
+    batch_state* state = batch->state;
+    batch_slot* slot;
+    ulib__int64 ready;
+    if (state->given >= 0){
+        slot = &state->slots[state->given];
+        state->given = -1;
+        if (batch->engine == ULIB_BATCH_URING){
+            RingRelease(state, slot);
+        }
+        else{
+            UlibAtomicStore(&slot->state, BATCH_FREE);
+        }
+    }
+    if (batch->given == batch->count || batch->status != ULIB_SUCCESS){
+        return (ULIB_FALSE);
+    }
+    ready = batch->engine == ULIB_BATCH_URING ? RingNext(state) : PoolNext(state);
+    if (ready < 0){
+        batch->status = ULIB_ERROR;
+        ulibError = ULIB_ERROR;
+        return (ULIB_FALSE);
+    }
+    slot = &state->slots[ready];
+    UlibAtomicStore(&slot->state, BATCH_GIVEN);
+    state->given = ready;
+    batch->given++;
+    file->fileName = batch->fileNames[slot->index];
+    file->index = slot->index;
+    file->status = slot->status;
+    if (slot->status == ULIB_SUCCESS){
+        file->data = slot->buffer.data;
+        file->size = slot->size;
+        batch->bytes += slot->size;
+    }
+    else{
+        file->data = ULIB_NULL;
+        file->size = 0;
+        batch->failed++;
+        ulibError = slot->status;
+    }
+    return (ULIB_TRUE);
+}
+
+void UlibFileBatchClose(ulib_file_batch* batch){
+    batch_state* state = batch->state;
+    UlibAtomicStore(&state->stop, 1);
+    if (batch->engine == ULIB_BATCH_URING){
+        RingClose(state);
+    }
+    else{
+        PoolClose(state);
+    }
+    FileBatchFree(state);
+    batch->state = ULIB_NULL;
+}
+
+ulib__uint8 UlibReadFiles(const _TCHAR* const* fileNames,
+                          const ulib__SizeType count,
+                          const ulib__uint32 depth,
+                          ProcessBatchFile process,
+                          void* context){
+    ulib_file_batch batch;
+    ulib_batch_file file;
+    ulib__uint8 status = UlibFileBatchOpen(&batch, fileNames, count, depth, 0);
+    if (status != ULIB_SUCCESS){
+        return (status);
+    }
+    while (UlibFileBatchNext(&batch, &file)){
+        if (process(&file, context) == ULIB_FALSE){
+            break;
+        }
+    }
+    status = batch.failed || batch.status != ULIB_SUCCESS ? ULIB_ERROR : ULIB_SUCCESS;
+    UlibFileBatchClose(&batch);
+    return (status);
+}
+#endif // #ifdef IMPLEMENTATION
+#ifdef __cplusplus // namespace ulib{
+}
+#endif
+#endif // #ifndef _ulib_file_batch_h_
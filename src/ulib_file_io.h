@@ -1,139 +1,1140 @@
-/*
-
-Copyright (c) 2018-2021, Croitor Cristian
-
-THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
-AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
-ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
-LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
-CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
-SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
-INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
-CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
-ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
-POSSIBILITY OF SUCH DAMAGE.
-
-For licensing, please check the LICENSE file included with the source code.
-*/
-
-#ifndef _ulib_file_io_h_
-#define _ulib_file_io_h_
-
-#include "ulib_common.h"
-
-/******************************************************************************
-* Public functions
-*
-* ulib__uint8* _tReadEntireFile(IN  const _TCHAR* fileName,
-*                               OUT ulib__SizeType* fileSize)
-* ulib__uint8 _tWriteEntireFile(IN const _TCHAR* fileName,
-*                               IN const ulib__uint8* buffer,
-*                               IN const ulib__SizeType count);
-******************************************************************************/
-
-#ifdef __cplusplus
-namespace ulib{
-#endif
-#ifdef __cplusplus
-extern "C"{
-#endif
-/******************************************************************************
-* Function:
-*           ulib__uint8* _tReadEntireFile(IN  const _TCHAR* fileName,
-*                                         OUT ulib__SizeType* fileSize)
-* Function that reads all content of a file in binary mode
-* Allocates the space needed via malloc - user should call ULIB_FREE when done
-* Appends the NULL terminator to the read buffer
-* Parameters:
-*       Input:  const _TCHAR* FileName
-*       Return: ulib__uint8* buffer allocated with malloc of size of file
-                length + 1, including NULL terminator
-*               NULL if something went wrong IE:
-*                    - didn't read all the file contents,
-*                    - error in malloc
-*                    - file not found, etc
-******************************************************************************/
-    ulib__uint8* _tReadEntireFile(IN  const _TCHAR* fileName,
-                                  OUT ulib__SizeType* fileSize);
-/*****************************************************************************/
-
-/******************************************************************************
-* Function:
-*           ulib__uint8 _tWriteEntireFile(IN const _TCHAR* fileName,
-*                                         IN const ulib__uint8* buffer,
-*                                         IN const ulib__SizeType count);
-* Function that writes a uint8_t* to a file, binary mode
-* Overwrites if file exists
-* Parameters:
-*       Input:  const char* FileName
-*               const ulib__uint8* buffer
-*               const ulib__SizeType count
-*       Return: NULL if something went wrong
-******************************************************************************/
-    ulib__uint8 _tWriteEntireFile(IN const _TCHAR* fileName,
-                                  IN const ulib__uint8* buffer,
-                                  IN const ulib__SizeType count);
-/*****************************************************************************/
-#ifdef __cplusplus
-} /* extern "C" {*/
-#endif
-
-
-#ifdef IMPLEMENTATION
-ulib__uint8* _tReadEntireFile(IN const _TCHAR* fileName,
-                              OUT ulib__SizeType* fileSize){
-    FILE* file = ULIB_NULL;
-    ulib__uint8* contents = ULIB_NULL;
-    ulib__int32 localSize = 0;
-    ulib__SizeType readCount = 0;
-    _tfopen_s(&file, fileName, _TEXT("rb"));
-    if (file == ULIB_NULL){
-        fileSize = ULIB_NULL;
-        return (ULIB_NULL);
-    }
-    fseek(file, 0, SEEK_END);
-    localSize = ftell(file);
-    if (localSize == -1L){
-        return (ULIB_NULL);
-    }
-    fseek(file, 0, SEEK_SET);
-    *fileSize = (ulib__SizeType)localSize;
-    contents = (ulib__uint8*)malloc((*fileSize) + 1u);
-    if (contents == ULIB_NULL){
-        return (ULIB_NULL);
-    }
-    readCount = fread(contents, 1, *fileSize, file);
-    if (readCount != *fileSize){
-        fileSize = ULIB_NULL;
-        ULIB_FREE(contents);
-        return (ULIB_NULL);
-    }
-    contents[*fileSize] = 0L;
-    fclose(file);
-    return(contents);
-}
-
-ulib__uint8 _tWriteEntireFile(IN const _TCHAR* fileName,
-                              IN const ulib__uint8* buffer,
-                              IN const ulib__SizeType count){
-    FILE* file = ULIB_NULL;
-    ulib__SizeType writeCount = 0;
-    _tfopen_s(&file, fileName, _TEXT("wb"));
-    if (file == ULIB_NULL){
-        return (ULIB_ERROR);
-    }
-    writeCount = fwrite(buffer, 1u, count, file);
-    if (writeCount != count){
-        fclose(file);
-        return (ULIB_ERROR);
-    }
-    fclose(file);
-    return (ULIB_SUCCESS);
-}
-
-#endif // #ifdef IMPLEMENTATION
-#ifdef __cplusplus // namespace ulib{
-}
-#endif
-#endif // #ifndef ulib_file_io_h
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+#ifndef _ulib_file_io_h_
+#define _ulib_file_io_h_
+
+#include "ulib_common.h"
+#include "ulib_arena.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+/******************************************************************************
+* Public functions
+*
+* ulib__uint8* _tReadEntireFile(IN  const _TCHAR* fileName,
+*                               OUT ulib__SizeType* fileSize)
+* ulib__uint8* _tReadEntireFileArena(IN  const _TCHAR* fileName,
+*                                    OUT ulib__SizeType* fileSize,
+*                                    IN  ulib_arena* arena)
+* ulib__uint8* _tReadEntireFileBuffer(IN  const _TCHAR* fileName,
+*                                     OUT ulib__SizeType* fileSize,
+*                                     IN OUT ulib_file_buffer* buffer)
+* void UlibFileBufferFree(IN ulib_file_buffer* buffer)
+* ulib__uint8 _tWriteEntireFile(IN const _TCHAR* fileName,
+*                               IN const ulib__uint8* buffer,
+*                               IN const ulib__SizeType count);
+* ulib__uint8 _tWriteEntireFileV(IN const _TCHAR* fileName,
+*                                IN const ulib_file_segment* segments,
+*                                IN const ulib__SizeType count,
+*                                IN const ulib__uint32 flags);
+* ulib__uint8 UlibMapFile(OUT ulib_file_view* view,
+*                         IN  const _TCHAR* fileName,
+*                         IN  const ulib__uint32 flags);
+* void UlibUnmapFile(IN ulib_file_view* view);
+* ulib__uint8 UlibFileReaderOpen(OUT ulib_file_reader* reader,
+*                                IN  const _TCHAR* fileName,
+*                                IN  const ulib__SizeType chunkSize,
+*                                IN  ulib__uint8* buffer);
+* ulib__SizeType UlibFileReaderNext(IN  ulib_file_reader* reader,
+*                                   OUT const ulib__uint8** chunk,
+*                                   OUT ulib__uint64* offset);
+* void UlibFileReaderClose(IN ulib_file_reader* reader);
+******************************************************************************/
+
+// Flags of UlibMapFile()
+#define ULIB_MAP_SEQUENTIAL  0x01u  // Read front to back, more read ahead
+#define ULIB_MAP_RANDOM      0x02u  // Read here and there, no read ahead
+#define ULIB_MAP_WILLNEED    0x04u  // Start reading the whole file in
+#define ULIB_MAP_HUGEPAGE    0x08u  // Huge pages, where the file system has them
+#define ULIB_MAP_TERMINATED  0x10u  // data[size] is a 0, as with _tReadEntireFile
+
+// Flags of _tWriteEntireFileV()
+#define ULIB_WRITE_ATOMIC    0x01u  // Write a temp file next to it, renamed over it when done
+#define ULIB_WRITE_SYNC      0x02u  // On the disk before returning (fdatasync)
+
+// Chunk size of UlibFileReaderOpen() when none is given
+#ifndef ULIB_READER_CHUNK
+#define ULIB_READER_CHUNK    (1024u * ULIB_KILOBYTE)
+#endif
+
+#ifdef __cplusplus
+namespace ulib{
+#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
+    // A read only view of a file, see UlibMapFile()
+    typedef struct ulib_file_view_
+    {
+        const ulib__uint8*  data;       // The contents
+        ulib__SizeType      size;       // Bytes in the file
+        void*               base;       // Mapped address, or the copy
+        ulib__SizeType      mapSize;    // Bytes mapped at base, 0 for a copy
+    }ulib_file_view;
+
+    // Memory reused by _tReadEntireFileBuffer() from file to file
+    typedef struct ulib_file_buffer_
+    {
+        ulib__uint8*        data;       // malloc'd, contents of the last file
+        ulib__SizeType      capacity;   // Bytes allocated at data
+    }ulib_file_buffer;
+
+#define INIT_ULIB_FILE_BUFFER(fileBuffer)\
+    (fileBuffer).data = ULIB_NULL;\
+    (fileBuffer).capacity = 0;
+
+    // A piece of the file written by _tWriteEntireFileV()
+    typedef struct ulib_file_segment_
+    {
+        const void*         data;
+        ulib__SizeType      size;
+    }ulib_file_segment;
+
+    // A file read in chunks, see UlibFileReaderOpen()
+    typedef struct ulib_file_reader_
+    {
+#ifdef _WIN32
+        HANDLE              file;
+        OVERLAPPED          pending;    // Read of the next chunk
+        ulib__bool          reading;    // pending is started
+#else
+        int                 file;
+#endif
+        ulib__uint64        size;       // Bytes in the file when it was opened
+        ulib__uint64        offset;     // Of the next chunk
+        ulib__uint8*        buffers[2]; // The chunks, used in turn
+        ulib__uint32        next;       // Buffer of the next chunk
+        ulib__SizeType      chunkSize;
+        ulib__bool          ownBuffer;  // buffers[0] was allocated by the reader
+        ulib__uint8         status;     // ULIB_SUCCESS, or the error that ended the reading
+    }ulib_file_reader;
+
+/******************************************************************************
+* Function:
+*           ulib__uint8* _tReadEntireFile(IN  const _TCHAR* fileName,
+*                                         OUT ulib__SizeType* fileSize)
+* Function that reads all content of a file in binary mode
+* Allocates the space needed via malloc - user should call ULIB_FREE when done
+* Appends the NULL terminator to the read buffer
+* Parameters:
+*       Input:  const _TCHAR* FileName
+*       Return: ulib__uint8* buffer allocated with malloc of size of file
+                length + 1, including NULL terminator
+*               NULL if something went wrong IE:
+*                    - didn't read all the file contents,
+*                    - error in malloc
+*                    - file not found, etc
+******************************************************************************/
+    ulib__uint8* _tReadEntireFile(IN  const _TCHAR* fileName,
+                                  OUT ulib__SizeType* fileSize);
+/*****************************************************************************/
+
+/******************************************************************************
+* Function:
+*           ulib__uint8* _tReadEntireFileArena(IN  const _TCHAR* fileName,
+*                                              OUT ulib__SizeType* fileSize,
+*                                              IN  ulib_arena* arena)
+* Same as _tReadEntireFile, but the buffer is allocated from arena and is
+* given back with it - it must not be freed. With arena ULIB_NULL the buffer
+* is allocated via malloc.
+* Parameters:
+*       Input:  const _TCHAR* FileName
+*               ulib_arena* arena
+*       Return: ulib__uint8* buffer of size of file length + 1
+*               NULL if something went wrong, the arena is left as it was
+******************************************************************************/
+    ulib__uint8* _tReadEntireFileArena(IN  const _TCHAR* fileName,
+                                       OUT ulib__SizeType* fileSize,
+                                       IN  ulib_arena* arena);
+/*****************************************************************************/
+
+/******************************************************************************
+* Function:
+*           ulib__uint8* _tReadEntireFileBuffer(IN  const _TCHAR* fileName,
+*                                               OUT ulib__SizeType* fileSize,
+*                                               IN OUT ulib_file_buffer* buffer)
+*           void UlibFileBufferFree(IN ulib_file_buffer* buffer)
+* Same as _tReadEntireFile, but the contents go to buffer, which grows when
+* a file doesn't fit and is kept for the next call. Reading many small files
+* costs open, fstat, read and close per file, with no allocation once the
+* buffer is big enough.
+* The contents are valid until the next call with the same buffer.
+* buffer starts with INIT_ULIB_FILE_BUFFER, or with a data block from malloc
+* and its capacity, and is freed with UlibFileBufferFree().
+* _tReadEntireFile and _tReadEntireFileArena read the same way, without
+* stdio.
+* Parameters:
+*       Input:  const _TCHAR* FileName
+*               ulib_file_buffer* buffer
+*       Return: ulib__uint8* buffer->data, with a 0 after the file contents
+*               NULL if something went wrong, error code in ulibError
+******************************************************************************/
+    ulib__uint8* _tReadEntireFileBuffer(IN  const _TCHAR* fileName,
+                                        OUT ulib__SizeType* fileSize,
+                                        IN OUT ulib_file_buffer* buffer);
+    void UlibFileBufferFree(IN ulib_file_buffer* buffer);
+/*****************************************************************************/
+
+/******************************************************************************
+* Function:
+*           ulib__uint8 _tWriteEntireFile(IN const _TCHAR* fileName,
+*                                         IN const ulib__uint8* buffer,
+*                                         IN const ulib__SizeType count);
+* Function that writes a uint8_t* to a file, binary mode
+* Overwrites if file exists
+* Parameters:
+*       Input:  const char* FileName
+*               const ulib__uint8* buffer
+*               const ulib__SizeType count
+*       Return: NULL if something went wrong
+******************************************************************************/
+    ulib__uint8 _tWriteEntireFile(IN const _TCHAR* fileName,
+                                  IN const ulib__uint8* buffer,
+                                  IN const ulib__SizeType count);
+/*****************************************************************************/
+
+/******************************************************************************
+* Function:
+*           ulib__uint8 _tWriteEntireFileV(IN const _TCHAR* fileName,
+*                                          IN const ulib_file_segment* segments,
+*                                          IN const ulib__SizeType count,
+*                                          IN const ulib__uint32 flags);
+* Writes the segments one after the other to the file, without copying them
+* together first: writev on Linux, a WriteFile per segment on Windows.
+* Overwrites if file exists.
+* flags:
+*   ULIB_WRITE_ATOMIC - the segments go to a new file next to fileName,
+*       renamed over it when they are all written. fileName has either
+*       the old or the new contents, never a part of them. The new file
+*       gets the permissions of the old one on Linux.
+*   ULIB_WRITE_SYNC - the data is flushed to the disk before returning
+*       (fdatasync / FlushFileBuffers), with ULIB_WRITE_ATOMIC before the
+*       rename and the rename too.
+* Parameters:
+*       Input:  const _TCHAR* fileName
+*               const ulib_file_segment* segments
+*               const ulib__SizeType count
+*               const ulib__uint32 flags
+*       Return: ULIB_SUCCESS if successful
+*               ULIB_ERROR if something went wrong, with ULIB_WRITE_ATOMIC
+*               fileName is left as it was
+******************************************************************************/
+    ulib__uint8 _tWriteEntireFileV(IN const _TCHAR* fileName,
+                                   IN const ulib_file_segment* segments,
+                                   IN const ulib__SizeType count,
+                                   IN const ulib__uint32 flags);
+/*****************************************************************************/
+
+/******************************************************************************
+* Function:
+*           ulib__uint8 UlibMapFile(OUT ulib_file_view* view,
+*                                   IN  const _TCHAR* fileName,
+*                                   IN  const ulib__uint32 flags);
+*           void UlibUnmapFile(IN ulib_file_view* view);
+* Maps the file read only: view->data has view->size bytes and the pages are
+* shared with the page cache, nothing is copied or allocated for them.
+* flags are ULIB_MAP_* hints, given to madvise on Linux. On Windows
+* ULIB_MAP_SEQUENTIAL and ULIB_MAP_RANDOM go to CreateFile, the others are
+* ignored.
+* NOTES:
+*   1. An empty file is not mapped, view->data points to a 0 and
+*      view->size is 0.
+*   2. view->data[view->size] can be read only with ULIB_MAP_TERMINATED,
+*      then it is 0. The bytes after the end of the file in its last page
+*      are 0, a file filling its last page gets a page of zeros mapped
+*      after it on Linux, and is copied to memory on Windows.
+*   3. The view shows changes made to the file. If the file is made
+*      shorter, reading past its new end faults (SIGBUS).
+*   4. Files that don't report their size, like the ones in /proc, are
+*      seen as empty.
+*   5. UlibUnmapFile() must be called after a successful UlibMapFile().
+* Parameters:
+*       Input:  const _TCHAR* fileName
+*               const ulib__uint32 flags
+*       Output: ulib_file_view* view
+*       Return: ULIB_SUCCESS if successful
+*               ULIB_FILE_NOT_FOUND if the file can't be opened
+*               ULIB_ERROR if it can't be mapped or is too big for the
+*               address space, error code in ulibError
+******************************************************************************/
+    ulib__uint8 UlibMapFile(OUT ulib_file_view* view,
+                            IN  const _TCHAR* fileName,
+                            IN  const ulib__uint32 flags);
+    void UlibUnmapFile(IN ulib_file_view* view);
+/*****************************************************************************/
+
+/******************************************************************************
+* Function:
+*           ulib__uint8 UlibFileReaderOpen(OUT ulib_file_reader* reader,
+*                                          IN  const _TCHAR* fileName,
+*                                          IN  const ulib__SizeType chunkSize,
+*                                          IN  ulib__uint8* buffer);
+*           ulib__SizeType UlibFileReaderNext(IN  ulib_file_reader* reader,
+*                                             OUT const ulib__uint8** chunk,
+*                                             OUT ulib__uint64* offset);
+*           void UlibFileReaderClose(IN ulib_file_reader* reader);
+* Reads the file front to back in chunks of chunkSize bytes, the last one
+* can be shorter. Offsets and the file size are 64 bit, the memory used is
+* two chunks whatever the file size.
+* The next chunk is read while the caller works on the current one: on
+* Linux the kernel is asked to read it ahead (posix_fadvise), on Windows it
+* is read with overlapped I/O into the other buffer.
+* NOTES:
+*   1. buffer holds the two chunks, 2 * chunkSize bytes, and belongs to the
+*      caller. With buffer ULIB_NULL the reader allocates it. With
+*      chunkSize 0 the chunks are ULIB_READER_CHUNK bytes.
+*   2. A chunk is valid until the next UlibFileReaderNext() call.
+*   3. UlibFileReaderNext() returns 0 at the end of the file and on an
+*      error, then reader->status is not ULIB_SUCCESS. A file made shorter
+*      while it is read ends early, what is added to it is not read.
+*   4. On Windows a chunk is at most 1 GB.
+*   5. UlibFileReaderClose() must be called after a successful
+*      UlibFileReaderOpen().
+* Parameters:
+*       Input:  const _TCHAR* fileName
+*               const ulib__SizeType chunkSize
+*               ulib__uint8* buffer
+*       Output: ulib_file_reader* reader
+*               const ulib__uint8** chunk
+*               ulib__uint64* offset, of the chunk in the file
+*       Return: UlibFileReaderOpen(): ULIB_SUCCESS if successful
+*               ULIB_FILE_NOT_FOUND if the file can't be opened
+*               ULIB_MALLOC_ERROR if the buffer can't be allocated
+*               UlibFileReaderNext(): bytes in the chunk
+******************************************************************************/
+    ulib__uint8 UlibFileReaderOpen(OUT ulib_file_reader* reader,
+                                   IN  const _TCHAR* fileName,
+                                   IN  const ulib__SizeType chunkSize,
+                                   IN  ulib__uint8* buffer);
+    ulib__SizeType UlibFileReaderNext(IN  ulib_file_reader* reader,
+                                      OUT const ulib__uint8** chunk,
+                                      OUT ulib__uint64* offset);
+    void UlibFileReaderClose(IN ulib_file_reader* reader);
+/*****************************************************************************/
+#ifdef __cplusplus
+} /* extern "C" {*/
+#endif
+
+
+#ifdef IMPLEMENTATION
+// Segments given to one writev
+#define ULIB_WRITE_IOV   64u
+// Temp file names tried by _tWriteEntireFileV()
+#define ULIB_WRITE_TRIES 100u
+
+// Contents of an empty file
+static const ulib__uint8 ulibEmptyFile[1] = { 0 };
+
+// Room for the contents of a file and the 0 after them, size bytes
+typedef ulib__uint8* (*FileAllocate)(void* context, const ulib__SizeType size);
+
+static ulib__uint8* FileAllocateMalloc(void* context, const ulib__SizeType size){
+    ULIB_UNUSED(context);
+    return ((ulib__uint8*)malloc(size));
+}
+
+static ulib__uint8* FileAllocateArena(void* context, const ulib__SizeType size){
+    return ((ulib__uint8*)UlibArenaAlloc((ulib_arena*)context, size));
+}
+
+// The old contents are not kept, the buffer is replaced instead of realloc'd
+static ulib__uint8* FileAllocateBuffer(void* context, const ulib__SizeType size){
+    ulib_file_buffer* buffer = (ulib_file_buffer*)context;
+    ulib__SizeType capacity;
+    if (size > buffer->capacity){
+        capacity = buffer->capacity * 2u > size ? buffer->capacity * 2u : size;
+        ULIB_FREE(buffer->data);
+        buffer->capacity = 0;
+        buffer->data = (ulib__uint8*)malloc(capacity);
+        if (buffer->data == ULIB_NULL){
+            return (ULIB_NULL);
+        }
+        buffer->capacity = capacity;
+    }
+    return (buffer->data);
+}
+
+#ifdef _WIN32
+// The whole file into the memory given by allocate, with a 0 after it.
+// No stdio, CreateFile / GetFileSizeEx / ReadFile / CloseHandle.
+// contents is set if allocate was called, also on an error.
+static ulib__uint8 FileLoad(const _TCHAR* fileName,
+                            FileAllocate allocate,
+                            void* context,
+                            ulib__uint8** contents,
+                            ulib__SizeType* fileSize){
+    LARGE_INTEGER size;
+    ulib__SizeType done = 0;
+    DWORD chunk;
+    DWORD readCount;
+    HANDLE file;
+    *contents = ULIB_NULL;
+    file = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, ULIB_NULL, OPEN_EXISTING,
+                      FILE_FLAG_SEQUENTIAL_SCAN, ULIB_NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        ulibError = ULIB_FILE_NOT_FOUND;
+        return (ULIB_FILE_NOT_FOUND);
+    }
+    if (GetFileSizeEx(file, &size) == 0 ||
+        (ulib__uint64)size.QuadPart >= (ulib__uint64)(ulib__SizeType)-1){
+        CloseHandle(file);
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    *fileSize = (ulib__SizeType)size.QuadPart;
+    *contents = allocate(context, *fileSize + 1u);
+    if (*contents == ULIB_NULL){
+        CloseHandle(file);
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_MALLOC_ERROR);
+    }
+    while (done < *fileSize){
+        chunk = (*fileSize - done) < 0x40000000u ? (DWORD)(*fileSize - done) : 0x40000000u;
+        if (ReadFile(file, *contents + done, chunk, &readCount, ULIB_NULL) == 0 ||
+            readCount == 0){
+            CloseHandle(file);
+            ulibError = ULIB_ERROR;
+            return (ULIB_ERROR);
+        }
+        done += readCount;
+    }
+    CloseHandle(file);
+    (*contents)[*fileSize] = 0;
+    return (ULIB_SUCCESS);
+}
+#else
+// The whole file into the memory given by allocate, with a 0 after it.
+// No stdio, open / fstat / read / close.
+// contents is set if allocate was called, also on an error.
+static ulib__uint8 FileLoad(const _TCHAR* fileName,
+                            FileAllocate allocate,
+                            void* context,
+                            ulib__uint8** contents,
+                            ulib__SizeType* fileSize){
+    struct stat st;
+    ulib__SizeType done = 0;
+    ssize_t bytes;
+    int file;
+    *contents = ULIB_NULL;
+    file = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (file == -1){
+        ulibError = ULIB_FILE_NOT_FOUND;
+        return (ULIB_FILE_NOT_FOUND);
+    }
+    // Files over 2 GB fit in a 64 bit address space
+    if (fstat(file, &st) != 0 ||
+        (ulib__uint64)st.st_size >= (ulib__uint64)(ulib__SizeType)-1){
+        close(file);
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    *fileSize = (ulib__SizeType)st.st_size;
+    *contents = allocate(context, *fileSize + 1u);
+    if (*contents == ULIB_NULL){
+        close(file);
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_MALLOC_ERROR);
+    }
+    while (done < *fileSize){
+        bytes = read(file, *contents + done, *fileSize - done);
+        if (bytes > 0){
+            done += (ulib__SizeType)bytes;
+        }
+        else if (bytes == 0 || errno != EINTR){
+            // Made shorter while it is read, or a read error
+            close(file);
+            ulibError = ULIB_ERROR;
+            return (ULIB_ERROR);
+        }
+    }
+    close(file);
+    (*contents)[*fileSize] = 0;
+    return (ULIB_SUCCESS);
+}
+#endif // #ifdef _WIN32
+
+ulib__uint8* _tReadEntireFile(IN const _TCHAR* fileName,
+                              OUT ulib__SizeType* fileSize){
+    return (_tReadEntireFileArena(fileName, fileSize, ULIB_NULL));
+}
+
+ulib__uint8* _tReadEntireFileArena(IN const _TCHAR* fileName,
+                                   OUT ulib__SizeType* fileSize,
+                                   IN ulib_arena* arena){
+    ulib__uint8* contents;
+    ulib_arena_mark mark;
+    if (arena == ULIB_NULL){
+        if (FileLoad(fileName, FileAllocateMalloc, ULIB_NULL, &contents, fileSize)){
+            free(contents);
+            return (ULIB_NULL);
+        }
+        return (contents);
+    }
+    mark = UlibArenaMark(arena);
+    if (FileLoad(fileName, FileAllocateArena, arena, &contents, fileSize)){
+        UlibArenaRewind(arena, mark);
+        return (ULIB_NULL);
+    }
+    return (contents);
+}
+
+ulib__uint8* _tReadEntireFileBuffer(IN const _TCHAR* fileName,
+                                    OUT ulib__SizeType* fileSize,
+                                    IN OUT ulib_file_buffer* buffer){
+    ulib__uint8* contents;
+    if (FileLoad(fileName, FileAllocateBuffer, buffer, &contents, fileSize)){
+        return (ULIB_NULL);
+    }
+    return (contents);
+}
+
+void UlibFileBufferFree(ulib_file_buffer* buffer){
+    ULIB_FREE(buffer->data);
+    buffer->capacity = 0;
+}
+
+ulib__uint8 _tWriteEntireFile(IN const _TCHAR* fileName,
+                              IN const ulib__uint8* buffer,
+                              IN const ulib__SizeType count){
+    ulib_file_segment segment;
+    segment.data = buffer;
+    segment.size = count;
+    return (_tWriteEntireFileV(fileName, &segment, 1u, 0));
+}
+
+// Room for fileName and a suffix, the caller frees it
+static _TCHAR* WriteNameBuffer(const _TCHAR* fileName){
+    _TCHAR* name = (_TCHAR*)malloc((_tcslen(fileName) + 32u) * sizeof(_TCHAR));
+    if (name == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+    }
+    return (name);
+}
+
+// The two chunk buffers, the caller's or allocated
+static ulib__uint8 ReaderBuffers(ulib_file_reader* reader,
+                                 const ulib__SizeType chunkSize,
+                                 ulib__uint8* buffer){
+    reader->chunkSize = chunkSize ? chunkSize : ULIB_READER_CHUNK;
+#ifdef _WIN32
+    // ReadFile takes a DWORD
+    if (reader->chunkSize > 0x40000000u){
+        reader->chunkSize = 0x40000000u;
+    }
+#endif
+    reader->ownBuffer = buffer ? ULIB_FALSE : ULIB_TRUE;
+    if (buffer == ULIB_NULL){
+        buffer = (ulib__uint8*)malloc(2u * reader->chunkSize);
+        if (buffer == ULIB_NULL){
+            ulibError = ULIB_MALLOC_ERROR;
+            return (ULIB_MALLOC_ERROR);
+        }
+    }
+    reader->buffers[0] = buffer;
+    reader->buffers[1] = buffer + reader->chunkSize;
+    reader->next = 0;
+    reader->offset = 0;
+    reader->status = ULIB_SUCCESS;
+    return (ULIB_SUCCESS);
+}
+
+#ifdef _WIN32
+// Reads the file into memory with a 0 after it
+static ulib__bool MapCopy(ulib_file_view* view, HANDLE file){
+    ulib__uint8* contents = (ulib__uint8*)malloc(view->size + 1u);
+    ulib__SizeType done = 0;
+    DWORD chunk;
+    DWORD readCount;
+    if (contents == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_ERROR);
+    }
+    while (done < view->size){
+        chunk = (view->size - done) < 0x40000000u ? (DWORD)(view->size - done) : 0x40000000u;
+        if (ReadFile(file, contents + done, chunk, &readCount, ULIB_NULL) == 0 ||
+            readCount == 0){
+            free(contents);
+            ulibError = ULIB_ERROR;
+            return (ULIB_ERROR);
+        }
+        done += readCount;
+    }
+    contents[view->size] = 0;
+    view->base = contents;
+    view->data = contents;
+    return (ULIB_SUCCESS);
+}
+
+ulib__uint8 UlibMapFile(ulib_file_view* view,
+                        const _TCHAR* fileName,
+                        const ulib__uint32 flags){
+    SYSTEM_INFO info;
+    LARGE_INTEGER size;
+    HANDLE mapping;
+    HANDLE file;
+    ulib__bool result;
+    view->data = ulibEmptyFile;
+    view->size = 0;
+    view->base = ULIB_NULL;
+    view->mapSize = 0;
+    file = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, ULIB_NULL, OPEN_EXISTING,
+                      (flags & ULIB_MAP_SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN :
+                      (flags & ULIB_MAP_RANDOM) ? FILE_FLAG_RANDOM_ACCESS :
+                      FILE_ATTRIBUTE_NORMAL, ULIB_NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        ulibError = ULIB_FILE_NOT_FOUND;
+        return (ULIB_FILE_NOT_FOUND);
+    }
+    if (GetFileSizeEx(file, &size) == 0 ||
+        (ulib__uint64)size.QuadPart >= (ulib__uint64)(ulib__SizeType)-1){
+        CloseHandle(file);
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    view->size = (ulib__SizeType)size.QuadPart;
+    if (view->size == 0){
+        CloseHandle(file);
+        return (ULIB_SUCCESS);
+    }
+    GetSystemInfo(&info);
+    if ((flags & ULIB_MAP_TERMINATED) && view->size % info.dwPageSize == 0){
+        // No room for the 0 in the last page
+        result = MapCopy(view, file);
+        CloseHandle(file);
+        return (result);
+    }
+    // The view keeps the mapping and the file open
+    mapping = CreateFileMapping(file, ULIB_NULL, PAGE_READONLY, 0, 0, ULIB_NULL);
+    CloseHandle(file);
+    if (mapping == ULIB_NULL){
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    view->base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view->base == ULIB_NULL){
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    view->mapSize = view->size;
+    view->data = (const ulib__uint8*)view->base;
+    return (ULIB_SUCCESS);
+}
+
+void UlibUnmapFile(ulib_file_view* view){
+    if (view->mapSize){
+        UnmapViewOfFile(view->base);
+    }
+    else{
+        free(view->base);
+    }
+    view->data = ULIB_NULL;
+    view->size = 0;
+    view->base = ULIB_NULL;
+    view->mapSize = 0;
+}
+
+// Starts reading the chunk at reader->offset into the next buffer
+static void ReaderStart(ulib_file_reader* reader){
+    ulib__uint64 left = reader->size - reader->offset;
+    DWORD bytes = left < reader->chunkSize ? (DWORD)left : (DWORD)reader->chunkSize;
+    reader->pending.Offset = (DWORD)reader->offset;
+    reader->pending.OffsetHigh = (DWORD)(reader->offset >> 32);
+    if (ReadFile(reader->file, reader->buffers[reader->next], bytes, ULIB_NULL,
+                 &reader->pending) == 0 && GetLastError() != ERROR_IO_PENDING){
+        reader->status = ULIB_ERROR;
+        ulibError = ULIB_ERROR;
+        return;
+    }
+    reader->reading = ULIB_TRUE;
+}
+
+ulib__uint8 UlibFileReaderOpen(ulib_file_reader* reader,
+                               const _TCHAR* fileName,
+                               const ulib__SizeType chunkSize,
+                               ulib__uint8* buffer){
+    LARGE_INTEGER size;
+    ulib__uint8 result;
+    memset(&reader->pending, 0, sizeof(reader->pending));
+    reader->reading = ULIB_FALSE;
+    reader->file = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, ULIB_NULL,
+                              OPEN_EXISTING, FILE_FLAG_OVERLAPPED |
+                              FILE_FLAG_SEQUENTIAL_SCAN, ULIB_NULL);
+    if (reader->file == INVALID_HANDLE_VALUE){
+        ulibError = ULIB_FILE_NOT_FOUND;
+        return (ULIB_FILE_NOT_FOUND);
+    }
+    reader->pending.hEvent = CreateEvent(ULIB_NULL, TRUE, FALSE, ULIB_NULL);
+    if (GetFileSizeEx(reader->file, &size) == 0 || reader->pending.hEvent == ULIB_NULL){
+        if (reader->pending.hEvent){
+            CloseHandle(reader->pending.hEvent);
+        }
+        CloseHandle(reader->file);
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    result = ReaderBuffers(reader, chunkSize, buffer);
+    if (result){
+        CloseHandle(reader->pending.hEvent);
+        CloseHandle(reader->file);
+        return (result);
+    }
+    reader->size = (ulib__uint64)size.QuadPart;
+    if (reader->size){
+        ReaderStart(reader);
+    }
+    return (ULIB_SUCCESS);
+}
+
+ulib__SizeType UlibFileReaderNext(ulib_file_reader* reader,
+                                  const ulib__uint8** chunk,
+                                  ulib__uint64* offset){
+    DWORD bytes = 0;
+    if (reader->reading == ULIB_FALSE){
+        return (0);
+    }
+    reader->reading = ULIB_FALSE;
+    if (GetOverlappedResult(reader->file, &reader->pending, &bytes, TRUE) == 0){
+        // Made shorter while it is read
+        if (GetLastError() != ERROR_HANDLE_EOF){
+            reader->status = ULIB_ERROR;
+            ulibError = ULIB_ERROR;
+        }
+        return (0);
+    }
+    if (bytes == 0){
+        return (0);
+    }
+    *chunk = reader->buffers[reader->next];
+    *offset = reader->offset;
+    reader->offset += bytes;
+    reader->next ^= 1u;
+    // The next chunk goes to the other buffer while the caller uses this one
+    if (reader->offset < reader->size){
+        ReaderStart(reader);
+    }
+    return ((ulib__SizeType)bytes);
+}
+
+void UlibFileReaderClose(ulib_file_reader* reader){
+    DWORD bytes;
+    if (reader->reading){
+        // The buffer is written until the read is done
+        CancelIo(reader->file);
+        GetOverlappedResult(reader->file, &reader->pending, &bytes, TRUE);
+        reader->reading = ULIB_FALSE;
+    }
+    CloseHandle(reader->pending.hEvent);
+    CloseHandle(reader->file);
+    if (reader->ownBuffer){
+        free(reader->buffers[0]);
+    }
+    reader->buffers[0] = ULIB_NULL;
+    reader->buffers[1] = ULIB_NULL;
+}
+
+// WriteFile of every segment, in pieces a DWORD can count
+static ulib__bool WriteSegments(HANDLE file,
+                                const ulib_file_segment* segments,
+                                const ulib__SizeType count){
+    const ulib__uint8* data;
+    ulib__SizeType left;
+    ulib__SizeType i;
+    DWORD chunk;
+    DWORD written;
+    for (i = 0; i < count; ++i){
+        data = (const ulib__uint8*)segments[i].data;
+        left = segments[i].size;
+        while (left){
+            chunk = left < 0x40000000u ? (DWORD)left : 0x40000000u;
+            if (WriteFile(file, data, chunk, &written, ULIB_NULL) == 0 || written == 0){
+                return (ULIB_ERROR);
+            }
+            data += written;
+            left -= written;
+        }
+    }
+    return (ULIB_SUCCESS);
+}
+
+ulib__uint8 _tWriteEntireFileV(const _TCHAR* fileName,
+                               const ulib_file_segment* segments,
+                               const ulib__SizeType count,
+                               const ulib__uint32 flags){
+    _TCHAR* temp = ULIB_NULL;
+    HANDLE file = INVALID_HANDLE_VALUE;
+    ulib__bool result;
+    ulib__uint32 i;
+    if ((flags & ULIB_WRITE_ATOMIC) == 0){
+        file = CreateFile(fileName, GENERIC_WRITE, 0, ULIB_NULL, CREATE_ALWAYS,
+                          FILE_ATTRIBUTE_NORMAL, ULIB_NULL);
+    }
+    else{
+        temp = WriteNameBuffer(fileName);
+        if (temp == ULIB_NULL){
+            return (ULIB_ERROR);
+        }
+        // A name nobody else uses, another writer of fileName takes the next
+        for (i = 0; i < ULIB_WRITE_TRIES && file == INVALID_HANDLE_VALUE; ++i){
+            _stprintf(temp, _T("%s.%lu.%u.tmp"), fileName,
+                      (unsigned long)GetCurrentProcessId(), i);
+            file = CreateFile(temp, GENERIC_WRITE, 0, ULIB_NULL, CREATE_NEW,
+                              FILE_ATTRIBUTE_NORMAL, ULIB_NULL);
+            if (file == INVALID_HANDLE_VALUE && GetLastError() != ERROR_FILE_EXISTS){
+                break;
+            }
+        }
+    }
+    if (file == INVALID_HANDLE_VALUE){
+        free(temp);
+        return (ULIB_ERROR);
+    }
+    result = WriteSegments(file, segments, count);
+    if (result == ULIB_SUCCESS && (flags & ULIB_WRITE_SYNC) && FlushFileBuffers(file) == 0){
+        result = ULIB_ERROR;
+    }
+    CloseHandle(file);
+    if (temp){
+        if (result == ULIB_SUCCESS &&
+            MoveFileEx(temp, fileName, MOVEFILE_REPLACE_EXISTING |
+                       ((flags & ULIB_WRITE_SYNC) ? MOVEFILE_WRITE_THROUGH : 0)) == 0){
+            result = ULIB_ERROR;
+        }
+        if (result != ULIB_SUCCESS){
+            DeleteFile(temp);
+        }
+        free(temp);
+    }
+    return (result);
+}
+#else
+// madvise hints, they are only hints and their errors are ignored
+static void MapAdvise(void* base, const ulib__SizeType size, const ulib__uint32 flags){
+    if (flags & ULIB_MAP_SEQUENTIAL){
+        madvise(base, size, MADV_SEQUENTIAL);
+    }
+    if (flags & ULIB_MAP_RANDOM){
+        madvise(base, size, MADV_RANDOM);
+    }
+#ifdef MADV_HUGEPAGE
+    if (flags & ULIB_MAP_HUGEPAGE){
+        madvise(base, size, MADV_HUGEPAGE);
+    }
+#endif
+    if (flags & ULIB_MAP_WILLNEED){
+        madvise(base, size, MADV_WILLNEED);
+    }
+}
+
+ulib__uint8 UlibMapFile(ulib_file_view* view,
+                        const _TCHAR* fileName,
+                        const ulib__uint32 flags){
+    ulib__SizeType page = (ulib__SizeType)sysconf(_SC_PAGESIZE);
+    struct stat st;
+    void* base;
+    int file;
+    view->data = ulibEmptyFile;
+    view->size = 0;
+    view->base = ULIB_NULL;
+    view->mapSize = 0;
+    file = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (file == -1){
+        ulibError = ULIB_FILE_NOT_FOUND;
+        return (ULIB_FILE_NOT_FOUND);
+    }
+    if (fstat(file, &st) != 0 ||
+        (ulib__uint64)st.st_size > (ulib__uint64)((ulib__SizeType)-1 - page)){
+        close(file);
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    view->size = (ulib__SizeType)st.st_size;
+    if (view->size == 0){
+        close(file);
+        return (ULIB_SUCCESS);
+    }
+    view->mapSize = view->size;
+    base = ULIB_NULL;
+    if ((flags & ULIB_MAP_TERMINATED) && view->size % page == 0){
+        // No room for the 0 in the last page. A page of zeros is reserved
+        // after the file, and the file is mapped over the rest.
+        view->mapSize += page;
+        base = mmap(ULIB_NULL, view->mapSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED){
+            close(file);
+            ulibError = ULIB_ERROR;
+            return (ULIB_ERROR);
+        }
+    }
+    // The mapping keeps the file open
+    view->base = mmap(base, view->size, PROT_READ,
+                      base ? MAP_SHARED | MAP_FIXED : MAP_SHARED, file, 0);
+    close(file);
+    if (view->base == MAP_FAILED){
+        if (base){
+            munmap(base, view->mapSize);
+        }
+        view->base = ULIB_NULL;
+        view->mapSize = 0;
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    MapAdvise(view->base, view->size, flags);
+    view->data = (const ulib__uint8*)view->base;
+    return (ULIB_SUCCESS);
+}
+
+void UlibUnmapFile(ulib_file_view* view){
+    if (view->mapSize){
+        munmap(view->base, view->mapSize);
+    }
+    view->data = ULIB_NULL;
+    view->size = 0;
+    view->base = ULIB_NULL;
+    view->mapSize = 0;
+}
+
+ulib__uint8 UlibFileReaderOpen(ulib_file_reader* reader,
+                               const _TCHAR* fileName,
+                               const ulib__SizeType chunkSize,
+                               ulib__uint8* buffer){
+    struct stat st;
+    ulib__uint8 result;
+    reader->file = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (reader->file == -1){
+        ulibError = ULIB_FILE_NOT_FOUND;
+        return (ULIB_FILE_NOT_FOUND);
+    }
+    if (fstat(reader->file, &st) != 0){
+        close(reader->file);
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    result = ReaderBuffers(reader, chunkSize, buffer);
+    if (result){
+        close(reader->file);
+        return (result);
+    }
+    reader->size = (ulib__uint64)st.st_size;
+#ifdef POSIX_FADV_SEQUENTIAL
+    // A bigger read ahead, and the first chunk is on its way
+    posix_fadvise(reader->file, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(reader->file, 0, (off_t)reader->chunkSize, POSIX_FADV_WILLNEED);
+#endif
+    return (ULIB_SUCCESS);
+}
+
+ulib__SizeType UlibFileReaderNext(ulib_file_reader* reader,
+                                  const ulib__uint8** chunk,
+                                  ulib__uint64* offset){
+    ulib__uint8* buffer = reader->buffers[reader->next];
+    ulib__uint64 left;
+    ulib__SizeType wanted;
+    ulib__SizeType done = 0;
+    ssize_t bytes;
+    if (reader->status != ULIB_SUCCESS || reader->offset >= reader->size){
+        return (0);
+    }
+    left = reader->size - reader->offset;
+    wanted = left < reader->chunkSize ? (ulib__SizeType)left : reader->chunkSize;
+#ifdef POSIX_FADV_WILLNEED
+    // The kernel reads the chunk after this one while the caller uses it
+    if (left > wanted){
+        posix_fadvise(reader->file, (off_t)(reader->offset + wanted),
+                      (off_t)reader->chunkSize, POSIX_FADV_WILLNEED);
+    }
+#endif
+    while (done < wanted){
+        bytes = pread(reader->file, buffer + done, wanted - done,
+                      (off_t)(reader->offset + done));
+        if (bytes > 0){
+            done += (ulib__SizeType)bytes;
+        }
+        else if (bytes == 0){
+            // Made shorter while it is read
+            reader->size = reader->offset + done;
+            break;
+        }
+        else if (errno != EINTR){
+            reader->status = ULIB_ERROR;
+            ulibError = ULIB_ERROR;
+            return (0);
+        }
+    }
+    if (done == 0){
+        return (0);
+    }
+    *chunk = buffer;
+    *offset = reader->offset;
+    reader->offset += done;
+    reader->next ^= 1u;
+    return (done);
+}
+
+// writev of the segments, as many as fit in one call, until all are written
+static ulib__bool WriteSegments(int file,
+                                const ulib_file_segment* segments,
+                                const ulib__SizeType count){
+    struct iovec iov[ULIB_WRITE_IOV];
+    ulib__SizeType index = 0;   // First segment not written
+    ulib__SizeType done = 0;    // Bytes of it written
+    ulib__SizeType left;
+    ulib__SizeType i;
+    int n;
+    ssize_t bytes;
+    for (;;){
+        while (index < count && done == segments[index].size){
+            ++index;
+            done = 0;
+        }
+        if (index == count){
+            return (ULIB_SUCCESS);
+        }
+        n = 0;
+        for (i = index; i < count && n < (int)ULIB_WRITE_IOV; ++i){
+            if (segments[i].size > (i == index ? done : 0)){
+                iov[n].iov_base = (ulib__uint8*)segments[i].data + (i == index ? done : 0);
+                iov[n].iov_len = segments[i].size - (i == index ? done : 0);
+                ++n;
+            }
+        }
+        bytes = writev(file, iov, n);
+        if (bytes <= 0){
+            if (bytes == -1 && errno == EINTR){
+                continue;
+            }
+            return (ULIB_ERROR);
+        }
+        // A short write ends in the middle of a segment
+        while (bytes > 0){
+            left = segments[index].size - done;
+            if ((ulib__SizeType)bytes < left){
+                done += (ulib__SizeType)bytes;
+                bytes = 0;
+            }
+            else{
+                bytes -= (ssize_t)left;
+                ++index;
+                done = 0;
+            }
+        }
+    }
+}
+
+// The rename is on the disk once the directory is
+static void SyncDirectory(const _TCHAR* fileName){
+    _TCHAR* dir = WriteNameBuffer(fileName);
+    _TCHAR* slash;
+    int file;
+    if (dir == ULIB_NULL){
+        return;
+    }
+    _tcscpy(dir, fileName);
+    slash = strrchr(dir, '/');
+    if (slash == ULIB_NULL){
+        _tcscpy(dir, ".");
+    }
+    else{
+        slash[slash == dir ? 1 : 0] = '\0';
+    }
+    file = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (file != -1){
+        fsync(file);
+        close(file);
+    }
+    free(dir);
+}
+
+ulib__uint8 _tWriteEntireFileV(const _TCHAR* fileName,
+                               const ulib_file_segment* segments,
+                               const ulib__SizeType count,
+                               const ulib__uint32 flags){
+    _TCHAR* temp = ULIB_NULL;
+    struct stat st;
+    int file = -1;
+    ulib__bool result;
+    ulib__uint32 i;
+    if ((flags & ULIB_WRITE_ATOMIC) == 0){
+        file = open(fileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    }
+    else{
+        temp = WriteNameBuffer(fileName);
+        if (temp == ULIB_NULL){
+            return (ULIB_ERROR);
+        }
+        // A name nobody else uses, another writer of fileName takes the next
+        for (i = 0; i < ULIB_WRITE_TRIES && file == -1; ++i){
+            sprintf(temp, "%s.%lu.%u.tmp", fileName, (unsigned long)getpid(), i);
+            file = open(temp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+            if (file == -1 && errno != EEXIST){
+                break;
+            }
+        }
+        // The new file keeps the permissions of the old one
+        if (file != -1 && stat(fileName, &st) == 0){
+            fchmod(file, st.st_mode & 07777);
+        }
+    }
+    if (file == -1){
+        free(temp);
+        return (ULIB_ERROR);
+    }
+    result = WriteSegments(file, segments, count);
+    if (result == ULIB_SUCCESS && (flags & ULIB_WRITE_SYNC) && fdatasync(file) != 0){
+        result = ULIB_ERROR;
+    }
+    if (close(file) != 0){
+        result = ULIB_ERROR;
+    }
+    if (temp){
+        if (result == ULIB_SUCCESS && rename(temp, fileName) != 0){
+            result = ULIB_ERROR;
+        }
+        if (result != ULIB_SUCCESS){
+            unlink(temp);
+        }
+        else if (flags & ULIB_WRITE_SYNC){
+            SyncDirectory(fileName);
+        }
+        free(temp);
+    }
+    return (result);
+}
+
+void UlibFileReaderClose(ulib_file_reader* reader){
+    close(reader->file);
+    if (reader->ownBuffer){
+        free(reader->buffers[0]);
+    }
+    reader->buffers[0] = ULIB_NULL;
+    reader->buffers[1] = ULIB_NULL;
+}
+#endif // #ifdef _WIN32
+#endif // #ifdef IMPLEMENTATION
+#ifdef __cplusplus // namespace ulib{
+}
+#endif
+#endif // #ifndef ulib_file_io_h
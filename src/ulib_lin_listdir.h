@@ -0,0 +1,461 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  Linux backend of ListDir, see ulib_listdir.h
+*  Directories are read with getdents64 into a buffer shared by the walk,
+*  and opened with openat relative to their parent, so the kernel never
+*  resolves full paths. The entry type and inode come from the record, stat
+*  is only called for file systems that don't fill d_type, or by DirStat()
+*  (statx) when the entry metadata is asked for.
+* NOTES:
+*   1. Symbolic links are reported as files and are not followed.
+*   2. Every directory on the current path keeps an open descriptor. When
+*      they run out, the sequential walk closes the oldest ones with
+*      DirRelease() and opens them again by path with DirReopen().
+*   3. Include ulib_listdir.h, this file only holds the backend.
+***********************************************************************************/
+#ifndef _ulib_listdir_h_
+// Included directly, ulib_listdir.h includes this file back
+#include "ulib_listdir.h"
+#elif !defined(_ulib_lin_listdir_h_)
+#define _ulib_lin_listdir_h_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+#ifdef __cplusplus
+namespace ulib {
+#endif
+
+// Bytes read by one getdents64 call
+#ifndef ULIB_LISTDIR_DENTS_SIZE
+#define ULIB_LISTDIR_DENTS_SIZE (32u * ULIB_KILOBYTE)
+#endif
+
+#define ULIB_DIR_SEPARATOR  _T('/')
+#define ULIB_IS_DIR_SEPARATOR(c) ((c) == _T('/'))
+#define ULIB_DIR_PATH_EXTRA 1u   // Room DirOpen needs after the path
+#define ULIB_NO_DIR_HANDLE  (-1)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    // Record returned by getdents64, glibc has no declaration for it
+    typedef struct ulib_dirent64_
+    {
+        ulib__uint64   d_ino;
+        ulib__int64    d_off;
+        ulib__uint16   d_reclen;
+        ulib__uint8    d_type;
+        char           d_name[1];
+    }ulib_dirent64;
+
+    typedef int dir_handle;
+
+    // An open directory being read, its records are in the dir_buffer
+    typedef struct dir_reader_
+    {
+        dir_handle     handle;
+        ulib__uint32   position;    // Next record in dents
+        ulib__uint32   bytes;       // Bytes in dents
+        ulib__uint32   stashed;     // Bytes in the stash while suspended
+        ulib__bool     error;       // getdents64 failed, the listing is not complete
+        ulib__int64    offset;      // Where a released handle stopped reading
+    }dir_reader;
+
+    // Read buffer shared by the readers of one walk. The records a reader
+    // has not returned yet are moved to the stash while it is suspended.
+    typedef struct dir_buffer_
+    {
+        ulib__uint8*   dents;       // ULIB_LISTDIR_DENTS_SIZE bytes
+        ulib__uint8*   stash;
+        ulib__SizeType stashSize;
+        ulib__SizeType stashUsed;
+        ulib__uint64   systemCalls; // Made by the readers, for benchmarks
+    }dir_buffer;
+
+    // Entry returned by DirNext, valid until the next call.
+    // size and the times are set by DirStat, the key by DirStat or DirKey.
+    typedef struct dir_entry_
+    {
+        _TCHAR*        name;
+        ulib__SizeType nameLength;
+        ulib__bool     isDir;
+        ulib__uint8    type;        // ULIB_ENTRY_FILE, ...
+        ulib__uint64   fileId;      // Inode
+        ulib__uint64   size;
+        ulib__int64    modifiedTime;
+        ulib__int64    creationTime;
+        ulib__bool     keyed;       // keyDevice, keyId and links are set
+        ulib__uint32   keyDevice;   // Device of the mounted file system
+        ulib__uint64   keyId;       // Inode, of the mounted root on a mount point
+        ulib__uint32   links;
+    }dir_entry;
+#ifdef __cplusplus
+}
+#endif
+
+/* ========================================================================= */
+#ifdef IMPLEMENTATION
+static ulib__bool DirBufferInit(dir_buffer* b){
+    // malloc alignment is enough for the 8 byte aligned records
+    b->dents = (ulib__uint8*)malloc(ULIB_LISTDIR_DENTS_SIZE);
+    b->stash = ULIB_NULL;
+    b->stashSize = 0;
+    b->stashUsed = 0;
+    b->systemCalls = 0;
+    if (b->dents == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_ERROR);
+    }
+    return (ULIB_SUCCESS);
+}
+
+static void DirBufferFree(dir_buffer* b){
+    free(b->dents);
+    free(b->stash);
+    b->dents = ULIB_NULL;
+    b->stash = ULIB_NULL;
+}
+
+// What a failed open means for the walk. A directory that is gone or
+// can't be read is skipped, other errors set ulibError and end the walk.
+static ulib__uint8 DirOpenError(void){
+    switch (errno){
+    case EACCES:
+    case EPERM:
+    case ENOENT:
+    case ENOTDIR:
+    case ELOOP:
+        return (ULIB_FILE_NOT_FOUND);
+    case EMFILE:
+    case ENFILE:
+        ulibError = ULIB_TOO_MANY_OPEN_FILES;
+        return (ULIB_ERROR);
+    default:
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+}
+
+// Opens name in the parent directory, or path if there is no parent.
+// path has pathLength chars, and room for ULIB_DIR_PATH_EXTRA more.
+// Returns ULIB_FILE_NOT_FOUND for a directory to skip, see DirOpenError().
+static ulib__uint8 DirOpen(dir_reader* r,
+                          dir_buffer* b,
+                          const dir_handle parent,
+                          const _TCHAR* name,
+                          _TCHAR* path,
+                          const ulib__SizeType pathLength){
+    if (parent == ULIB_NO_DIR_HANDLE){
+        // The root directory "/" is passed as ""
+        r->handle = open(pathLength ? path : "/", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    else{
+        r->handle = openat(parent, name,
+                           O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    r->position = 0;
+    r->bytes = 0;
+    r->stashed = 0;
+    r->error = ULIB_FALSE;
+    if (r->handle == -1){
+        ++b->systemCalls;
+        return (DirOpenError());
+    }
+    // The close is counted with the open
+    b->systemCalls += 2u;
+    return (ULIB_SUCCESS);
+}
+
+static ulib__uint8 EntryType(const mode_t mode){
+    if (S_ISREG(mode)){
+        return (ULIB_ENTRY_FILE);
+    }
+    if (S_ISDIR(mode)){
+        return (ULIB_ENTRY_DIR);
+    }
+    return (S_ISLNK(mode) ? ULIB_ENTRY_LINK : ULIB_ENTRY_OTHER);
+}
+
+// Next entry of the directory, ULIB_FALSE when there are no more or when
+// the read failed, then r->error is set
+static ulib__bool DirNext(dir_reader* r, dir_buffer* b, dir_entry* entry){
+    ulib_dirent64* d;
+    struct stat st;
+    long bytes;
+    for (;;){
+        if (r->position >= r->bytes){
+            if (r->handle == ULIB_NO_DIR_HANDLE){
+                // Released and gone before DirReopen(), the stash was the rest
+                return (ULIB_FALSE);
+            }
+            bytes = syscall(SYS_getdents64, r->handle, b->dents, ULIB_LISTDIR_DENTS_SIZE);
+            ++b->systemCalls;
+            if (bytes < 0){
+                r->error = ULIB_TRUE;
+                ulibError = ULIB_ERROR;
+                return (ULIB_FALSE);
+            }
+            if (bytes == 0){
+                return (ULIB_FALSE);
+            }
+            r->bytes = (ulib__uint32)bytes;
+            r->position = 0;
+        }
+        d = (ulib_dirent64*)(b->dents + r->position);
+        r->position += d->d_reclen;
+        if (d->d_name[0] == '.' && (d->d_name[1] == '\0' ||
+            (d->d_name[1] == '.' && d->d_name[2] == '\0'))){
+            continue;
+        }
+        entry->name = d->d_name;
+        entry->nameLength = strlen(d->d_name);
+        entry->fileId = d->d_ino;
+        switch (d->d_type){
+        case DT_REG: entry->type = ULIB_ENTRY_FILE; break;
+        case DT_DIR: entry->type = ULIB_ENTRY_DIR; break;
+        case DT_LNK: entry->type = ULIB_ENTRY_LINK; break;
+        case DT_UNKNOWN:
+            ++b->systemCalls;
+            entry->type = fstatat(r->handle, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 ?
+                          EntryType(st.st_mode) : ULIB_ENTRY_OTHER;
+            break;
+        default: entry->type = ULIB_ENTRY_OTHER; break;
+        }
+        entry->isDir = (entry->type == ULIB_ENTRY_DIR) ? ULIB_TRUE : ULIB_FALSE;
+        entry->keyed = ULIB_FALSE;
+        return (ULIB_TRUE);
+    }
+}
+
+// The kernel device number in 32 bits: 12 bits major, 20 bits minor
+static ULIB_INLINE ulib__uint32 DeviceKey(const ulib__uint32 major, const ulib__uint32 minor){
+    return ((major << 20u) | (minor & 0xFFFFFu));
+}
+
+static ULIB_INLINE void StatKey(const struct stat* st, dir_entry* entry){
+    entry->keyDevice = DeviceKey(major(st->st_dev), minor(st->st_dev));
+    entry->keyId = st->st_ino;
+    entry->links = (ulib__uint32)st->st_nlink;
+    entry->keyed = ULIB_TRUE;
+}
+
+#ifdef STATX_BASIC_STATS
+static ULIB_INLINE void StatxKey(const struct statx* stx, dir_entry* entry){
+    entry->keyDevice = DeviceKey(stx->stx_dev_major, stx->stx_dev_minor);
+    entry->keyId = stx->stx_ino;
+    entry->links = stx->stx_nlink;
+    entry->keyed = ULIB_TRUE;
+}
+#endif
+
+// Device, inode and link count of the entry, links are not followed. path
+// is not used, the entry is found in the directory of r.
+static ULIB_INLINE ulib__bool DirKey(dir_reader* r,
+                                     dir_buffer* b,
+                                     dir_entry* entry,
+                                     const _TCHAR* path){
+#ifdef STATX_BASIC_STATS
+    struct statx stx;
+#endif
+    struct stat st;
+    ULIB_UNUSED(path);
+    if (entry->keyed){
+        return (ULIB_SUCCESS);
+    }
+#ifdef STATX_BASIC_STATS
+    ++b->systemCalls;
+    if (statx(r->handle, entry->name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT |
+              AT_STATX_DONT_SYNC, STATX_INO | STATX_NLINK, &stx) == 0){
+        StatxKey(&stx, entry);
+        return (ULIB_SUCCESS);
+    }
+#endif
+    ++b->systemCalls;
+    if (fstatat(r->handle, entry->name, &st, AT_SYMLINK_NOFOLLOW) == 0){
+        StatKey(&st, entry);
+        return (ULIB_SUCCESS);
+    }
+    return (ULIB_ERROR);
+}
+
+// DirKey() of the directory at path, as open() finds it
+static ULIB_INLINE ulib__bool PathKey(const _TCHAR* path, dir_entry* entry){
+    struct stat st;
+    if (stat(*path ? path : "/", &st) != 0){
+        return (ULIB_ERROR);
+    }
+    StatKey(&st, entry);
+    return (ULIB_SUCCESS);
+}
+
+// Type, inode, key, size and modified time of the file at path, links
+// are not followed
+static ULIB_INLINE ulib__bool PathStat(const _TCHAR* path, dir_entry* entry){
+    struct stat st;
+    if (lstat(path, &st) != 0){
+        return (ULIB_ERROR);
+    }
+    entry->type = EntryType(st.st_mode);
+    entry->isDir = (entry->type == ULIB_ENTRY_DIR) ? ULIB_TRUE : ULIB_FALSE;
+    entry->fileId = st.st_ino;
+    StatKey(&st, entry);
+    entry->size = (ulib__uint64)st.st_size;
+    entry->modifiedTime = (ulib__int64)st.st_mtim.tv_sec * 1000000000 +
+                          st.st_mtim.tv_nsec;
+    entry->creationTime = 0;
+    return (ULIB_SUCCESS);
+}
+
+// Reads the size, times and key of the entry, with statx where the C
+// library has it. Links are not followed. On failure they are left 0.
+static void DirStat(dir_reader* r, dir_buffer* b, dir_entry* entry){
+#ifdef STATX_BASIC_STATS
+    struct statx stx;
+#endif
+    struct stat st;
+    entry->size = 0;
+    entry->modifiedTime = 0;
+    entry->creationTime = 0;
+#ifdef STATX_BASIC_STATS
+    ++b->systemCalls;
+    if (statx(r->handle, entry->name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT |
+              AT_STATX_DONT_SYNC, STATX_SIZE | STATX_MTIME | STATX_BTIME |
+              STATX_INO | STATX_NLINK, &stx) == 0){
+        StatxKey(&stx, entry);
+        entry->size = stx.stx_size;
+        entry->modifiedTime = (ulib__int64)stx.stx_mtime.tv_sec * 1000000000 +
+                              stx.stx_mtime.tv_nsec;
+        if (stx.stx_mask & STATX_BTIME){
+            entry->creationTime = (ulib__int64)stx.stx_btime.tv_sec * 1000000000 +
+                                  stx.stx_btime.tv_nsec;
+        }
+        return;
+    }
+#endif
+    ++b->systemCalls;
+    if (fstatat(r->handle, entry->name, &st, AT_SYMLINK_NOFOLLOW) == 0){
+        StatKey(&st, entry);
+        entry->size = (ulib__uint64)st.st_size;
+        entry->modifiedTime = (ulib__int64)st.st_mtim.tv_sec * 1000000000 +
+                              st.st_mtim.tv_nsec;
+    }
+}
+
+// Lets another reader use the buffer. The records left go to the stash,
+// a few names instead of a whole buffer per suspended directory.
+static ulib__bool DirSuspend(dir_reader* r, dir_buffer* b){
+    ulib__uint8* bigger;
+    ulib__SizeType size;
+    r->stashed = r->bytes - r->position;
+    if (r->stashed == 0){
+        // Nothing left, the stash may not be allocated yet
+        return (ULIB_SUCCESS);
+    }
+    if (b->stashUsed + r->stashed > b->stashSize){
+        size = b->stashSize ? b->stashSize : ULIB_LISTDIR_DENTS_SIZE;
+        while (size < b->stashUsed + r->stashed){
+            size <<= 1u;
+        }
+        bigger = (ulib__uint8*)realloc(b->stash, size);
+        if (bigger == ULIB_NULL){
+            ulibError = ULIB_MALLOC_ERROR;
+            return (ULIB_ERROR);
+        }
+        b->stash = bigger;
+        b->stashSize = size;
+    }
+    memcpy(b->stash + b->stashUsed, b->dents + r->position, r->stashed);
+    b->stashUsed += r->stashed;
+    return (ULIB_SUCCESS);
+}
+
+// Takes the buffer back, r must be the last suspended reader
+static void DirResume(dir_reader* r, dir_buffer* b){
+    if (r->stashed){
+        b->stashUsed -= r->stashed;
+        memcpy(b->dents, b->stash + b->stashUsed, r->stashed);
+    }
+    r->position = 0;
+    r->bytes = r->stashed;
+    r->stashed = 0;
+}
+
+// Closes the handle of a suspended reader to free a descriptor, the
+// position is kept for DirReopen()
+static ulib__bool DirRelease(dir_reader* r, dir_buffer* b){
+    off_t offset;
+    if (r->handle == ULIB_NO_DIR_HANDLE){
+        return (ULIB_SUCCESS);
+    }
+    ++b->systemCalls;
+    offset = lseek(r->handle, 0, SEEK_CUR);
+    if (offset == (off_t)-1){
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    r->offset = (ulib__int64)offset;
+    close(r->handle);
+    r->handle = ULIB_NO_DIR_HANDLE;
+    return (ULIB_SUCCESS);
+}
+
+// Opens a released reader again, path is its directory. A directory that
+// is gone leaves the handle closed, the reader ends with its stash.
+static ulib__uint8 DirReopen(dir_reader* r, dir_buffer* b, const _TCHAR* path){
+    ulib__uint8 status;
+    r->handle = open(*path ? path : "/", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (r->handle == -1){
+        ++b->systemCalls;
+        status = DirOpenError();
+        return (status == ULIB_FILE_NOT_FOUND ? ULIB_SUCCESS : status);
+    }
+    // The close is counted with the open
+    b->systemCalls += 3u;
+    if (lseek(r->handle, (off_t)r->offset, SEEK_SET) == (off_t)-1){
+        close(r->handle);
+        r->handle = ULIB_NO_DIR_HANDLE;
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+    return (ULIB_SUCCESS);
+}
+
+// Ends reading, the handle stays open for the subdirectories
+static void DirClose(dir_reader* r){
+    ULIB_UNUSED(r);
+}
+
+static void DirHandleClose(const dir_handle handle){
+    if (handle != ULIB_NO_DIR_HANDLE){
+        close(handle);
+    }
+}
+#endif // #ifdef IMPLEMENTATION
+#ifdef __cplusplus
+} /* namespace ulib{ */
+#endif
+#endif // #ifndef _ulib_lin_listdir_h_
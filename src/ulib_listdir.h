@@ -0,0 +1,1690 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  Directory listing
+*  ListDirData and the callbacks are the same on all platforms, the backend is
+*  selected by the platform:
+*   ulib_win_listdir.h - FindFirstFile / FindNextFile
+*   ulib_lin_listdir.h - openat / getdents64
+*  Example:
+*   ListDirData listDirData;
+*   INIT_LISTDIRDATA(listDirData);
+*   listDirData.processFile = FileCallBack;
+*   listDirData.dir = (_TCHAR*)_T("c:\\");
+*   listDirData.recurse = ULIB_TRUE;
+*   ListDir(&listDirData);
+* NOTES:
+*   1. With listDirData.threads > 1 the tree is walked by that many threads.
+*      Each one reads its own directories and takes subdirectories from the
+*      others when it runs out. The callbacks are then called concurrently,
+*      in no particular order, and must be thread safe. The fullPath buffer
+*      is private to the calling thread.
+*   2. ListDir() keeps no state between calls, walks can run at the same time
+*      on different threads. ListDirContextScan() keeps the buffers for
+*      repeated scans.
+*   3. processEntries gets the entries in batches, without the full path but
+*      with the metadata the directory read returned: type, inode and, with
+*      entryMetadata, size and times. On Windows the metadata is free, on
+*      Linux it takes a statx call per entry. The batches are flushed when
+*      full and at the end of the walk.
+*   4. The filters run on the entry name as it is read, before anything
+*      else is done with it: a skipped directory is not counted, reported or
+*      opened. excludePatterns apply to files and directories,
+*      includePatterns only to files, both with WildcardMatch() (* only,
+*      case sensitive). maxDepth stops the descent, recurse = ULIB_FALSE is
+*      the same as maxDepth = 1.
+*   5. ListDirOpen() / ListDirNext() / ListDirClose() walk the tree on
+*      demand, see ListDirOpen().
+*   6. With a ListDirUsage the walk adds up the file sizes, du style. The
+*      totals of a directory are complete when the directories under it
+*      are, they are then given to processUsage and added to its parent,
+*      with no second pass. Only the directories still being read hold
+*      totals, and the largest directories and files are kept in heaps of
+*      topCount items, one per thread. The sizes take a statx per file on
+*      Linux, hard linked files are counted once per link unless visitFiles
+*      is set.
+*   7. With a visited set (ulib_visited.h) a directory is looked up by its
+*      device and file id before it is opened, one found again through a
+*      bind mount or a junction is listed but not walked again. With
+*      visitFiles a file with several hard links is listed once. The key
+*      takes a statx per directory on Linux, and an open per directory and
+*      per file on Windows. Several walks can share a set, a start directory
+*      already walked is then not walked again.
+*   8. A directory that is gone or can't be read is counted but not listed.
+*      Other failures end the walk with an error: a directory read that
+*      fails, or running out of file descriptors. The sequential walk first
+*      closes the descriptors of the oldest directories on its path and
+*      opens them again by path on the way back, the parallel walk keeps
+*      them for the directories waiting to be read.
+***********************************************************************************/
+#ifndef _ulib_listdir_h_
+#define _ulib_listdir_h_
+
+#include "ulib_common.h"
+//#define ULIB_VECTOR_DEBUG
+#include "ulib_vector.h"
+#include "ulib_thread.h"
+#include "ulib_string_utils.h"
+#include "ulib_visited.h"
+
+// ListDirEntry.type
+#define ULIB_ENTRY_FILE  0u
+#define ULIB_ENTRY_DIR   1u
+#define ULIB_ENTRY_LINK  2u  // Symbolic link or reparse point, not followed
+#define ULIB_ENTRY_OTHER 3u  // Device, pipe, socket
+
+// Entries and name chars delivered by one ProcessEntries call at most
+#ifndef ULIB_LISTDIR_BATCH_SIZE
+#define ULIB_LISTDIR_BATCH_SIZE 256u
+#endif
+#ifndef ULIB_LISTDIR_BATCH_NAMES
+#define ULIB_LISTDIR_BATCH_NAMES (16u * ULIB_KILOBYTE)
+#endif
+// Longest entry name, with the NUL
+#define ULIB_LISTDIR_MAX_NAME 260u
+
+/* The backend: dir_reader, dir_buffer, dir_entry, DirBufferInit(),
+   DirBufferFree(), DirOpen(), DirNext(), DirStat(), PathStat(), DirKey(),
+   PathKey(), DirSuspend(), DirResume(), DirRelease(), DirReopen(), DirClose()
+   and DirHandleClose() */
+#ifdef _WIN32
+#include "ulib_win_listdir.h"
+#else
+#include "ulib_lin_listdir.h"
+#endif
+
+#ifdef __cplusplus
+namespace ulib {
+#endif
+
+#define INIT_LISTDIRDATA(listDirData)\
+    listDirData.processFile = ULIB_NULL;\
+    listDirData.processDirectory = ULIB_NULL;\
+    listDirData.totalFiles = 0;\
+    listDirData.totalDirs = 0;\
+    listDirData.systemCalls = 0;\
+    listDirData.dir = ULIB_NULL;\
+    listDirData.recurse = ULIB_FALSE;\
+    listDirData.memoryBudget = 0;\
+    listDirData.threads = 0;\
+    listDirData.processEntries = ULIB_NULL;\
+    listDirData.entriesContext = ULIB_NULL;\
+    listDirData.entryMetadata = ULIB_FALSE;\
+    listDirData.includePatterns = ULIB_NULL;\
+    listDirData.includeCount = 0;\
+    listDirData.excludePatterns = ULIB_NULL;\
+    listDirData.excludeCount = 0;\
+    listDirData.maxDepth = 0;\
+    listDirData.filterDirectory = ULIB_NULL;\
+    listDirData.filterContext = ULIB_NULL;\
+    listDirData.usage = ULIB_NULL;\
+    listDirData.visited = ULIB_NULL;\
+    listDirData.visitFiles = ULIB_FALSE;\
+    listDirData.shouldExit = ULIB_NULL;
+
+#define INIT_LISTDIRUSAGE(listDirUsage)\
+    memset(&(listDirUsage), 0, sizeof(listDirUsage));
+
+
+//
+// The callback for dirs and files.
+// fullPath is the file name with full path
+// fileName is only the file name
+//
+typedef void (*ProcessFileName)(_TCHAR* fullPath, _TCHAR* fileName);
+
+//
+// An entry given to ProcessEntries. Directories get an id, the entries they
+// hold have it as parentId. The start directory has id 0.
+// Times are in ns since 1970 UTC, 0 if not known.
+//
+typedef struct ListDirEntry_
+{
+    const _TCHAR*           name;             /* Only the name, valid during the callback */
+    ulib__SizeType          nameLength;
+    ulib__uint64            id;               /* Directories only, 0 for the other types */
+    ulib__uint64            parentId;
+    ulib__uint64            fileId;           /* Inode on Linux, 0 on Windows */
+    ulib__uint64            size;             /* With entryMetadata */
+    ulib__int64             modifiedTime;     /* With entryMetadata */
+    ulib__int64             creationTime;     /* With entryMetadata, where the file system keeps it */
+    ulib__uint8             type;             /* ULIB_ENTRY_FILE, ULIB_ENTRY_DIR, ... */
+}ListDirEntry;
+
+//
+// Totals of a directory and all it holds. bytes is the sum of the file
+// sizes, links and other entries count as files.
+//
+typedef struct ListDirTotals_
+{
+    ulib__uint64            bytes;
+    ulib__uint64            files;
+    ulib__uint64            dirs;
+}ListDirTotals;
+
+// One of the largest directories or files
+typedef struct ListDirUsageItem_
+{
+    _TCHAR*                 path;             /* Full path */
+    ulib__SizeType          pathSize;
+    ListDirTotals           totals;           /* A file has files = 1 */
+}ListDirUsageItem;
+
+// The largest items, a min heap during the walk, then sorted largest first
+typedef struct ListDirLargest_
+{
+    ListDirUsageItem*       items;
+    ulib__uint32            count;
+    ulib__uint32            size;             /* Items allocated */
+}ListDirLargest;
+
+//
+// Called for every directory when it and all it holds are read, after the
+// directories under it. depth is 0 for the start directory.
+//
+typedef void (*ProcessUsage)(const _TCHAR* fullPath,
+                             const ListDirTotals* totals,
+                             ulib__uint32 depth,
+                             void* context);
+
+typedef struct ListDirUsage_
+{
+IN    ulib__uint32            topCount;         /* Largest directories and files kept, 0 = none */
+IN    ProcessUsage            processUsage;     /* Directory totals, can be ULIB_NULL */
+IN    void*                   usageContext;     /* Passed to processUsage */
+OUT   ListDirTotals           total;            /* The start directory */
+OUT   ListDirLargest          largestDirs;      /* Under the start directory */
+OUT   ListDirLargest          largestFiles;
+}ListDirUsage;
+
+//
+// The batch callback. entries holds count entries of one or more
+// directories. context is ListDirData.entriesContext.
+//
+typedef void (*ProcessEntries)(const ListDirEntry* entries,
+                               ulib__SizeType count,
+                               void* context);
+
+//
+// Called for every directory before it is counted, reported or opened.
+// name is only the directory name, depth is 1 for the entries of the start
+// directory. Return ULIB_FALSE to skip the directory and all it holds.
+//
+typedef ulib__bool (*FilterDirectory)(const _TCHAR* name,
+                                      ulib__uint32 depth,
+                                      void* context);
+
+// Entries waiting for the ProcessEntries call
+typedef struct list_dir_batch_
+{
+    ListDirEntry*           entries;          /* ULIB_LISTDIR_BATCH_SIZE entries */
+    _TCHAR*                 names;            /* ULIB_LISTDIR_BATCH_NAMES chars */
+    ulib__SizeType          count;
+    ulib__SizeType          namesUsed;
+}list_dir_batch;
+
+typedef struct ListDirData_
+{
+OUT   ulib__uint64            totalFiles;       /* Total number of files */
+OUT   ulib__uint64            totalDirs;        /* Total number of dirs */
+OUT   ulib__uint64            systemCalls;      /* Made reading the tree, added as the totals */
+IN    ProcessFileName         processFile;      /* File callback */
+IN    ProcessFileName         processDirectory; /* Directory callback */
+IN    _TCHAR*                 dir;              /* Start dir */
+IN    volatile ulib__bool*    shouldExit;       /* This is a volatile byte set by CTRL-C handler */
+IN    ulib__bool              recurse;          /* Scan folders recursively */
+IN    ulib__SizeType          memoryBudget;     /* Spill the dir stack to a temp file above this size, 0 = off */
+IN    ulib__uint32            threads;          /* Walking threads, 0 or 1 walks on the calling thread */
+IN    ProcessEntries          processEntries;   /* Batch callback for files and dirs */
+IN    void*                   entriesContext;   /* Passed to processEntries */
+IN    ulib__bool              entryMetadata;    /* Fill size and times, one statx per entry on Linux */
+IN    const _TCHAR**          includePatterns;  /* Only files matching one of these are listed */
+IN    ulib__SizeType          includeCount;
+IN    const _TCHAR**          excludePatterns;  /* Files and dirs matching one of these are skipped */
+IN    ulib__SizeType          excludeCount;
+IN    ulib__uint32            maxDepth;         /* Deepest level listed, 1 = start dir only, 0 = no limit */
+IN    FilterDirectory         filterDirectory;  /* Directory veto */
+IN    void*                   filterContext;    /* Passed to filterDirectory */
+IN    ListDirUsage*           usage;            /* Disk usage totals, ULIB_NULL = off */
+IN    ulib_visited*           visited;          /* Directories walked, ULIB_NULL = off */
+IN    ulib__bool              visitFiles;       /* Hard linked files go in visited too */
+#ifndef ULIB_VECTOR_NO_STATS
+OUT   ulib_vector_stats       vectorStats;      /* Dir stack memory use, set on ULIB_SUCCESS, 0 with threads */
+#endif
+}ListDirData;
+
+// Walk state and buffers, kept between scans so a warm re-scan doesn't
+// allocate. A context is used by one scan at a time.
+typedef struct ListDirContext_
+{
+    ulib_vector             stack;            /* Open directories of the sequential walk */
+    dir_buffer              buffer;           /* Directory read buffer */
+    _TCHAR*                 path;             /* Path given to the callbacks */
+    ulib__SizeType          pathSize;
+    ulib__bool              ready;            /* stack and buffer are allocated */
+    list_dir_batch          batch;            /* Entries for processEntries */
+    struct dir_worker_*     workers;          /* State of the parallel walk threads */
+    ulib__uint32            workerCount;
+}ListDirContext;
+
+// Pull iterator over a sequential walk, see ListDirOpen()
+typedef struct ListDirIterator_
+{
+    ListDirData*            data;             /* Options, filters and totals */
+    ListDirContext*         context;          /* Buffers of the walk */
+    ListDirContext          ownContext;       /* Used when ListDirOpen() gets no context */
+    struct dir_frame_*      top;              /* Directory holding entry */
+    dir_entry               entry;            /* Last entry */
+    ulib__uint64            id;               /* ListDirEntry.id of entry */
+    ulib__uint64            nextId;
+    ulib__SizeType          released;         /* Stack frames below it have their handle closed */
+    ulib__bool              descend;          /* entry is opened by the next step */
+    ulib__bool              paths;            /* Format the full path of every entry */
+    ulib__uint8             status;           /* ULIB_SUCCESS, or the error that ended the walk */
+OUT   const _TCHAR*           fullPath;         /* Full path of the last entry, until the next call */
+}ListDirIterator;
+
+/* Public functions */
+/******************************************************************************
+* Function: ulib__bool ListDir(ListDirData* dir)
+* Parameters:
+*      Input:  ListDirData* dir
+*              The structure can contain two function pointers to be called for
+*              files and directories, and the start directory
+*      Return: ULIB_SUCCESS if successful
+*              ULIB_FILE_NOT_FOUND in case of an error - the start directory
+*              is not found
+*              ULIB_ERROR if the walk failed, ulibError has the reason:
+*              ULIB_TOO_MANY_OPEN_FILES, ULIB_MALLOC_ERROR, ...
+* NOTE: In case of an error, UlibGetSystemLastErrorString() can be used to get the
+* error formatted as string, or uint32_t dw = GetLastError() can be used to get
+* the error code. On Linux errno holds the error code.
+******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+ulib__uint8 ListDir(ListDirData* dir);
+
+/******************************************************************************
+* Function:
+*          void ListDirContextInit(OUT ListDirContext* context);
+*          ulib__uint8 ListDirContextScan(IN ListDirContext* context,
+*                                         IN OUT ListDirData* dir);
+*          void ListDirContextFree(IN ListDirContext* context);
+* ListDir() with the walk state in context. The buffers are allocated by the
+* first scan and reused by the next ones, until ListDirContextFree().
+* Independent scans can run at the same time, each with its own context.
+* Return: same as ListDir()
+******************************************************************************/
+void ListDirContextInit(OUT ListDirContext* context);
+ulib__uint8 ListDirContextScan(IN ListDirContext* context,
+                               IN OUT ListDirData* dir);
+void ListDirContextFree(IN ListDirContext* context);
+
+/******************************************************************************
+* Function:
+*          ulib__uint8 ListDirOpen(OUT ListDirIterator* it,
+*                                  IN OUT ListDirData* dir,
+*                                  IN ListDirContext* context);
+*          ulib__bool ListDirNext(IN ListDirIterator* it,
+*                                 OUT ListDirEntry* entry);
+*          ulib__SizeType ListDirNextBatch(IN ListDirIterator* it,
+*                                          OUT const ListDirEntry** entries);
+*          void ListDirClose(IN ListDirIterator* it);
+* Pull API: the walk advances only inside ListDirNext() / ListDirNextBatch(),
+* and keeps its stack between the calls, so it can be paused for as long as
+* needed with no memory growth. The options and filters of dir are used, the
+* callbacks and threads are not. context can be ULIB_NULL.
+* ListDirNext() returns one entry, it->fullPath holds its full path. The
+* name points in the full path, both are valid until the next call.
+* ListDirNextBatch() returns up to ULIB_LISTDIR_BATCH_SIZE entries, valid
+* until the next call, 0 at the end.
+* Return: ListDirOpen() as ListDir(). ListDirNext() ULIB_FALSE at the end of
+* the walk, it->status is then ULIB_SUCCESS or the error that stopped it.
+* ListDirClose() must be called after a successful ListDirOpen().
+******************************************************************************/
+ulib__uint8 ListDirOpen(OUT ListDirIterator* it,
+                        IN OUT ListDirData* dir,
+                        IN ListDirContext* context);
+ulib__bool ListDirNext(IN ListDirIterator* it,
+                       OUT ListDirEntry* entry);
+ulib__SizeType ListDirNextBatch(IN ListDirIterator* it,
+                                OUT const ListDirEntry** entries);
+void ListDirClose(IN ListDirIterator* it);
+
+/******************************************************************************
+* Function:
+*          void ListDirUsageFree(IN ListDirUsage* usage);
+* Frees the largest directories and files lists. The lists are kept between
+* scans with the same ListDirUsage.
+******************************************************************************/
+void ListDirUsageFree(IN ListDirUsage* usage);
+#ifdef __cplusplus
+}
+#endif
+
+/* ========================================================================= */
+#ifdef IMPLEMENTATION
+// Makes room for length chars in the path buffer
+static ulib__bool PathReserve(_TCHAR** path,
+                              ulib__SizeType* pathSize,
+                              const ulib__SizeType length){
+    _TCHAR* bigger;
+    ulib__SizeType size = *pathSize ? *pathSize : 256u;
+    if (length <= *pathSize){
+        return (ULIB_SUCCESS);
+    }
+    while (size < length){
+        size <<= 1u;
+    }
+    bigger = (_TCHAR*)realloc(*path, size * sizeof(_TCHAR));
+    if (bigger == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_ERROR);
+    }
+    *path = bigger;
+    *pathSize = size;
+    return (ULIB_SUCCESS);
+}
+
+// Grows a realloc array to hold count elements
+static ULIB_INLINE ulib__bool ArrayReserve(void** array,
+                                           ulib__SizeType* arraySize,
+                                           const ulib__SizeType count,
+                                           const ulib__SizeType elementSize){
+    void* bigger;
+    ulib__SizeType size = *arraySize ? *arraySize : 64u;
+    if (count <= *arraySize){
+        return (ULIB_SUCCESS);
+    }
+    while (size < count){
+        size <<= 1u;
+    }
+    bigger = realloc(*array, size * elementSize);
+    if (bigger == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_ERROR);
+    }
+    *array = bigger;
+    *arraySize = size;
+    return (ULIB_SUCCESS);
+}
+
+static void BatchFree(list_dir_batch* b){
+    ULIB_FREE(b->entries);
+    ULIB_FREE(b->names);
+}
+
+static ulib__bool BatchInit(list_dir_batch* b){
+    b->count = 0;
+    b->namesUsed = 0;
+    if (b->entries){
+        return (ULIB_SUCCESS);
+    }
+    b->entries = (ListDirEntry*)malloc(ULIB_LISTDIR_BATCH_SIZE * sizeof(ListDirEntry));
+    b->names = (_TCHAR*)malloc(ULIB_LISTDIR_BATCH_NAMES * sizeof(_TCHAR));
+    if (b->entries == ULIB_NULL || b->names == ULIB_NULL){
+        BatchFree(b);
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_ERROR);
+    }
+    return (ULIB_SUCCESS);
+}
+
+static void BatchFlush(list_dir_batch* b, ListDirData* listDirData){
+    if (b->count){
+        listDirData->processEntries(b->entries, b->count, listDirData->entriesContext);
+    }
+    b->count = 0;
+    b->namesUsed = 0;
+}
+
+// Copies the entry to the batch, the batch is flushed first if it is full
+static void BatchAdd(list_dir_batch* b,
+                     ListDirData* listDirData,
+                     dir_entry* entry,
+                     const ulib__uint64 parentId,
+                     const ulib__uint64 id){
+    ListDirEntry* e;
+    if (b->count == ULIB_LISTDIR_BATCH_SIZE ||
+        b->namesUsed + entry->nameLength + 1u > ULIB_LISTDIR_BATCH_NAMES){
+        BatchFlush(b, listDirData);
+    }
+    e = &b->entries[b->count++];
+    memcpy(&b->names[b->namesUsed], entry->name, (entry->nameLength + 1u) * sizeof(_TCHAR));
+    e->name = &b->names[b->namesUsed];
+    b->namesUsed += entry->nameLength + 1u;
+    e->nameLength = entry->nameLength;
+    e->id = id;
+    e->parentId = parentId;
+    e->fileId = entry->fileId;
+    e->size = entry->size;
+    e->modifiedTime = entry->modifiedTime;
+    e->creationTime = entry->creationTime;
+    e->type = entry->type;
+}
+
+static ulib__bool MatchAny(const _TCHAR** patterns,
+                           const ulib__SizeType count,
+                           const _TCHAR* name){
+    ulib__SizeType i;
+    for (i = 0; i < count; ++i){
+        if (WildcardMatch(patterns[i], name)){
+            return (ULIB_TRUE);
+        }
+    }
+    return (ULIB_FALSE);
+}
+
+// ULIB_TRUE if the entry, at depth, is not listed
+static ulib__bool EntrySkipped(ListDirData* listDirData,
+                               const dir_entry* entry,
+                               const ulib__uint32 depth){
+    if (listDirData->excludeCount &&
+        MatchAny(listDirData->excludePatterns, listDirData->excludeCount, entry->name)){
+        return (ULIB_TRUE);
+    }
+    if (entry->isDir){
+        return (listDirData->filterDirectory &&
+                listDirData->filterDirectory(entry->name, depth,
+                                             listDirData->filterContext) == ULIB_FALSE) ?
+               ULIB_TRUE : ULIB_FALSE;
+    }
+    return (listDirData->includeCount &&
+            !MatchAny(listDirData->includePatterns, listDirData->includeCount, entry->name)) ?
+           ULIB_TRUE : ULIB_FALSE;
+}
+
+// ULIB_TRUE if the subdirectories found at depth are opened
+static ulib__bool Descends(ListDirData* listDirData, const ulib__uint32 depth){
+    return (listDirData->recurse == ULIB_TRUE &&
+            (listDirData->maxDepth == 0 || depth < listDirData->maxDepth)) ?
+           ULIB_TRUE : ULIB_FALSE;
+}
+
+/* Disk usage */
+static void LargestFree(ListDirLargest* l){
+    ulib__uint32 i;
+    for (i = 0; i < l->size; ++i){
+        free(l->items[i].path);
+    }
+    ULIB_FREE(l->items);
+    l->count = 0;
+    l->size = 0;
+}
+
+// Empties the list and makes room for count items, the paths are kept
+static ulib__bool LargestReset(ListDirLargest* l, const ulib__uint32 count){
+    ListDirUsageItem* bigger;
+    l->count = 0;
+    if (count <= l->size){
+        return (ULIB_SUCCESS);
+    }
+    bigger = (ListDirUsageItem*)realloc(l->items, count * sizeof(ListDirUsageItem));
+    if (bigger == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_ERROR);
+    }
+    memset(&bigger[l->size], 0, (count - l->size) * sizeof(ListDirUsageItem));
+    l->items = bigger;
+    l->size = count;
+    return (ULIB_SUCCESS);
+}
+
+static void LargestSwap(ListDirLargest* l, const ulib__uint32 a, const ulib__uint32 b){
+    ListDirUsageItem swap = l->items[a];
+    l->items[a] = l->items[b];
+    l->items[b] = swap;
+}
+
+// Keeps the topCount largest items offered, items[0] is the smallest. The
+// path is dirPath, with a separator and name after it if name is given.
+static ulib__bool LargestOffer(ListDirLargest* l,
+                               const ulib__uint32 topCount,
+                               const ListDirTotals* totals,
+                               const _TCHAR* dirPath,
+                               const ulib__SizeType dirLength,
+                               const _TCHAR* name,
+                               const ulib__SizeType nameLength){
+    ListDirUsageItem* item;
+    ulib__SizeType length = dirLength + (name ? 1u + nameLength : 0u);
+    ulib__uint32 i = l->count;
+    ulib__uint32 child;
+    if (topCount == 0 || (i == topCount && totals->bytes <= l->items[0].totals.bytes)){
+        return (ULIB_SUCCESS);
+    }
+    // A full heap gives its smallest item
+    i = i == topCount ? 0 : i;
+    item = &l->items[i];
+    if (PathReserve(&item->path, &item->pathSize, length + 1u)){
+        return (ULIB_ERROR);
+    }
+    memcpy(item->path, dirPath, dirLength * sizeof(_TCHAR));
+    if (name){
+        item->path[dirLength] = ULIB_DIR_SEPARATOR;
+        memcpy(&item->path[dirLength + 1u], name, nameLength * sizeof(_TCHAR));
+    }
+    item->path[length] = _T('\0');
+    item->totals = *totals;
+    if (i == l->count){
+        // Up from the new last item
+        ++l->count;
+        while (i && l->items[(i - 1u) / 2u].totals.bytes > l->items[i].totals.bytes){
+            LargestSwap(l, i, (i - 1u) / 2u);
+            i = (i - 1u) / 2u;
+        }
+        return (ULIB_SUCCESS);
+    }
+    // Down from the replaced root
+    while ((child = 2u * i + 1u) < l->count){
+        if (child + 1u < l->count &&
+            l->items[child + 1u].totals.bytes < l->items[child].totals.bytes){
+            ++child;
+        }
+        if (l->items[i].totals.bytes <= l->items[child].totals.bytes){
+            break;
+        }
+        LargestSwap(l, i, child);
+        i = child;
+    }
+    return (ULIB_SUCCESS);
+}
+
+static int LargestCompare(const void* a, const void* b){
+    const ListDirUsageItem* x = (const ListDirUsageItem*)a;
+    const ListDirUsageItem* y = (const ListDirUsageItem*)b;
+    return (x->totals.bytes < y->totals.bytes ? 1 : x->totals.bytes > y->totals.bytes ? -1 : 0);
+}
+
+static ulib__bool UsageStart(ListDirUsage* usage){
+    memset(&usage->total, 0, sizeof(usage->total));
+    return ((LargestReset(&usage->largestDirs, usage->topCount) ||
+             LargestReset(&usage->largestFiles, usage->topCount)) ? ULIB_ERROR : ULIB_SUCCESS);
+}
+
+static void UsageEnd(ListDirUsage* usage){
+    if (usage->topCount){
+        qsort(usage->largestDirs.items, usage->largestDirs.count, sizeof(ListDirUsageItem),
+              LargestCompare);
+        qsort(usage->largestFiles.items, usage->largestFiles.count, sizeof(ListDirUsageItem),
+              LargestCompare);
+    }
+}
+
+// Counts a listed entry in the totals of its directory, a file is offered
+// to largestFiles
+static ulib__bool UsageAdd(ListDirUsage* usage,
+                           ListDirLargest* largestFiles,
+                           ListDirTotals* totals,
+                           const dir_entry* entry,
+                           const _TCHAR* dirPath,
+                           const ulib__SizeType dirLength){
+    ListDirTotals file;
+    if (entry->isDir){
+        ++totals->dirs;
+        return (ULIB_SUCCESS);
+    }
+    ++totals->files;
+    totals->bytes += entry->size;
+    file.bytes = entry->size;
+    file.files = 1u;
+    file.dirs = 0;
+    return (LargestOffer(largestFiles, usage->topCount, &file, dirPath, dirLength,
+                         entry->name, entry->nameLength));
+}
+
+// A directory and all it holds are read, path is NUL terminated
+static ulib__bool UsageDirDone(ListDirUsage* usage,
+                               ListDirLargest* largestDirs,
+                               const ListDirTotals* totals,
+                               const _TCHAR* path,
+                               const ulib__SizeType pathLength,
+                               const ulib__uint32 depth){
+    if (usage->processUsage){
+        usage->processUsage(path, totals, depth, usage->usageContext);
+    }
+    if (depth == 0){
+        usage->total = *totals;
+        return (ULIB_SUCCESS);
+    }
+    return (LargestOffer(largestDirs, usage->topCount, totals, path, pathLength, ULIB_NULL, 0));
+}
+
+// Size and times of the entry, if they are asked for
+static void EntryStat(ListDirData* listDirData,
+                      dir_reader* r,
+                      dir_buffer* buffer,
+                      dir_entry* entry){
+    if (listDirData->entryMetadata || (listDirData->usage && entry->isDir == ULIB_FALSE)){
+        DirStat(r, buffer, entry);
+    }
+    else{
+        entry->size = 0;
+        entry->modifiedTime = 0;
+        entry->creationTime = 0;
+    }
+}
+
+// Appends a separator and the entry name to the length chars of path
+static ulib__bool PathAppend(_TCHAR** path,
+                             ulib__SizeType* pathSize,
+                             const ulib__SizeType length,
+                             const dir_entry* entry){
+    if (PathReserve(path, pathSize, length + 1u + entry->nameLength + ULIB_DIR_PATH_EXTRA)){
+        return (ULIB_ERROR);
+    }
+    (*path)[length] = ULIB_DIR_SEPARATOR;
+    memcpy(&(*path)[length + 1u], entry->name, (entry->nameLength + 1u) * sizeof(_TCHAR));
+    return (ULIB_SUCCESS);
+}
+
+// ULIB_TRUE if the entry needs a visited check: a directory to walk into,
+// or a file with visitFiles
+static ULIB_INLINE ulib__bool EntryVisits(ListDirData* listDirData,
+                                          const dir_entry* entry,
+                                          const ulib__bool descend){
+    return (listDirData->visited && (descend || (entry->isDir == ULIB_FALSE &&
+                                                 listDirData->visitFiles))) ?
+           ULIB_TRUE : ULIB_FALSE;
+}
+
+// Adds the entry to the visited set, seen is ULIB_TRUE if it was there.
+// path is its full path. An entry without a key, or a file with one link,
+// is never seen. The key of an entry EntryStat() read is not read again.
+static ulib__bool EntrySeen(ListDirData* listDirData,
+                            dir_reader* r,
+                            dir_buffer* buffer,
+                            dir_entry* entry,
+                            const _TCHAR* path,
+                            ulib__bool* seen){
+    *seen = ULIB_FALSE;
+    if (DirKey(r, buffer, entry, path) || (entry->isDir == ULIB_FALSE && entry->links < 2u)){
+        return (ULIB_SUCCESS);
+    }
+    return (UlibVisitedInsert(listDirData->visited, entry->keyDevice, entry->keyId, seen));
+}
+
+// Adds the start directory to the visited set, seen is ULIB_TRUE if it was there
+static ulib__bool StartSeen(ListDirData* listDirData, const _TCHAR* path, ulib__bool* seen){
+    dir_entry entry;
+    *seen = ULIB_FALSE;
+    if (listDirData->visited == ULIB_NULL || PathKey(path, &entry)){
+        return (ULIB_SUCCESS);
+    }
+    return (UlibVisitedInsert(listDirData->visited, entry.keyDevice, entry.keyId, seen));
+}
+
+/* Sequential walk */
+// One open directory on the stack. Its path is the first pathLength chars
+// of the shared path buffer.
+typedef struct dir_frame_
+{
+    dir_reader     reader;
+    ulib__SizeType pathLength;
+    ulib__uint64   id;          // ListDirEntry.id
+    ulib__uint32   depth;       // 0 for the start directory
+    ListDirTotals  totals;      // With usage, what was read under it so far
+}dir_frame;
+
+// Allocates the buffers of the sequential walk on the first scan
+static ulib__bool ContextPrepare(ListDirContext* context){
+    if (context->ready){
+        return (ULIB_SUCCESS);
+    }
+    if (DirBufferInit(&context->buffer)){
+        DirBufferFree(&context->buffer);
+        return (ULIB_ERROR);
+    }
+    INIT_ULIB_VECTOR_FIXED(context->stack, 64u * sizeof(dir_frame), sizeof(dir_frame));
+    if (context->stack.workBuffer == ULIB_NULL){
+        DirBufferFree(&context->buffer);
+        return (ULIB_ERROR);
+    }
+    context->ready = ULIB_TRUE;
+    return (ULIB_SUCCESS);
+}
+
+// Opens the start directory
+static ulib__uint8 WalkStart(ListDirIterator* it,
+                             ListDirContext* context,
+                             ListDirData* listDirData,
+                             const ulib__bool paths){
+    dir_frame* top;
+    ulib__SizeType dirLength = _tcslen(listDirData->dir);
+    ulib__bool seen;
+    ulib__uint8 result;
+    it->data = listDirData;
+    it->context = context;
+    it->top = ULIB_NULL;
+    it->id = 0;
+    it->nextId = 0;
+    it->released = 0;
+    it->descend = ULIB_FALSE;
+    it->paths = paths;
+    it->status = ULIB_SUCCESS;
+    it->fullPath = ULIB_NULL;
+    if (ContextPrepare(context) ||
+        PathReserve(&context->path, &context->pathSize, dirLength + ULIB_DIR_PATH_EXTRA) ||
+        (listDirData->usage && UsageStart(listDirData->usage))){
+        return (ULIB_ERROR);
+    }
+    context->buffer.systemCalls = 0;
+    memcpy(context->path, listDirData->dir, (dirLength + 1u) * sizeof(_TCHAR));
+    if (listDirData->memoryBudget && context->stack.spill == ULIB_NULL){
+        // If the temp file can't be created the scan runs in memory
+        UlibVectorEnableSpill(&context->stack, ULIB_NULL, listDirData->memoryBudget);
+    }
+    // The names are appended after a separator
+    while (dirLength && ULIB_IS_DIR_SEPARATOR(context->path[dirLength - 1])){
+        context->path[--dirLength] = _T('\0');
+    }
+    if (StartSeen(listDirData, context->path, &seen)){
+        return (ULIB_ERROR);
+    }
+    if (seen){
+        // Walked by an earlier scan with the same set
+        return (ULIB_SUCCESS);
+    }
+    top = (dir_frame*)UlibVectorEmplace(&context->stack, 1u);
+    if (top == ULIB_NULL){
+        return (ULIB_ERROR);
+    }
+    result = DirOpen(&top->reader, &context->buffer, ULIB_NO_DIR_HANDLE, context->path,
+                     context->path, dirLength);
+    if (result){
+        UlibVectorPop(&context->stack, ULIB_NULL);
+        ++listDirData->systemCalls;
+        return (result);
+    }
+    top->pathLength = dirLength;
+    top->id = 0;
+    top->depth = 0;
+    memset(&top->totals, 0, sizeof(top->totals));
+    it->top = top;
+    return (ULIB_SUCCESS);
+}
+
+// Opens the directory returned by the last step
+static ulib__bool WalkDescend(ListDirIterator* it){
+    ListDirContext* context = it->context;
+    dir_frame* parent = it->top;
+    dir_frame* top;
+    dir_frame* ancestor;
+    ulib__uint8 result;
+    top = (dir_frame*)UlibVectorEmplace(&context->stack, 1u);
+    if (top == ULIB_NULL){
+        return (ULIB_ERROR);
+    }
+    // The name is in the buffer, it is opened before the parent
+    // reader gives the buffer away
+    for (;;){
+        result = DirOpen(&top->reader, &context->buffer, parent->reader.handle, it->entry.name,
+                         context->path, parent->pathLength + 1u + it->entry.nameLength);
+        if (result != ULIB_ERROR || ulibError != ULIB_TOO_MANY_OPEN_FILES ||
+            it->released + 2u >= UlibVectorCount(&context->stack)){
+            break;
+        }
+        // Out of descriptors, the oldest directory above the parent lets
+        // its handle go until the walk is back in it
+        ancestor = (dir_frame*)UlibVectorAt(&context->stack, it->released);
+        if (DirRelease(&ancestor->reader, &context->buffer)){
+            break;
+        }
+        ++it->released;
+    }
+    if (result){
+        UlibVectorPop(&context->stack, ULIB_NULL);
+        // No access, counted but not listed
+        return (result == ULIB_FILE_NOT_FOUND ? ULIB_SUCCESS : ULIB_ERROR);
+    }
+    if (DirSuspend(&parent->reader, &context->buffer)){
+        DirClose(&top->reader);
+        DirHandleClose(top->reader.handle);
+        UlibVectorPop(&context->stack, ULIB_NULL);
+        return (ULIB_ERROR);
+    }
+    top->pathLength = parent->pathLength + 1u + it->entry.nameLength;
+    top->id = it->id;
+    top->depth = parent->depth + 1u;
+    memset(&top->totals, 0, sizeof(top->totals));
+    it->top = top;
+    return (ULIB_SUCCESS);
+}
+
+// Closes the top directory, its totals go to the parent
+static ulib__bool WalkPop(ListDirIterator* it){
+    ListDirContext* context = it->context;
+    ListDirUsage* usage = it->data->usage;
+    dir_frame* top = it->top;
+    ListDirTotals totals = top->totals;
+    ulib__bool result = ULIB_SUCCESS;
+    DirClose(&top->reader);
+    DirHandleClose(top->reader.handle);
+    if (usage){
+        // The path of top, the name after it is not needed anymore
+        context->path[top->pathLength] = _T('\0');
+        result = UsageDirDone(usage, &usage->largestDirs, &totals, context->path,
+                              top->pathLength, top->depth);
+    }
+    UlibVectorPop(&context->stack, ULIB_NULL);
+    it->top = (dir_frame*)UlibVectorPeek(&context->stack, ULIB_NULL);
+    if (it->top && usage){
+        it->top->totals.bytes += totals.bytes;
+        it->top->totals.files += totals.files;
+        it->top->totals.dirs += totals.dirs;
+    }
+    return (result);
+}
+
+// Back in a directory whose handle DirRelease() closed, it is opened again
+static ulib__bool WalkReopen(ListDirIterator* it){
+    ListDirContext* context = it->context;
+    ulib__SizeType index = UlibVectorCount(&context->stack) - 1u;
+    if (index >= it->released){
+        return (ULIB_SUCCESS);
+    }
+    it->released = index;
+    context->path[it->top->pathLength] = _T('\0');
+    return (DirReopen(&it->top->reader, &context->buffer, context->path) ? ULIB_ERROR :
+            ULIB_SUCCESS);
+}
+
+// Advances to the next listed entry, ULIB_FALSE at the end of the walk.
+// it->top is the directory holding it, the path is formatted if asked for
+// or if the entry is a directory to descend into.
+static ulib__bool WalkStep(ListDirIterator* it){
+    ListDirData* listDirData = it->data;
+    ListDirContext* context = it->context;
+    dir_frame* top;
+    ulib__bool seen;
+    if (it->descend){
+        it->descend = ULIB_FALSE;
+        if (WalkDescend(it)){
+            it->status = ULIB_ERROR;
+            return (ULIB_FALSE);
+        }
+    }
+    while ((top = it->top) != ULIB_NULL){
+        if (listDirData->shouldExit && (*(listDirData->shouldExit))){
+            return (ULIB_FALSE);
+        }
+        if (DirNext(&top->reader, &context->buffer, &it->entry) == ULIB_FALSE){
+            if (top->reader.error){
+                it->status = ULIB_ERROR;
+                return (ULIB_FALSE);
+            }
+            // Directory done, back to the parent
+            if (WalkPop(it)){
+                it->status = ULIB_ERROR;
+                return (ULIB_FALSE);
+            }
+            if (it->top){
+                if (WalkReopen(it)){
+                    it->status = ULIB_ERROR;
+                    return (ULIB_FALSE);
+                }
+                DirResume(&it->top->reader, &context->buffer);
+            }
+            continue;
+        }
+        if (EntrySkipped(listDirData, &it->entry, top->depth + 1u)){
+            continue;
+        }
+        it->descend = (it->entry.isDir && Descends(listDirData, top->depth + 1u)) ?
+                      ULIB_TRUE : ULIB_FALSE;
+        // Before the visited check, the key comes with the same stat
+        EntryStat(listDirData, &top->reader, &context->buffer, &it->entry);
+        if (EntryVisits(listDirData, &it->entry, it->descend)){
+            if (PathAppend(&context->path, &context->pathSize, top->pathLength, &it->entry) ||
+                EntrySeen(listDirData, &top->reader, &context->buffer, &it->entry,
+                          context->path, &seen)){
+                it->status = ULIB_ERROR;
+                it->descend = ULIB_FALSE;
+                return (ULIB_FALSE);
+            }
+            if (seen && it->entry.isDir == ULIB_FALSE){
+                continue;
+            }
+            if (seen){
+                it->descend = ULIB_FALSE;
+            }
+        }
+        if (it->entry.isDir){
+            ++listDirData->totalDirs;
+            it->id = ++it->nextId;
+        }
+        else{
+            ++listDirData->totalFiles;
+            it->id = 0;
+        }
+        if (listDirData->usage &&
+            UsageAdd(listDirData->usage, &listDirData->usage->largestFiles, &top->totals,
+                     &it->entry, context->path, top->pathLength)){
+            it->status = ULIB_ERROR;
+            it->descend = ULIB_FALSE;
+            return (ULIB_FALSE);
+        }
+        // path holds the directory of top, the name goes after it
+        if ((it->paths || it->descend) &&
+            PathAppend(&context->path, &context->pathSize, top->pathLength, &it->entry)){
+            it->status = ULIB_ERROR;
+            it->descend = ULIB_FALSE;
+            return (ULIB_FALSE);
+        }
+        return (ULIB_TRUE);
+    }
+    return (ULIB_FALSE);
+}
+
+// Closes what is left on the stack, a stopped walk has the totals of what
+// was read
+static void WalkEnd(ListDirIterator* it){
+    ListDirContext* context = it->context;
+    it->top = (dir_frame*)UlibVectorPeek(&context->stack, ULIB_NULL);
+    while (it->top){
+        if (WalkPop(it)){
+            it->status = ULIB_ERROR;
+        }
+    }
+    if (it->data->usage){
+        UsageEnd(it->data->usage);
+    }
+#ifndef ULIB_VECTOR_NO_STATS
+    UlibVectorGetStats(&context->stack, &it->data->vectorStats);
+#endif
+    it->data->systemCalls += context->buffer.systemCalls;
+    context->buffer.systemCalls = 0;
+    if (context->stack.spill){
+        // The temp file is not kept, the next scan starts in memory
+        UlibVectorFree(&context->stack);
+        context->ready = ULIB_FALSE;
+        DirBufferFree(&context->buffer);
+    }
+}
+
+static ulib__uint8 ListDirSequential(ListDirContext* context,
+                                     ListDirData* listDirData){
+    ListDirIterator it;
+    ProcessFileName callback;
+    ulib__uint8 result;
+    if (listDirData->processEntries && BatchInit(&context->batch)){
+        return (ULIB_ERROR);
+    }
+    result = WalkStart(&it, context, listDirData,
+                       (listDirData->processFile || listDirData->processDirectory) ?
+                       ULIB_TRUE : ULIB_FALSE);
+    if (result){
+        return (result);
+    }
+    while (WalkStep(&it)){
+        if (listDirData->processEntries){
+            BatchAdd(&context->batch, listDirData, &it.entry, it.top->id, it.id);
+        }
+        callback = it.entry.isDir ? listDirData->processDirectory : listDirData->processFile;
+        if (callback){
+            callback(context->path, &context->path[it.top->pathLength + 1u]);
+        }
+    }
+    if (listDirData->processEntries){
+        BatchFlush(&context->batch, listDirData);
+    }
+    WalkEnd(&it);
+    return (it.status);
+}
+
+/* Parallel walk */
+// A directory waiting to be read
+typedef struct dir_node_
+{
+    struct dir_node_*  parent;      // Its handle opens this directory
+    dir_handle         handle;      // Open while subdirectories wait for it
+    ulib_atomic32      refs;        // The reader and the waiting subdirectories
+    ulib_atomic32      links;       // refs > 0 and, with usage, the totals not done
+    struct dir_node_*  up;          // With usage, gets the totals when they are done
+    ulib_atomic32      waiting;     // With usage, its read and the subdirectories not done
+    ulib_atomic64      bytes;       // With usage, ListDirTotals of what is done under it
+    ulib_atomic64      files;
+    ulib_atomic64      dirs;
+    ulib__SizeType     pathLength;
+    ulib__SizeType     nameLength;  // The name is at the end of path
+    ulib__uint64       id;          // ListDirEntry.id
+    ulib__uint32       depth;       // 0 for the start directory
+    _TCHAR             path[1];
+}dir_node;
+
+// Directories waiting in a worker. The owner works at the tail, the other
+// workers steal from the head, where the oldest and biggest subtrees are.
+typedef struct dir_deque_
+{
+    ulib_mutex         lock;
+    dir_node**         nodes;
+    ulib__SizeType     head;
+    ulib__SizeType     tail;
+    ulib__SizeType     size;        // Power of 2
+}dir_deque;
+
+struct dir_walk_;
+
+typedef struct dir_worker_
+{
+    struct dir_walk_*  walk;
+    dir_deque          deque;
+    ulib_thread        thread;
+    ulib__bool         running;     // Has its own thread
+    ulib__uint32       index;
+    ulib__uint64       nextId;      // Ids of the directories it finds
+    ulib__uint32       seed;        // Picks the first worker to steal from
+    ulib__uint64       totalFiles;
+    ulib__uint64       totalDirs;
+    _TCHAR*            path;        // fullPath given to the callbacks
+    ulib__SizeType     pathSize;
+    dir_entry          entry;
+    dir_reader         reader;
+    dir_buffer         buffer;
+    list_dir_batch     batch;
+    ListDirLargest     largestDirs; // With usage, merged at the end of the walk
+    ListDirLargest     largestFiles;
+}dir_worker;
+
+typedef struct dir_walk_
+{
+    ListDirData*       data;
+    dir_worker*        workers;
+    ulib__uint32       count;
+    ulib_atomic32      pending;     // Nodes created and not read yet
+    ulib_atomic32      stop;
+    ulib_atomic32      error;
+}dir_walk;
+
+// The node takes a reference on its parent, and with usage the parent
+// waits for its totals
+static dir_node* NodeCreate(dir_node* parent,
+                            const _TCHAR* path,
+                            const ulib__SizeType pathLength,
+                            const ulib__SizeType nameLength,
+                            const ulib__bool usage){
+    dir_node* node = (dir_node*)malloc(sizeof(dir_node) +
+                     (pathLength + ULIB_DIR_PATH_EXTRA) * sizeof(_TCHAR));
+    if (node == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_NULL);
+    }
+    node->parent = parent;
+    node->handle = ULIB_NO_DIR_HANDLE;
+    node->refs = 1;
+    node->links = usage ? 2 : 1;
+    node->up = usage ? parent : ULIB_NULL;
+    node->waiting = 1;
+    node->bytes = 0;
+    node->files = 0;
+    node->dirs = 0;
+    node->pathLength = pathLength;
+    node->nameLength = nameLength;
+    node->id = 0;
+    node->depth = parent ? parent->depth + 1u : 0u;
+    memcpy(node->path, path, pathLength * sizeof(_TCHAR));
+    node->path[pathLength] = _T('\0');
+    if (parent){
+        UlibAtomicAdd(&parent->refs, 1);
+        if (usage){
+            UlibAtomicAdd(&parent->waiting, 1);
+        }
+    }
+    return (node);
+}
+
+static void NodeUnlink(dir_node* node){
+    if (UlibAtomicAdd(&node->links, -1) == 0){
+        free(node);
+    }
+}
+
+static void NodeRelease(dir_node* node){
+    if (UlibAtomicAdd(&node->refs, -1) == 0){
+        DirHandleClose(node->handle);
+        NodeUnlink(node);
+    }
+}
+
+// Adds totals to the node. When nothing under it is left to read, the node
+// is reported and its totals go up, as far as the parents are done too.
+static ulib__bool NodeUsage(dir_worker* w, dir_node* node, const ListDirTotals* add){
+    ListDirUsage* usage = w->walk->data->usage;
+    ListDirTotals totals = *add;
+    dir_node* up;
+    ulib__bool result = ULIB_SUCCESS;
+    for (;;){
+        UlibAtomicAdd64(&node->bytes, (ulib__int64)totals.bytes);
+        UlibAtomicAdd64(&node->files, (ulib__int64)totals.files);
+        UlibAtomicAdd64(&node->dirs, (ulib__int64)totals.dirs);
+        if (UlibAtomicAdd(&node->waiting, -1) != 0){
+            return (result);
+        }
+        // The last one in, the others' additions are visible
+        totals.bytes = (ulib__uint64)node->bytes;
+        totals.files = (ulib__uint64)node->files;
+        totals.dirs = (ulib__uint64)node->dirs;
+        if (UsageDirDone(usage, &w->largestDirs, &totals, node->path, node->pathLength,
+                         node->depth)){
+            result = ULIB_ERROR;
+        }
+        up = node->up;
+        NodeUnlink(node);
+        if (up == ULIB_NULL){
+            return (result);
+        }
+        node = up;
+    }
+}
+
+static ulib__bool DequePush(dir_deque* d, dir_node* node){
+    dir_node** bigger;
+    ulib__SizeType size;
+    ulib__SizeType i;
+    UlibMutexLock(&d->lock);
+    if (d->tail - d->head == d->size){
+        size = d->size ? d->size << 1u : 64u;
+        bigger = (dir_node**)malloc(size * sizeof(dir_node*));
+        if (bigger == ULIB_NULL){
+            UlibMutexUnlock(&d->lock);
+            ulibError = ULIB_MALLOC_ERROR;
+            return (ULIB_ERROR);
+        }
+        for (i = d->head; i != d->tail; ++i){
+            bigger[i & (size - 1u)] = d->nodes[i & (d->size - 1u)];
+        }
+        free(d->nodes);
+        d->nodes = bigger;
+        d->size = size;
+    }
+    d->nodes[d->tail++ & (d->size - 1u)] = node;
+    UlibMutexUnlock(&d->lock);
+    return (ULIB_SUCCESS);
+}
+
+// Newest node, for the owner
+static dir_node* DequePop(dir_deque* d){
+    dir_node* node = ULIB_NULL;
+    UlibMutexLock(&d->lock);
+    if (d->tail != d->head){
+        node = d->nodes[--d->tail & (d->size - 1u)];
+    }
+    UlibMutexUnlock(&d->lock);
+    return (node);
+}
+
+// Oldest node, for the other workers
+static dir_node* DequeSteal(dir_deque* d){
+    dir_node* node = ULIB_NULL;
+    UlibMutexLock(&d->lock);
+    if (d->tail != d->head){
+        node = d->nodes[d->head++ & (d->size - 1u)];
+    }
+    UlibMutexUnlock(&d->lock);
+    return (node);
+}
+
+static dir_node* Steal(dir_worker* w){
+    dir_walk* walk = w->walk;
+    dir_node* node;
+    ulib__uint32 i;
+    // xorshift, so the workers don't all go for the same victim
+    w->seed ^= w->seed << 13u;
+    w->seed ^= w->seed >> 17u;
+    w->seed ^= w->seed << 5u;
+    for (i = 0; i < walk->count; ++i){
+        dir_worker* victim = &walk->workers[(w->seed + i) % walk->count];
+        if (victim != w){
+            node = DequeSteal(&victim->deque);
+            if (node){
+                return (node);
+            }
+        }
+    }
+    return (ULIB_NULL);
+}
+
+// Stops the walk, ListDir() returns with ulibError of this thread
+static void WalkFail(dir_walk* walk){
+    UlibAtomicStore(&walk->error, ulibError ? ulibError : ULIB_ERROR);
+    UlibAtomicStore(&walk->stop, 1);
+}
+
+// Reads one directory, its subdirectories go to the worker deque
+static void ProcessNode(dir_worker* w, dir_node* node){
+    dir_walk* walk = w->walk;
+    ListDirData* data = walk->data;
+    ProcessFileName callback;
+    dir_node* child;
+    ListDirTotals totals;
+    ulib__SizeType length = node->pathLength;
+    ulib__uint64 id;
+    ulib__bool descend;
+    ulib__bool seen;
+    ulib__uint8 opened = ULIB_FILE_NOT_FOUND;
+    memset(&totals, 0, sizeof(totals));
+    if (UlibAtomicLoad(&walk->stop) == 0){
+        opened = DirOpen(&w->reader, &w->buffer,
+                         node->parent ? node->parent->handle : ULIB_NO_DIR_HANDLE,
+                         &node->path[length - node->nameLength],
+                         node->path, length);
+        if (opened == ULIB_SUCCESS){
+            node->handle = w->reader.handle;
+        }
+    }
+    // The parent handle is not needed anymore
+    if (node->parent){
+        NodeRelease(node->parent);
+        node->parent = ULIB_NULL;
+    }
+    if (opened){ // No access, counted but not listed
+        if (opened == ULIB_ERROR){
+            // Out of descriptors or a read error, not a directory to skip
+            WalkFail(walk);
+        }
+        if (data->usage && NodeUsage(w, node, &totals)){
+            WalkFail(walk);
+        }
+        NodeRelease(node);
+        return;
+    }
+    if (PathReserve(&w->path, &w->pathSize, length + ULIB_DIR_PATH_EXTRA)){
+        WalkFail(walk);
+    }
+    else{
+        memcpy(w->path, node->path, (length + 1u) * sizeof(_TCHAR));
+    }
+    while (UlibAtomicLoad(&walk->stop) == 0 && DirNext(&w->reader, &w->buffer, &w->entry)){
+        if (data->shouldExit && (*(data->shouldExit))){
+            UlibAtomicStore(&walk->stop, 1);
+            break;
+        }
+        if (EntrySkipped(data, &w->entry, node->depth + 1u)){
+            continue;
+        }
+        descend = (w->entry.isDir && Descends(data, node->depth + 1u)) ?
+                  ULIB_TRUE : ULIB_FALSE;
+        // Before the visited check, the key comes with the same stat
+        EntryStat(data, &w->reader, &w->buffer, &w->entry);
+        if (EntryVisits(data, &w->entry, descend)){
+            if (PathAppend(&w->path, &w->pathSize, length, &w->entry) ||
+                EntrySeen(data, &w->reader, &w->buffer, &w->entry, w->path, &seen)){
+                WalkFail(walk);
+                break;
+            }
+            if (seen && w->entry.isDir == ULIB_FALSE){
+                continue;
+            }
+            if (seen){
+                descend = ULIB_FALSE;
+            }
+        }
+        if (w->entry.isDir){
+            ++w->totalDirs;
+            callback = data->processDirectory;
+            // Unique without a shared counter
+            id = w->nextId++ * walk->count + w->index + 1u;
+        }
+        else{
+            ++w->totalFiles;
+            callback = data->processFile;
+            id = 0;
+        }
+        if (data->usage &&
+            UsageAdd(data->usage, &w->largestFiles, &totals, &w->entry, w->path, length)){
+            WalkFail(walk);
+            break;
+        }
+        if (data->processEntries){
+            BatchAdd(&w->batch, data, &w->entry, node->id, id);
+        }
+        if ((callback || descend) && PathAppend(&w->path, &w->pathSize, length, &w->entry)){
+            WalkFail(walk);
+            break;
+        }
+        if (callback){
+            callback(w->path, &w->path[length + 1u]);
+        }
+        if (!descend){
+            continue;
+        }
+        child = NodeCreate(node, w->path, length + 1u + w->entry.nameLength,
+                           w->entry.nameLength, data->usage ? ULIB_TRUE : ULIB_FALSE);
+        if (child == ULIB_NULL){
+            WalkFail(walk);
+            break;
+        }
+        child->id = id;
+        // Counted before it can be stolen and finished
+        UlibAtomicAdd(&walk->pending, 1);
+        if (DequePush(&w->deque, child)){
+            UlibAtomicAdd(&walk->pending, -1);
+            NodeRelease(node);
+            if (data->usage){
+                UlibAtomicAdd(&node->waiting, -1);
+            }
+            free(child);
+            WalkFail(walk);
+            break;
+        }
+    }
+    if (w->reader.error){
+        WalkFail(walk);
+    }
+    DirClose(&w->reader);
+    if (data->usage && NodeUsage(w, node, &totals)){
+        WalkFail(walk);
+    }
+    NodeRelease(node);
+}
+
+// The largest items of a worker go to the walk result
+static ulib__bool UsageMerge(ListDirUsage* usage, dir_worker* w){
+    ulib__uint32 i;
+    for (i = 0; i < w->largestDirs.count; ++i){
+        const ListDirUsageItem* item = &w->largestDirs.items[i];
+        if (LargestOffer(&usage->largestDirs, usage->topCount, &item->totals,
+                         item->path, _tcslen(item->path), ULIB_NULL, 0)){
+            return (ULIB_ERROR);
+        }
+    }
+    for (i = 0; i < w->largestFiles.count; ++i){
+        const ListDirUsageItem* item = &w->largestFiles.items[i];
+        if (LargestOffer(&usage->largestFiles, usage->topCount, &item->totals,
+                         item->path, _tcslen(item->path), ULIB_NULL, 0)){
+            return (ULIB_ERROR);
+        }
+    }
+    return (ULIB_SUCCESS);
+}
+
+static void WorkerRun(void* arg){
+    dir_worker* w = (dir_worker*)arg;
+    dir_walk* walk = w->walk;
+    dir_node* node;
+    ulib__uint32 idle = 0;
+    for (;;){
+        node = DequePop(&w->deque);
+        if (node == ULIB_NULL){
+            node = Steal(w);
+        }
+        if (node){
+            // After a stop the nodes are only released
+            ProcessNode(w, node);
+            UlibAtomicAdd(&walk->pending, -1);
+            idle = 0;
+            continue;
+        }
+        if (UlibAtomicLoad(&walk->pending) == 0){
+            break;
+        }
+        // The others are still reading, wait for new subdirectories
+        if (++idle < 64u){
+            UlibThreadYield();
+        }
+        else{
+            UlibThreadSleep(1u);
+        }
+    }
+    if (walk->data->processEntries){
+        BatchFlush(&w->batch, walk->data);
+    }
+}
+
+static void WorkersFree(ListDirContext* context){
+    ulib__uint32 i;
+    for (i = 0; i < context->workerCount; ++i){
+        dir_worker* w = &context->workers[i];
+        UlibMutexDestroy(&w->deque.lock);
+        free(w->deque.nodes);
+        free(w->path);
+        DirBufferFree(&w->buffer);
+        BatchFree(&w->batch);
+        LargestFree(&w->largestDirs);
+        LargestFree(&w->largestFiles);
+    }
+    ULIB_FREE(context->workers);
+    context->workerCount = 0;
+}
+
+// The workers and their buffers are kept for the next scan with as many threads
+static ulib__bool WorkersPrepare(ListDirContext* context, const ulib__uint32 count){
+    ulib__uint32 i;
+    if (context->workerCount == count){
+        return (ULIB_SUCCESS);
+    }
+    WorkersFree(context);
+    context->workers = (dir_worker*)calloc(count, sizeof(dir_worker));
+    if (context->workers == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_ERROR);
+    }
+    for (i = 0; i < count; ++i){
+        dir_worker* w = &context->workers[i];
+        UlibMutexInit(&w->deque.lock);
+        context->workerCount = i + 1u;
+        if (DirBufferInit(&w->buffer)){
+            WorkersFree(context);
+            return (ULIB_ERROR);
+        }
+    }
+    return (ULIB_SUCCESS);
+}
+
+static ulib__uint8 ListDirParallel(ListDirContext* context,
+                                   ListDirData* listDirData){
+    dir_walk walk;
+    dir_worker* w;
+    dir_node* root;
+    ulib__SizeType dirLength = _tcslen(listDirData->dir);
+    ulib__uint32 i;
+    ulib__bool seen;
+    ulib__uint8 result;
+    if (WorkersPrepare(context, listDirData->threads)){
+        return (ULIB_ERROR);
+    }
+    walk.data = listDirData;
+    walk.workers = context->workers;
+    walk.count = context->workerCount;
+    walk.pending = 1;
+    walk.stop = 0;
+    walk.error = 0;
+    // The names are appended after a separator
+    while (dirLength && ULIB_IS_DIR_SEPARATOR(listDirData->dir[dirLength - 1])){
+        --dirLength;
+    }
+    if (listDirData->usage && UsageStart(listDirData->usage)){
+        return (ULIB_ERROR);
+    }
+    root = NodeCreate(ULIB_NULL, listDirData->dir, dirLength, dirLength,
+                      listDirData->usage ? ULIB_TRUE : ULIB_FALSE);
+    if (root == ULIB_NULL){
+        return (ULIB_ERROR);
+    }
+    for (i = 0; i < walk.count; ++i){
+        w = &walk.workers[i];
+        w->walk = &walk;
+        w->running = ULIB_FALSE;
+        w->seed = 2654435761u * (i + 1u);
+        w->index = i;
+        w->nextId = 0;
+        w->totalFiles = 0;
+        w->totalDirs = 0;
+        w->buffer.systemCalls = 0;
+        if ((listDirData->processEntries && BatchInit(&w->batch)) ||
+            (listDirData->usage &&
+             (LargestReset(&w->largestDirs, listDirData->usage->topCount) ||
+              LargestReset(&w->largestFiles, listDirData->usage->topCount)))){
+            free(root);
+            return (ULIB_ERROR);
+        }
+    }
+    if (StartSeen(listDirData, root->path, &seen) || seen){
+        // Walked by an earlier scan with the same set
+        free(root);
+        return (seen ? ULIB_SUCCESS : ULIB_ERROR);
+    }
+    // Checked here, so a missing start directory is reported as in the
+    // sequential walk
+    w = &walk.workers[0];
+    result = DirOpen(&w->reader, &w->buffer, ULIB_NO_DIR_HANDLE,
+                     root->path, root->path, dirLength);
+    if (result){
+        free(root);
+        ++listDirData->systemCalls;
+        return (result);
+    }
+    DirClose(&w->reader);
+    DirHandleClose(w->reader.handle);
+    if (DequePush(&w->deque, root)){
+        free(root);
+        return (ULIB_ERROR);
+    }
+    // The calling thread is the first worker
+    for (i = 1u; i < walk.count; ++i){
+        w = &walk.workers[i];
+        w->running = UlibThreadStart(&w->thread, WorkerRun, w) == ULIB_SUCCESS ?
+                     ULIB_TRUE : ULIB_FALSE;
+    }
+    WorkerRun(&walk.workers[0]);
+    for (i = 0; i < walk.count; ++i){
+        w = &walk.workers[i];
+        if (w->running){
+            UlibThreadJoin(&w->thread);
+        }
+        listDirData->totalFiles += w->totalFiles;
+        listDirData->totalDirs += w->totalDirs;
+        listDirData->systemCalls += w->buffer.systemCalls;
+        if (listDirData->usage && UsageMerge(listDirData->usage, w)){
+            WalkFail(&walk);
+        }
+    }
+    if (listDirData->usage){
+        UsageEnd(listDirData->usage);
+    }
+#ifndef ULIB_VECTOR_NO_STATS
+    memset(&listDirData->vectorStats, 0, sizeof(listDirData->vectorStats));
+#endif
+    if (walk.error){
+        ulibError = (ulib__uint8)walk.error;
+        return (ULIB_ERROR);
+    }
+    return (ULIB_SUCCESS);
+}
+
+void ListDirContextInit(ListDirContext* context){
+    memset(context, 0, sizeof(ListDirContext));
+}
+
+ulib__uint8 ListDirContextScan(ListDirContext* context, ListDirData* listDirData){
+    if (listDirData->threads > 1u){
+        return (ListDirParallel(context, listDirData));
+    }
+    return (ListDirSequential(context, listDirData));
+}
+
+void ListDirContextFree(ListDirContext* context){
+    if (context->ready){
+        UlibVectorFree(&context->stack);
+        DirBufferFree(&context->buffer);
+        context->ready = ULIB_FALSE;
+    }
+    WorkersFree(context);
+    BatchFree(&context->batch);
+    ULIB_FREE(context->path);
+    context->pathSize = 0;
+}
+
+ulib__uint8 ListDirOpen(ListDirIterator* it,
+                        ListDirData* listDirData,
+                        ListDirContext* context){
+    ulib__uint8 result;
+    if (context == ULIB_NULL){
+        ListDirContextInit(&it->ownContext);
+        context = &it->ownContext;
+    }
+    result = WalkStart(it, context, listDirData, ULIB_TRUE);
+    if (result){
+        if (context == &it->ownContext){
+            ListDirContextFree(context);
+        }
+    }
+    return (result);
+}
+
+ulib__bool ListDirNext(ListDirIterator* it, ListDirEntry* entry){
+    if (WalkStep(it) == ULIB_FALSE){
+        it->fullPath = ULIB_NULL;
+        return (ULIB_FALSE);
+    }
+    it->fullPath = it->context->path;
+    entry->name = &it->context->path[it->top->pathLength + 1u];
+    entry->nameLength = it->entry.nameLength;
+    entry->id = it->id;
+    entry->parentId = it->top->id;
+    entry->fileId = it->entry.fileId;
+    entry->size = it->entry.size;
+    entry->modifiedTime = it->entry.modifiedTime;
+    entry->creationTime = it->entry.creationTime;
+    entry->type = it->entry.type;
+    return (ULIB_TRUE);
+}
+
+ulib__SizeType ListDirNextBatch(ListDirIterator* it, const ListDirEntry** entries){
+    list_dir_batch* b = &it->context->batch;
+    if (BatchInit(b)){
+        it->status = ULIB_ERROR;
+        return (0);
+    }
+    // Stops while any name still fits, so BatchAdd never flushes
+    while (b->count < ULIB_LISTDIR_BATCH_SIZE &&
+           b->namesUsed + ULIB_LISTDIR_MAX_NAME <= ULIB_LISTDIR_BATCH_NAMES &&
+           WalkStep(it)){
+        BatchAdd(b, it->data, &it->entry, it->top->id, it->id);
+    }
+    *entries = b->entries;
+    return (b->count);
+}
+
+void ListDirClose(ListDirIterator* it){
+    WalkEnd(it);
+    if (it->context == &it->ownContext){
+        ListDirContextFree(&it->ownContext);
+    }
+}
+
+void ListDirUsageFree(ListDirUsage* usage){
+    LargestFree(&usage->largestDirs);
+    LargestFree(&usage->largestFiles);
+}
+
+ulib__uint8 ListDir(ListDirData* listDirData){
+    ListDirContext context;
+    ulib__uint8 result;
+    ListDirContextInit(&context);
+    result = ListDirContextScan(&context, listDirData);
+    ListDirContextFree(&context);
+    return (result);
+}
+#endif // #ifdef IMPLEMENTATION
+#ifdef __cplusplus
+} /* namespace ulib{ */
+#endif
+#endif // #ifndef _ulib_listdir_h_
@@ -0,0 +1,1073 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  File name index
+*  A ListDir scan is collected with ListDirIndexAdd(), the ProcessEntries
+*  callback, and written to an index file with ListDirIndexWrite(). The file
+*  is memory mapped by ListDirIndexOpen() and used as it is, nothing is
+*  parsed or allocated when it is loaded.
+*  The file holds the entry names sorted, prefix compressed against the
+*  previous name, the parent directory of every entry, the entries sorted
+*  by name ending and in tree order. ListDirIndexFind() answers WildcardMatch()
+*  queries, optionally under a directory, on the smallest of:
+*   - the names starting with the text before the first *, for "main*" or
+*     "lib*.so", found with a binary search
+*   - the names ending with the text after the last *, for "*.log"
+*   - the entries under the directory, they follow each other in tree order
+*   - all the names
+*  With a single * at the start or at the end of the pattern, the names are
+*  not read, only the paths of the matches are built.
+*  Example:
+*   ListDirIndexBuilder builder;
+*   ListDirIndexBuilderInit(&builder);
+*   listDirData.processEntries = ListDirIndexAdd;
+*   listDirData.entriesContext = &builder;
+*   ListDir(&listDirData);
+*   ListDirIndexWrite(&builder, listDirData.dir, _T("files.index"));
+*   ListDirIndexBuilderFree(&builder);
+*
+*   ListDirIndex index;
+*   ListDirIndexOpen(&index, _T("files.index"));
+*   ListDirIndexFind(&index, _T("/var/log"), _T("*.log"), MatchCallBack, ULIB_NULL);
+*   ListDirIndexClose(&index);
+* NOTES:
+*   1. ListDirIndexAdd() can be called by several walking threads at once.
+*   2. The index holds up to 4G entries, names up to ULIB_LISTDIR_MAX_NAME
+*      chars. It is written in the native byte order and char size.
+*   3. Names are compared char by char, case sensitive, as WildcardMatch().
+*   4. In case of an error, the error code is stored in ulibError global variable
+***********************************************************************************/
+#ifndef _ulib_listdir_index_h_
+#define _ulib_listdir_index_h_
+
+#include "ulib_listdir.h"
+#include "ulib_file_io.h"
+
+#ifdef __cplusplus
+namespace ulib {
+#endif
+
+#define ULIB_INDEX_MAGIC   0x58444C55u  // "ULDX"
+#define ULIB_INDEX_VERSION 1u
+#define ULIB_INDEX_NONE    0xFFFFFFFFu
+// Names between two names stored whole
+#define ULIB_INDEX_RESTART 16u
+
+/* Index file: the header, the start directory path with its NUL, then at
+   the offsets in the header the entries sorted by name, the name offset of
+   every ULIB_INDEX_RESTART-th entry, the entry numbers sorted by name
+   ending, the entry numbers in tree order and the names. A name is stored
+   as the chars that differ from the previous one, without a NUL.
+   In tree order every directory is followed by the entries under it. */
+typedef struct ulib_index_header_
+{
+    ulib__uint32            magic;            /* ULIB_INDEX_MAGIC */
+    ulib__uint32            version;          /* ULIB_INDEX_VERSION */
+    ulib__uint32            charSize;         /* sizeof(_TCHAR) */
+    ulib__uint32            restartInterval;  /* ULIB_INDEX_RESTART */
+    ulib__uint64            entryCount;
+    ulib__uint64            rootLength;       /* Chars in the start directory path */
+    ulib__uint64            entriesOffset;    /* Byte offsets in the file */
+    ulib__uint64            restartsOffset;
+    ulib__uint64            suffixOffset;
+    ulib__uint64            treeOffset;
+    ulib__uint64            namesOffset;
+    ulib__uint64            namesSize;        /* Chars */
+    ulib__uint64            fileSize;
+}ulib_index_header;
+
+typedef struct ulib_index_entry_
+{
+    ulib__uint32            parent;           /* Entry of the parent directory, ULIB_INDEX_NONE in the start dir */
+    ulib__uint32            position;         /* Position in tree order */
+    ulib__uint32            subtree;          /* Entries under it, they follow it in tree order */
+    ulib__uint16            shared;           /* Chars shared with the previous name, 0 on a restart */
+    ulib__uint16            suffixLength;     /* Chars stored for this name */
+    ulib__uint8             type;             /* ULIB_ENTRY_FILE, ULIB_ENTRY_DIR, ... */
+    ulib__uint8             reserved[3];
+}ulib_index_entry;
+
+// An entry collected by ListDirIndexAdd()
+typedef struct index_record_
+{
+    ulib__uint64            name;             /* Offset in the builder names */
+    ulib__uint64            id;
+    ulib__uint64            parentId;
+    ulib__uint32            nameLength;
+    ulib__uint8             type;
+}index_record;
+
+typedef struct ListDirIndexBuilder_
+{
+    ulib_mutex              lock;             /* ListDirIndexAdd() runs on the walking threads */
+    index_record*           records;
+    ulib__SizeType          count;
+    ulib__SizeType          size;
+    _TCHAR*                 names;
+    ulib__SizeType          namesUsed;
+    ulib__SizeType          namesSize;
+    ulib__bool              failed;           /* An entry could not be added */
+}ListDirIndexBuilder;
+
+typedef struct ListDirIndex_
+{
+    ulib_file_view          file;             /* The mapped file */
+    const ulib_index_header* header;
+    const ulib_index_entry* entries;
+    const ulib__uint64*     restarts;
+    const ulib__uint32*     suffixOrder;
+    const ulib__uint32*     treeOrder;
+    const _TCHAR*           names;
+    const _TCHAR*           root;
+}ListDirIndex;
+
+//
+// Called by ListDirIndexFind() for every match. entry can be given to
+// ListDirIndexPath(), fullPath is valid during the call.
+// Return ULIB_FALSE to stop the query.
+//
+typedef ulib__bool (*ProcessIndexMatch)(const _TCHAR* fullPath,
+                                        ulib__uint32 entry,
+                                        ulib__uint8 type,
+                                        void* context);
+
+/* Public functions */
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+* Function:
+*          void ListDirIndexBuilderInit(OUT ListDirIndexBuilder* builder);
+*          void ListDirIndexAdd(IN const ListDirEntry* entries,
+*                               IN ulib__SizeType count,
+*                               IN void* builder);
+*          void ListDirIndexBuilderFree(IN ListDirIndexBuilder* builder);
+* ListDirIndexAdd() is a ProcessEntries callback, builder is the
+* ListDirIndexBuilder. If memory runs out builder->failed is set and
+* ListDirIndexWrite() fails.
+******************************************************************************/
+void ListDirIndexBuilderInit(OUT ListDirIndexBuilder* builder);
+void ListDirIndexAdd(IN const ListDirEntry* entries,
+                     IN ulib__SizeType count,
+                     IN void* builder);
+void ListDirIndexBuilderFree(IN ListDirIndexBuilder* builder);
+
+/******************************************************************************
+* Function:
+*          ulib__uint8 ListDirIndexWrite(IN ListDirIndexBuilder* builder,
+*                                        IN const _TCHAR* dir,
+*                                        IN const _TCHAR* fileName);
+* Sorts the collected entries and writes the index file. dir is the start
+* directory of the scan.
+* Parameters:
+*      Input:  ListDirIndexBuilder* builder
+*              const _TCHAR* dir
+*              const _TCHAR* fileName
+*      Return: ULIB_SUCCESS if successful
+*              ULIB_ERROR if the file could not be written or the memory ran
+*              out, then ulibError is ULIB_MALLOC_ERROR
+******************************************************************************/
+ulib__uint8 ListDirIndexWrite(IN ListDirIndexBuilder* builder,
+                              IN const _TCHAR* dir,
+                              IN const _TCHAR* fileName);
+
+/******************************************************************************
+* Function:
+*          ulib__uint8 ListDirIndexOpen(OUT ListDirIndex* index,
+*                                       IN const _TCHAR* fileName);
+*          void ListDirIndexClose(IN ListDirIndex* index);
+* Maps the index file read only. Only the header is checked.
+* Return: ULIB_SUCCESS if successful
+*         ULIB_FILE_NOT_FOUND if the file can't be opened
+*         ULIB_ERROR if it can't be mapped or is not an index file of this
+*         build
+******************************************************************************/
+ulib__uint8 ListDirIndexOpen(OUT ListDirIndex* index,
+                             IN const _TCHAR* fileName);
+void ListDirIndexClose(IN ListDirIndex* index);
+
+/******************************************************************************
+* Function:
+*          ulib__uint64 ListDirIndexFind(IN const ListDirIndex* index,
+*                                        IN const _TCHAR* dir,
+*                                        IN const _TCHAR* pattern,
+*                                        IN ProcessIndexMatch processMatch,
+*                                        IN void* context);
+* Finds the entries whose name matches pattern, see WildcardMatch(). With
+* dir only the entries under that directory (at any depth) are matched, it
+* must be the start directory or a path below it. processMatch can be
+* ULIB_NULL to count the matches.
+* Return: the number of matches
+******************************************************************************/
+ulib__uint64 ListDirIndexFind(IN const ListDirIndex* index,
+                              IN const _TCHAR* dir,
+                              IN const _TCHAR* pattern,
+                              IN ProcessIndexMatch processMatch,
+                              IN void* context);
+
+/******************************************************************************
+* Function:
+*          ulib__SizeType ListDirIndexPath(IN const ListDirIndex* index,
+*                                          IN const ulib__uint32 entry,
+*                                          OUT _TCHAR* path,
+*                                          IN const ulib__SizeType pathSize);
+* Writes the full path of entry, with its NUL, if it fits in pathSize chars
+* Return: the length of the path, 0 for an invalid entry
+******************************************************************************/
+ulib__SizeType ListDirIndexPath(IN const ListDirIndex* index,
+                                IN const ulib__uint32 entry,
+                                OUT _TCHAR* path,
+                                IN const ulib__SizeType pathSize);
+#ifdef __cplusplus
+}
+#endif
+
+/* ========================================================================= */
+#ifdef IMPLEMENTATION
+// Ways of ListDirIndexFind() through the index
+#define ULIB_INDEX_SCAN     0
+#define ULIB_INDEX_PREFIX   1
+#define ULIB_INDEX_SUFFIX   2
+#define ULIB_INDEX_TREE     3
+// Cost of a seek against reading the next name
+#define ULIB_INDEX_SEEK     8u
+
+// Chars compared as unsigned, as the sort order of the index
+#define ULIB_INDEX_CHAR(c) (sizeof(_TCHAR) == 1u ? (ulib__uint32)(unsigned char)(c) :\
+                                                   (ulib__uint32)(c))
+
+// A name while the index is built
+typedef struct index_sort_
+{
+    ulib__uint64   key;         // The first chars, most compares end here
+    const _TCHAR*  name;
+    ulib__uint32   nameLength;
+    ulib__uint32   record;
+}index_sort;
+
+// A directory id and its entry number in the index
+typedef struct index_dir_
+{
+    ulib__uint64   id;
+    ulib__uint32   entry;
+}index_dir;
+
+// State of ListDirIndexFind()
+typedef struct index_query_
+{
+    const ListDirIndex* index;
+    const _TCHAR*       pattern;
+    ulib__uint32        dir;         // Matches are under it, ULIB_INDEX_NONE for all
+    ulib__uint64        first;       // Tree order positions of the entries under dir
+    ulib__uint64        end;
+    ulib__bool          exact;       // The candidates all match the pattern
+    ProcessIndexMatch   processMatch;
+    void*               context;
+    _TCHAR*             path;
+    ulib__SizeType      pathSize;
+    ulib__uint64        matches;
+}index_query;
+
+// A directory of the tree order walk
+typedef struct index_frame_
+{
+    ulib__uint32   dir;
+    ulib__uint32   next;        // Next child in children
+}index_frame;
+
+// Arrays of ListDirIndexWrite()
+typedef struct index_build_
+{
+    ulib__SizeType     count;
+    ulib__SizeType     restartCount;
+    ulib__uint64       namesSize;
+    index_sort*        sorted;      // Names in entry order
+    index_dir*         dirs;
+    ulib__uint32*      endings;
+    ulib__uint32*      tree;
+    ulib__uint32*      children;    // Entries grouped by parent
+    ulib__uint32*      first;       // First child of every entry
+    ulib_index_entry*  entries;
+    ulib__uint64*      restarts;
+    index_frame*       stack;
+    ulib__SizeType     stackSize;
+}index_build;
+
+// Names decoded one after the other
+typedef struct index_cursor_
+{
+    ulib__uint64   entry;       // Entry of name
+    ulib__uint64   position;    // Chars of the next name in the names
+    ulib__SizeType length;
+    _TCHAR         name[ULIB_LISTDIR_MAX_NAME];
+}index_cursor;
+
+// name against key, in prefix mode a name starting with key is equal
+static int IndexCompare(const _TCHAR* name,
+                        const ulib__SizeType nameLength,
+                        const _TCHAR* key,
+                        const ulib__SizeType keyLength,
+                        const ulib__bool prefix){
+    ulib__SizeType length = nameLength < keyLength ? nameLength : keyLength;
+    ulib__SizeType i;
+    for (i = 0; i < length; ++i){
+        if (name[i] != key[i]){
+            return (ULIB_INDEX_CHAR(name[i]) < ULIB_INDEX_CHAR(key[i]) ? -1 : 1);
+        }
+    }
+    if (nameLength < keyLength){
+        return (-1);
+    }
+    return ((nameLength == keyLength || prefix) ? 0 : 1);
+}
+
+// The same from the last char to the first
+static int IndexCompareReverse(const _TCHAR* name,
+                               const ulib__SizeType nameLength,
+                               const _TCHAR* key,
+                               const ulib__SizeType keyLength,
+                               const ulib__bool prefix){
+    ulib__SizeType length = nameLength < keyLength ? nameLength : keyLength;
+    ulib__SizeType i;
+    for (i = 1; i <= length; ++i){
+        _TCHAR a = name[nameLength - i];
+        _TCHAR b = key[keyLength - i];
+        if (a != b){
+            return (ULIB_INDEX_CHAR(a) < ULIB_INDEX_CHAR(b) ? -1 : 1);
+        }
+    }
+    if (nameLength < keyLength){
+        return (-1);
+    }
+    return ((nameLength == keyLength || prefix) ? 0 : 1);
+}
+
+// The first 8 bytes of chars of the name, from the end with reverse, in the
+// order of IndexCompare()
+static ulib__uint64 IndexKey(const _TCHAR* name,
+                             const ulib__SizeType nameLength,
+                             const ulib__bool reverse){
+    ulib__uint64 key = 0;
+    ulib__SizeType i;
+    for (i = 0; i < sizeof(key) / sizeof(_TCHAR); ++i){
+        key <<= 8u * sizeof(_TCHAR);
+        if (i < nameLength){
+            key |= ULIB_INDEX_CHAR(reverse ? name[nameLength - 1u - i] : name[i]);
+        }
+    }
+    return (key);
+}
+
+static int IndexSortNames(const void* a, const void* b){
+    const index_sort* x = (const index_sort*)a;
+    const index_sort* y = (const index_sort*)b;
+    int order;
+    if (x->key != y->key){
+        return (x->key < y->key ? -1 : 1);
+    }
+    order = IndexCompare(x->name, x->nameLength, y->name, y->nameLength, ULIB_FALSE);
+    if (order == 0){
+        order = x->record < y->record ? -1 : 1;
+    }
+    return (order);
+}
+
+static int IndexSortEndings(const void* a, const void* b){
+    const index_sort* x = (const index_sort*)a;
+    const index_sort* y = (const index_sort*)b;
+    int order;
+    if (x->key != y->key){
+        return (x->key < y->key ? -1 : 1);
+    }
+    order = IndexCompareReverse(x->name, x->nameLength, y->name, y->nameLength,
+                                    ULIB_FALSE);
+    if (order == 0){
+        order = x->record < y->record ? -1 : 1;
+    }
+    return (order);
+}
+
+static int IndexSortDirs(const void* a, const void* b){
+    const index_dir* x = (const index_dir*)a;
+    const index_dir* y = (const index_dir*)b;
+    return (x->id < y->id ? -1 : (x->id > y->id ? 1 : 0));
+}
+
+// Writes zeros from byte offset from up to to, at most 16
+static ulib__bool IndexPad(FILE* f, const ulib__uint64 from, const ulib__uint64 to){
+    static const ulib__uint8 zeros[16] = { 0 };
+    ulib__SizeType count = (ulib__SizeType)(to - from);
+    return ((count == 0 || fwrite(zeros, 1u, count, f) == count) ? ULIB_SUCCESS : ULIB_ERROR);
+}
+
+static ulib__uint64 IndexAligned(const ulib__uint64 bytes){
+    return ((bytes + 7u) & ~(ulib__uint64)7u);
+}
+
+// Decodes the entries after the cursor, up to entry, ULIB_ERROR if the
+// file is damaged
+static ulib__bool IndexDecode(const ListDirIndex* index,
+                              index_cursor* c,
+                              const ulib__uint64 entry){
+    for (; c->entry != entry; ++c->entry){
+        const ulib_index_entry* e = &index->entries[c->entry + 1u];
+        if (e->shared > c->length ||
+            (ulib__SizeType)e->shared + e->suffixLength >= ULIB_LISTDIR_MAX_NAME ||
+            c->position > index->header->namesSize ||
+            e->suffixLength > index->header->namesSize - c->position){
+            return (ULIB_ERROR);
+        }
+        memcpy(&c->name[e->shared], &index->names[c->position],
+               e->suffixLength * sizeof(_TCHAR));
+        c->position += e->suffixLength;
+        c->length = (ulib__SizeType)e->shared + e->suffixLength;
+        c->name[c->length] = _T('\0');
+    }
+    return (ULIB_SUCCESS);
+}
+
+// Decodes the name of entry, from the restart before it
+static ulib__bool IndexSeek(const ListDirIndex* index,
+                            index_cursor* c,
+                            const ulib__uint64 entry){
+    ulib__uint64 restart = entry / ULIB_INDEX_RESTART;
+    c->entry = restart * ULIB_INDEX_RESTART - 1u;    // Wraps for the first block
+    c->position = index->restarts[restart];
+    c->length = 0;
+    return (IndexDecode(index, c, entry));
+}
+
+// First entry whose name is not below key (upper: above key) in prefix mode
+static ulib__uint64 IndexBound(const ListDirIndex* index,
+                               index_cursor* c,
+                               const _TCHAR* key,
+                               const ulib__SizeType keyLength,
+                               const ulib__bool upper){
+    ulib__uint64 count = index->header->entryCount;
+    ulib__uint64 low = 0;
+    ulib__uint64 high = (count + ULIB_INDEX_RESTART - 1u) / ULIB_INDEX_RESTART;
+    ulib__uint64 end;
+    ulib__uint64 i;
+    int order;
+    // The blocks whose first name is still before the bound
+    while (low < high){
+        ulib__uint64 middle = low + (high - low) / 2u;
+        if (IndexSeek(index, c, middle * ULIB_INDEX_RESTART)){
+            return (count);
+        }
+        order = IndexCompare(c->name, c->length, key, keyLength, ULIB_TRUE);
+        if (upper ? order <= 0 : order < 0){
+            low = middle + 1u;
+        }
+        else{
+            high = middle;
+        }
+    }
+    if (low == 0){
+        return (0);
+    }
+    end = low * ULIB_INDEX_RESTART < count ? low * ULIB_INDEX_RESTART : count;
+    // The bound is in the block before
+    for (i = (low - 1u) * ULIB_INDEX_RESTART; i < end; ++i){
+        if (IndexSeek(index, c, i)){
+            return (count);
+        }
+        order = IndexCompare(c->name, c->length, key, keyLength, ULIB_TRUE);
+        if (upper ? order > 0 : order >= 0){
+            return (i);
+        }
+    }
+    return (end);
+}
+
+// The same over the entries sorted by name ending, returns a position in
+// the suffix order
+static ulib__uint64 IndexBoundReverse(const ListDirIndex* index,
+                                      index_cursor* c,
+                                      const _TCHAR* key,
+                                      const ulib__SizeType keyLength,
+                                      const ulib__bool upper){
+    ulib__uint64 low = 0;
+    ulib__uint64 high = index->header->entryCount;
+    while (low < high){
+        ulib__uint64 middle = low + (high - low) / 2u;
+        int order;
+        if (index->suffixOrder[middle] >= index->header->entryCount ||
+            IndexSeek(index, c, index->suffixOrder[middle])){
+            return (index->header->entryCount);
+        }
+        order = IndexCompareReverse(c->name, c->length, key, keyLength, ULIB_TRUE);
+        if (upper ? order <= 0 : order < 0){
+            low = middle + 1u;
+        }
+        else{
+            high = middle;
+        }
+    }
+    return (low);
+}
+
+// Entry of the directory at path, ULIB_INDEX_NONE for the start directory.
+// ULIB_FALSE if it is not in the index.
+static ulib__bool IndexResolve(const ListDirIndex* index,
+                               index_cursor* c,
+                               const _TCHAR* path,
+                               ulib__uint32* dir){
+    ulib__SizeType rootLength = (ulib__SizeType)index->header->rootLength;
+    ulib__SizeType length = _tcslen(path);
+    ulib__SizeType start;
+    *dir = ULIB_INDEX_NONE;
+    while (length && ULIB_IS_DIR_SEPARATOR(path[length - 1])){
+        --length;
+    }
+    if (length < rootLength || memcmp(path, index->root, rootLength * sizeof(_TCHAR)) != 0 ||
+        (length > rootLength && !ULIB_IS_DIR_SEPARATOR(path[rootLength]))){
+        return (ULIB_FALSE);
+    }
+    start = rootLength;
+    while (start < length){
+        ulib__SizeType end;
+        ulib__uint64 i;
+        ulib__bool found = ULIB_FALSE;
+        while (start < length && ULIB_IS_DIR_SEPARATOR(path[start])){
+            ++start;
+        }
+        end = start;
+        while (end < length && !ULIB_IS_DIR_SEPARATOR(path[end])){
+            ++end;
+        }
+        if (start == end){
+            break;
+        }
+        // The names equal to the component follow each other
+        i = IndexBound(index, c, &path[start], end - start, ULIB_FALSE);
+        for (; i < index->header->entryCount && found == ULIB_FALSE; ++i){
+            if (IndexSeek(index, c, i) ||
+                IndexCompare(c->name, c->length, &path[start], end - start, ULIB_TRUE) != 0){
+                break;
+            }
+            if (c->length == end - start && index->entries[i].parent == *dir &&
+                index->entries[i].type == ULIB_ENTRY_DIR){
+                *dir = (ulib__uint32)i;
+                found = ULIB_TRUE;
+            }
+        }
+        if (found == ULIB_FALSE){
+            return (ULIB_FALSE);
+        }
+        start = end;
+    }
+    return (ULIB_TRUE);
+}
+
+// Checks a candidate entry, ULIB_FALSE to stop the query. The name is
+// decoded only if the pattern has to be matched.
+static ulib__bool IndexMatch(index_query* q, index_cursor* c, const ulib__uint64 entry){
+    ulib__uint64 position = q->index->entries[entry].position;
+    ulib__SizeType length;
+    if (position < q->first || position >= q->end){
+        return (ULIB_TRUE);
+    }
+    if (q->exact == ULIB_FALSE){
+        if ((c->entry != entry && IndexSeek(q->index, c, entry)) ||
+            WildcardMatch(q->pattern, c->name) == ULIB_FALSE){
+            return (ULIB_TRUE);
+        }
+    }
+    ++q->matches;
+    if (q->processMatch == ULIB_NULL){
+        return (ULIB_TRUE);
+    }
+    length = ListDirIndexPath(q->index, (ulib__uint32)entry, q->path, q->pathSize);
+    if (length >= q->pathSize){
+        if (PathReserve(&q->path, &q->pathSize, length + 1u)){
+            return (ULIB_FALSE);
+        }
+        length = ListDirIndexPath(q->index, (ulib__uint32)entry, q->path, q->pathSize);
+    }
+    if (length == 0){
+        return (ULIB_TRUE);
+    }
+    return (q->processMatch(q->path, (ulib__uint32)entry, q->index->entries[entry].type,
+                            q->context));
+}
+
+// Sorts the names, and their endings into b->endings
+static void IndexSort(index_build* b, const ListDirIndexBuilder* builder){
+    ulib__SizeType i;
+    for (i = 0; i < b->count; ++i){
+        b->sorted[i].name = &builder->names[builder->records[i].name];
+        b->sorted[i].nameLength = builder->records[i].nameLength;
+        b->sorted[i].record = (ulib__uint32)i;
+        b->sorted[i].key = IndexKey(b->sorted[i].name, b->sorted[i].nameLength, ULIB_TRUE);
+    }
+    // The endings first, the same array is then sorted by name
+    qsort(b->sorted, b->count, sizeof(index_sort), IndexSortEndings);
+    for (i = 0; i < b->count; ++i){
+        b->endings[i] = b->sorted[i].record;
+        b->sorted[i].key = IndexKey(b->sorted[i].name, b->sorted[i].nameLength, ULIB_FALSE);
+    }
+    qsort(b->sorted, b->count, sizeof(index_sort), IndexSortNames);
+    // Record numbers to entry numbers, tree is free until IndexTree()
+    for (i = 0; i < b->count; ++i){
+        b->tree[b->sorted[i].record] = (ulib__uint32)i;
+    }
+    for (i = 0; i < b->count; ++i){
+        b->endings[i] = b->tree[b->endings[i]];
+    }
+}
+
+// Fills the entries: prefix compression, restarts and parents
+static void IndexEncode(index_build* b, const ListDirIndexBuilder* builder){
+    ulib__SizeType dirCount = 0;
+    ulib__SizeType i;
+    for (i = 0; i < b->count; ++i){
+        const index_record* r = &builder->records[b->sorted[i].record];
+        if (r->type == ULIB_ENTRY_DIR){
+            b->dirs[dirCount].id = r->id;
+            b->dirs[dirCount++].entry = (ulib__uint32)i;
+        }
+    }
+    qsort(b->dirs, dirCount, sizeof(index_dir), IndexSortDirs);
+    for (i = 0; i < b->count; ++i){
+        const index_record* r = &builder->records[b->sorted[i].record];
+        ulib_index_entry* e = &b->entries[i];
+        ulib__uint32 shared = 0;
+        index_dir key;
+        index_dir* parent;
+        if (i % ULIB_INDEX_RESTART == 0){
+            b->restarts[i / ULIB_INDEX_RESTART] = b->namesSize;
+        }
+        else{
+            const index_sort* previous = &b->sorted[i - 1u];
+            while (shared < previous->nameLength && shared < b->sorted[i].nameLength &&
+                   previous->name[shared] == b->sorted[i].name[shared]){
+                ++shared;
+            }
+        }
+        key.id = r->parentId;
+        parent = (index_dir*)bsearch(&key, b->dirs, dirCount, sizeof(index_dir), IndexSortDirs);
+        // Entries of the start directory have parentId 0, it has no entry
+        e->parent = parent ? parent->entry : ULIB_INDEX_NONE;
+        e->position = ULIB_INDEX_NONE;
+        e->shared = (ulib__uint16)shared;
+        e->suffixLength = (ulib__uint16)(b->sorted[i].nameLength - shared);
+        e->type = r->type;
+        b->namesSize += e->suffixLength;
+    }
+}
+
+// Parent of entry i, count for the start directory
+static ULIB_INLINE ulib__uint32 IndexParent(const index_build* b, const ulib__uint32 i){
+    return (b->entries[i].parent == ULIB_INDEX_NONE ? (ulib__uint32)b->count : b->entries[i].parent);
+}
+
+// Tree order: depth first from the start directory, the children of a
+// directory by name
+static ulib__bool IndexTree(index_build* b){
+    ulib__uint32 count = (ulib__uint32)b->count;
+    ulib__uint32 position = 0;
+    ulib__uint32 i;
+    ulib__SizeType depth = 0;
+    // The children of entry i are children[first[i]] to children[first[i + 1] - 1],
+    // the start directory is entry count. Counted at first[parent + 2], they
+    // are placed at first[parent + 1], which then moves to the next parent.
+    for (i = 0; i < count; ++i){
+        ++b->first[IndexParent(b, i) + 2u];
+    }
+    for (i = 0; i <= count; ++i){
+        b->first[i + 1u] += b->first[i];
+    }
+    for (i = 0; i < count; ++i){
+        b->children[b->first[IndexParent(b, i) + 1u]++] = i;
+    }
+    if (ArrayReserve((void**)&b->stack, &b->stackSize, 1u, sizeof(index_frame))){
+        return (ULIB_ERROR);
+    }
+    b->stack[0].dir = count;
+    b->stack[0].next = b->first[count];
+    depth = 1;
+    while (depth){
+        index_frame* top = &b->stack[depth - 1u];
+        ulib__uint32 child;
+        if (top->next == b->first[top->dir + 1u]){
+            if (top->dir != count){
+                b->entries[top->dir].subtree = position - b->entries[top->dir].position - 1u;
+            }
+            --depth;
+            continue;
+        }
+        child = b->children[top->next++];
+        b->entries[child].position = position;
+        b->tree[position++] = child;
+        if (b->first[child] != b->first[child + 1u]){
+            if (ArrayReserve((void**)&b->stack, &b->stackSize, depth + 1u, sizeof(index_frame))){
+                return (ULIB_ERROR);
+            }
+            b->stack[depth].dir = child;
+            b->stack[depth++].next = b->first[child];
+        }
+    }
+    // Entries cut off from the start directory go last
+    for (i = 0; i < count; ++i){
+        if (b->entries[i].position == ULIB_INDEX_NONE){
+            b->entries[i].position = position;
+            b->tree[position++] = i;
+        }
+    }
+    return (ULIB_SUCCESS);
+}
+
+static ulib__bool IndexSave(const index_build* b,
+                            const _TCHAR* dir,
+                            const ulib__SizeType rootLength,
+                            const _TCHAR* fileName){
+    ulib_index_header h;
+    ulib__SizeType count = b->count;
+    ulib__SizeType i;
+    ulib__bool result;
+    FILE* f = ULIB_NULL;
+    memset(&h, 0, sizeof(h));
+    h.magic = ULIB_INDEX_MAGIC;
+    h.version = ULIB_INDEX_VERSION;
+    h.charSize = sizeof(_TCHAR);
+    h.restartInterval = ULIB_INDEX_RESTART;
+    h.entryCount = count;
+    h.rootLength = rootLength;
+    h.entriesOffset = IndexAligned(sizeof(h) + (rootLength + 1u) * sizeof(_TCHAR));
+    h.restartsOffset = IndexAligned(h.entriesOffset + count * sizeof(ulib_index_entry));
+    h.suffixOffset = h.restartsOffset + b->restartCount * sizeof(ulib__uint64);
+    h.treeOffset = h.suffixOffset + count * sizeof(ulib__uint32);
+    h.namesOffset = IndexAligned(h.treeOffset + count * sizeof(ulib__uint32));
+    h.namesSize = b->namesSize;
+    h.fileSize = IndexAligned(h.namesOffset + h.namesSize * sizeof(_TCHAR));
+    _tfopen_s(&f, fileName, _TEXT("wb"));
+    if (f == ULIB_NULL){
+        return (ULIB_ERROR);
+    }
+    result = (fwrite(&h, sizeof(h), 1u, f) != 1u ||
+              fwrite(dir, sizeof(_TCHAR), rootLength, f) != rootLength ||
+              IndexPad(f, sizeof(h) + rootLength * sizeof(_TCHAR), h.entriesOffset) ||
+              fwrite(b->entries, sizeof(ulib_index_entry), count, f) != count ||
+              IndexPad(f, h.entriesOffset + count * sizeof(ulib_index_entry), h.restartsOffset) ||
+              fwrite(b->restarts, sizeof(ulib__uint64), b->restartCount, f) != b->restartCount ||
+              fwrite(b->endings, sizeof(ulib__uint32), count, f) != count ||
+              fwrite(b->tree, sizeof(ulib__uint32), count, f) != count ||
+              IndexPad(f, h.treeOffset + count * sizeof(ulib__uint32), h.namesOffset)) ?
+             ULIB_ERROR : ULIB_SUCCESS;
+    for (i = 0; i < count && result == ULIB_SUCCESS; ++i){
+        const ulib_index_entry* e = &b->entries[i];
+        if (e->suffixLength &&
+            fwrite(&b->sorted[i].name[e->shared], sizeof(_TCHAR), e->suffixLength, f) !=
+            e->suffixLength){
+            result = ULIB_ERROR;
+        }
+    }
+    if (result == ULIB_SUCCESS){
+        result = IndexPad(f, h.namesOffset + h.namesSize * sizeof(_TCHAR), h.fileSize);
+    }
+    if (fclose(f) != 0){
+        result = ULIB_ERROR;
+    }
+    return (result);
+}
+
+void ListDirIndexBuilderInit(ListDirIndexBuilder* builder){
+    memset(builder, 0, sizeof(*builder));
+    UlibMutexInit(&builder->lock);
+}
+
+void ListDirIndexBuilderFree(ListDirIndexBuilder* builder){
+    ULIB_FREE(builder->records);
+    ULIB_FREE(builder->names);
+    UlibMutexDestroy(&builder->lock);
+}
+
+void ListDirIndexAdd(const ListDirEntry* entries, ulib__SizeType count, void* context){
+    ListDirIndexBuilder* builder = (ListDirIndexBuilder*)context;
+    ulib__SizeType i;
+    ulib__SizeType chars = 0;
+    for (i = 0; i < count; ++i){
+        chars += entries[i].nameLength;
+    }
+    UlibMutexLock(&builder->lock);
+    if (PathReserve(&builder->names, &builder->namesSize, builder->namesUsed + chars) ||
+        ArrayReserve((void**)&builder->records, &builder->size, builder->count + count,
+                       sizeof(index_record))){
+        builder->failed = ULIB_TRUE;
+        UlibMutexUnlock(&builder->lock);
+        return;
+    }
+    for (i = 0; i < count; ++i){
+        index_record* r;
+        if (entries[i].nameLength == 0 || entries[i].nameLength >= ULIB_LISTDIR_MAX_NAME ||
+            builder->count == ULIB_INDEX_NONE){
+            builder->failed = ULIB_TRUE;
+            continue;
+        }
+        r = &builder->records[builder->count++];
+        r->name = builder->namesUsed;
+        r->id = entries[i].id;
+        r->parentId = entries[i].parentId;
+        r->nameLength = (ulib__uint32)entries[i].nameLength;
+        r->type = entries[i].type;
+        memcpy(&builder->names[builder->namesUsed], entries[i].name,
+               entries[i].nameLength * sizeof(_TCHAR));
+        builder->namesUsed += entries[i].nameLength;
+    }
+    UlibMutexUnlock(&builder->lock);
+}
+
+ulib__uint8 ListDirIndexWrite(ListDirIndexBuilder* builder,
+                              const _TCHAR* dir,
+                              const _TCHAR* fileName){
+    index_build b;
+    ulib__SizeType rootLength = _tcslen(dir);
+    ulib__uint8 result = ULIB_ERROR;
+    while (rootLength && ULIB_IS_DIR_SEPARATOR(dir[rootLength - 1])){
+        --rootLength;
+    }
+    if (builder->failed){
+        return (ULIB_ERROR);
+    }
+    memset(&b, 0, sizeof(b));
+    b.count = builder->count;
+    b.restartCount = (b.count + ULIB_INDEX_RESTART - 1u) / ULIB_INDEX_RESTART;
+    // One more element, so empty arrays are allocated too
+    b.sorted = (index_sort*)malloc((b.count + 1u) * sizeof(index_sort));
+    b.dirs = (index_dir*)malloc((b.count + 1u) * sizeof(index_dir));
+    b.endings = (ulib__uint32*)malloc((b.count + 1u) * sizeof(ulib__uint32));
+    b.tree = (ulib__uint32*)malloc((b.count + 1u) * sizeof(ulib__uint32));
+    b.children = (ulib__uint32*)malloc((b.count + 1u) * sizeof(ulib__uint32));
+    b.first = (ulib__uint32*)calloc(b.count + 3u, sizeof(ulib__uint32));
+    b.entries = (ulib_index_entry*)calloc(b.count + 1u, sizeof(ulib_index_entry));
+    b.restarts = (ulib__uint64*)malloc((b.restartCount + 1u) * sizeof(ulib__uint64));
+    if (b.sorted && b.dirs && b.endings && b.tree && b.children && b.first && b.entries &&
+        b.restarts){
+        IndexSort(&b, builder);
+        IndexEncode(&b, builder);
+        if (IndexTree(&b) == ULIB_SUCCESS){
+            result = IndexSave(&b, dir, rootLength, fileName);
+        }
+    }
+    else{
+        ulibError = ULIB_MALLOC_ERROR;
+    }
+    free(b.sorted);
+    free(b.dirs);
+    free(b.endings);
+    free(b.tree);
+    free(b.children);
+    free(b.first);
+    free(b.entries);
+    free(b.restarts);
+    free(b.stack);
+    return (result);
+}
+
+ulib__uint8 ListDirIndexOpen(ListDirIndex* index, const _TCHAR* fileName){
+    const ulib_index_header* h;
+    ulib__uint64 restartCount;
+    ulib__uint8 result;
+    memset(index, 0, sizeof(*index));
+    result = UlibMapFile(&index->file, fileName, 0);
+    if (result){
+        memset(index, 0, sizeof(*index));
+        return (result);
+    }
+    h = (const ulib_index_header*)index->file.data;
+    // The sections must be in the file, in order and aligned, the rest is
+    // checked as it is read
+    if (index->file.size < sizeof(*h) || h->magic != ULIB_INDEX_MAGIC ||
+        h->version != ULIB_INDEX_VERSION || h->charSize != sizeof(_TCHAR) ||
+        h->restartInterval != ULIB_INDEX_RESTART || h->fileSize != index->file.size ||
+        h->entryCount > ULIB_INDEX_NONE || h->rootLength >= index->file.size ||
+        h->namesSize > index->file.size || ((h->entriesOffset | h->restartsOffset |
+                                        h->suffixOffset | h->treeOffset |
+                                        h->namesOffset) & 7u) ||
+        h->entriesOffset < sizeof(*h) + (h->rootLength + 1u) * sizeof(_TCHAR)){
+        ListDirIndexClose(index);
+        return (ULIB_ERROR);
+    }
+    restartCount = (h->entryCount + ULIB_INDEX_RESTART - 1u) / ULIB_INDEX_RESTART;
+    if (h->restartsOffset < h->entriesOffset + h->entryCount * sizeof(ulib_index_entry) ||
+        h->suffixOffset < h->restartsOffset + restartCount * sizeof(ulib__uint64) ||
+        h->treeOffset < h->suffixOffset + h->entryCount * sizeof(ulib__uint32) ||
+        h->namesOffset < h->treeOffset + h->entryCount * sizeof(ulib__uint32) ||
+        h->namesOffset > index->file.size ||
+        h->namesSize * sizeof(_TCHAR) > index->file.size - h->namesOffset){
+        ListDirIndexClose(index);
+        return (ULIB_ERROR);
+    }
+    index->header = h;
+    index->root = (const _TCHAR*)(index->file.data + sizeof(*h));
+    index->entries = (const ulib_index_entry*)(index->file.data + h->entriesOffset);
+    index->restarts = (const ulib__uint64*)(index->file.data + h->restartsOffset);
+    index->suffixOrder = (const ulib__uint32*)(index->file.data + h->suffixOffset);
+    index->treeOrder = (const ulib__uint32*)(index->file.data + h->treeOffset);
+    index->names = (const _TCHAR*)(index->file.data + h->namesOffset);
+    return (ULIB_SUCCESS);
+}
+
+void ListDirIndexClose(ListDirIndex* index){
+    if (index->file.data){
+        UlibUnmapFile(&index->file);
+    }
+    memset(index, 0, sizeof(*index));
+}
+
+ulib__uint64 ListDirIndexFind(const ListDirIndex* index,
+                              const _TCHAR* dir,
+                              const _TCHAR* pattern,
+                              ProcessIndexMatch processMatch,
+                              void* context){
+    index_query q;
+    index_cursor c;
+    ulib__uint64 count = index->header->entryCount;
+    ulib__SizeType patternLength = _tcslen(pattern);
+    ulib__SizeType lead = 0;
+    ulib__SizeType tail = 0;
+    ulib__uint64 begin = 0;
+    ulib__uint64 end = count;
+    ulib__uint64 cost = count;
+    ulib__uint64 suffixBegin = 0;
+    ulib__uint64 suffixEnd = 0;
+    ulib__uint64 i;
+    ulib__uint8 mode = ULIB_INDEX_SCAN;
+    q.index = index;
+    q.pattern = pattern;
+    q.dir = ULIB_INDEX_NONE;
+    q.first = 0;
+    q.end = count;
+    q.processMatch = processMatch;
+    q.context = context;
+    q.path = ULIB_NULL;
+    q.pathSize = 0;
+    q.matches = 0;
+    if (dir && IndexResolve(index, &c, dir, &q.dir) == ULIB_FALSE){
+        return (0);
+    }
+    if (q.dir != ULIB_INDEX_NONE){
+        q.first = (ulib__uint64)index->entries[q.dir].position + 1u;
+        q.end = q.first + index->entries[q.dir].subtree;
+        q.end = q.end < count ? q.end : count;
+        q.first = q.first < q.end ? q.first : q.end;
+    }
+    // The text before the first * and after the last one
+    while (lead < patternLength && pattern[lead] != _T('*')){
+        ++lead;
+    }
+    if (lead < patternLength){
+        while (pattern[patternLength - 1u - tail] != _T('*')){
+            ++tail;
+        }
+    }
+    // Names are read one after the other in the prefix range, the other
+    // ranges need a seek per name
+    if (lead){
+        begin = IndexBound(index, &c, pattern, lead, ULIB_FALSE);
+        end = IndexBound(index, &c, pattern, lead, ULIB_TRUE);
+        cost = end - begin;
+        mode = ULIB_INDEX_PREFIX;
+    }
+    if (tail){
+        suffixBegin = IndexBoundReverse(index, &c, &pattern[patternLength - tail], tail, ULIB_FALSE);
+        suffixEnd = IndexBoundReverse(index, &c, &pattern[patternLength - tail], tail, ULIB_TRUE);
+        if ((suffixEnd - suffixBegin) * ULIB_INDEX_SEEK < cost){
+            begin = suffixBegin;
+            end = suffixEnd;
+            cost = (end - begin) * ULIB_INDEX_SEEK;
+            mode = ULIB_INDEX_SUFFIX;
+        }
+    }
+    if ((q.end - q.first) * ULIB_INDEX_SEEK < cost){
+        begin = q.first;
+        end = q.end;
+        mode = ULIB_INDEX_TREE;
+    }
+    // A single * at the start or at the end, or only *: the range is the matches
+    q.exact = (lead + tail + 1u == patternLength &&
+               ((lead == 0 && tail == 0) || (mode == ULIB_INDEX_PREFIX && tail == 0) ||
+                (mode == ULIB_INDEX_SUFFIX && lead == 0))) ? ULIB_TRUE : ULIB_FALSE;
+    c.entry = count;
+    if (mode == ULIB_INDEX_SCAN || mode == ULIB_INDEX_PREFIX){
+        if (begin < end && q.exact == ULIB_FALSE && IndexSeek(index, &c, begin)){
+            end = begin;
+        }
+        for (i = begin; i < end; ++i){
+            if ((q.exact == ULIB_FALSE && i != begin && IndexDecode(index, &c, i)) ||
+                !IndexMatch(&q, &c, i)){
+                break;
+            }
+        }
+    }
+    else{
+        const ulib__uint32* order = mode == ULIB_INDEX_SUFFIX ? index->suffixOrder :
+                                                                index->treeOrder;
+        for (i = begin; i < end; ++i){
+            if (order[i] >= count || !IndexMatch(&q, &c, order[i])){
+                break;
+            }
+        }
+    }
+    free(q.path);
+    return (q.matches);
+}
+
+ulib__SizeType ListDirIndexPath(const ListDirIndex* index,
+                                const ulib__uint32 entry,
+                                _TCHAR* path,
+                                const ulib__SizeType pathSize){
+    index_cursor c;
+    ulib__uint64 count = index->header->entryCount;
+    ulib__uint64 steps = 0;
+    ulib__SizeType length = (ulib__SizeType)index->header->rootLength;
+    ulib__SizeType position;
+    ulib__uint32 e = entry;
+    // The length first, from the name lengths
+    while (e != ULIB_INDEX_NONE){
+        if (e >= count || steps++ == count){
+            return (0);
+        }
+        length += 1u + index->entries[e].shared + index->entries[e].suffixLength;
+        e = index->entries[e].parent;
+    }
+    if (length == 0 || length >= pathSize){
+        return (length);
+    }
+    // The names from the last one
+    position = length;
+    path[length] = _T('\0');
+    for (e = entry; e != ULIB_INDEX_NONE; e = index->entries[e].parent){
+        if (IndexSeek(index, &c, e)){
+            return (0);
+        }
+        position -= c.length;
+        memcpy(&path[position], c.name, c.length * sizeof(_TCHAR));
+        path[--position] = ULIB_DIR_SEPARATOR;
+    }
+    memcpy(path, index->root, position * sizeof(_TCHAR));
+    return (length);
+}
+#endif // #ifdef IMPLEMENTATION
+#ifdef __cplusplus
+} /* namespace ulib{ */
+#endif
+#endif // #ifndef _ulib_listdir_index_h_
@@ -0,0 +1,698 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  Incremental directory scans
+*  ListDirDelta() walks a tree and saves it in a snapshot file: every
+*  directory with its file id and modified time, and its entries sorted by
+*  name. The next scan loads the snapshot. A directory whose file id and
+*  modified time did not change is not read again, its entries are taken
+*  from the snapshot and only its subdirectories are checked, with one stat
+*  each. The directories that changed are read and compared with the
+*  snapshot, the differences are reported as added, removed or modified.
+*  Example:
+*   ListDirDeltaData deltaData;
+*   INIT_LISTDIRDELTADATA(deltaData);
+*   deltaData.dir = (_TCHAR*)_T("/srv/data");
+*   deltaData.snapshotFile = (_TCHAR*)_T("/var/cache/data.snapshot");
+*   deltaData.processDelta = DeltaCallBack;
+*   ListDirDelta(&deltaData);
+* NOTES:
+*   1. The modified time of a directory changes when an entry is created,
+*      removed or renamed in it, not when a file in it is written. Modified
+*      files are found only in the directories that are read again, set
+*      fullScan to read all of them.
+*   2. Without a usable snapshot (first scan, other start directory, other
+*      format) every entry is reported as added.
+*   3. The snapshot is written in the native byte order and char size. It is
+*      replaced only by a scan that ran to the end, through a temp file
+*      renamed over it, so a failed write keeps the old one.
+*   4. Symbolic links are not followed. On Windows the file id is 0, a
+*      directory is then matched by its modified time alone.
+*   5. In case of an error, the error code is stored in ulibError global variable
+***********************************************************************************/
+#ifndef _ulib_listdir_snapshot_h_
+#define _ulib_listdir_snapshot_h_
+
+#include "ulib_listdir.h"
+#include "ulib_file_io.h"
+
+#ifdef __cplusplus
+namespace ulib {
+#endif
+
+// ProcessDelta change
+#define ULIB_DELTA_ADDED     0u
+#define ULIB_DELTA_REMOVED   1u
+#define ULIB_DELTA_MODIFIED  2u  // Other type, size or modified time
+
+#define ULIB_SNAPSHOT_MAGIC   0x53444C55u  // "ULDS"
+#define ULIB_SNAPSHOT_VERSION 1u
+#define ULIB_SNAPSHOT_NONE    (~(ulib__uint64)0)
+
+#define INIT_LISTDIRDELTADATA(deltaData)\
+    deltaData.dir = ULIB_NULL;\
+    deltaData.snapshotFile = ULIB_NULL;\
+    deltaData.processDelta = ULIB_NULL;\
+    deltaData.deltaContext = ULIB_NULL;\
+    deltaData.fullScan = ULIB_FALSE;\
+    deltaData.shouldExit = ULIB_NULL;\
+    deltaData.dirsRead = 0;\
+    deltaData.dirsReused = 0;\
+    deltaData.added = 0;\
+    deltaData.removed = 0;\
+    deltaData.modified = 0;
+
+//
+// The delta callback. entry has the name, type, file id, size and modified
+// time, the new ones except for ULIB_DELTA_REMOVED. id and parentId are 0.
+// Both strings are valid during the callback.
+//
+typedef void (*ProcessDelta)(ulib__uint8 change,
+                             const _TCHAR* fullPath,
+                             const ListDirEntry* entry,
+                             void* context);
+
+typedef struct ListDirDeltaData_
+{
+IN    _TCHAR*                 dir;              /* Start dir */
+IN    _TCHAR*                 snapshotFile;     /* Loaded, then replaced with the new state */
+IN    ProcessDelta            processDelta;     /* Change callback, can be ULIB_NULL */
+IN    void*                   deltaContext;     /* Passed to processDelta */
+IN    ulib__bool              fullScan;         /* Read every directory, not only the changed ones */
+IN    volatile ulib__bool*    shouldExit;       /* This is a volatile byte set by CTRL-C handler */
+OUT   ulib__uint64            dirsRead;         /* Directories read from the disk */
+OUT   ulib__uint64            dirsReused;       /* Directories taken from the snapshot */
+OUT   ulib__uint64            added;
+OUT   ulib__uint64            removed;
+OUT   ulib__uint64            modified;
+}ListDirDeltaData;
+
+/* Snapshot file: the header, dirCount ulib_snapshot_dir, entryCount
+   ulib_snapshot_entry and namesSize chars. The directories are in the
+   order they were walked, the start directory first. The entries of a
+   directory follow each other, sorted by name. Every name ends with a
+   NUL, the start directory path is the first one. */
+typedef struct ulib_snapshot_header_
+{
+    ulib__uint32            magic;            /* ULIB_SNAPSHOT_MAGIC */
+    ulib__uint32            version;          /* ULIB_SNAPSHOT_VERSION */
+    ulib__uint32            charSize;         /* sizeof(_TCHAR) */
+    ulib__uint32            rootLength;       /* Chars in the start directory path */
+    ulib__uint64            dirCount;
+    ulib__uint64            entryCount;
+    ulib__uint64            namesSize;
+}ulib_snapshot_header;
+
+typedef struct ulib_snapshot_dir_
+{
+    ulib__uint64            fileId;
+    ulib__int64             modifiedTime;
+    ulib__uint64            parent;           /* Index, ULIB_SNAPSHOT_NONE for the start dir */
+    ulib__uint64            firstEntry;
+    ulib__uint64            entryCount;
+}ulib_snapshot_dir;
+
+typedef struct ulib_snapshot_entry_
+{
+    ulib__uint64            name;             /* Offset in the names */
+    ulib__uint64            size;
+    ulib__int64             modifiedTime;
+    ulib__uint64            fileId;
+    ulib__uint64            dir;              /* Directory index, ULIB_SNAPSHOT_NONE for the other types */
+    ulib__uint32            nameLength;
+    ulib__uint8             type;             /* ULIB_ENTRY_FILE, ULIB_ENTRY_DIR, ... */
+    ulib__uint8             reserved[3];
+}ulib_snapshot_entry;
+
+/* Public functions */
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+* Function:
+*          ulib__uint8 ListDirDelta(IN OUT ListDirDeltaData* deltaData);
+* Scans deltaData->dir, reports the changes since the snapshot in
+* deltaData->snapshotFile and saves the new snapshot there
+* Parameters:
+*      Input:  ListDirDeltaData* deltaData
+*      Return: ULIB_SUCCESS if successful, also when stopped by shouldExit
+*              ULIB_FILE_NOT_FOUND if the start directory is not found
+*              ULIB_ERROR if the memory ran out, then ulibError is
+*              ULIB_MALLOC_ERROR, or if the snapshot could not be written
+******************************************************************************/
+ulib__uint8 ListDirDelta(IN OUT ListDirDeltaData* deltaData);
+#ifdef __cplusplus
+}
+#endif
+
+/* ========================================================================= */
+#ifdef IMPLEMENTATION
+// An entry of the directory being read
+typedef struct snapshot_item_
+{
+    const _TCHAR*  name;
+    ulib__SizeType nameLength;
+    ulib__uint64   size;
+    ulib__int64    modifiedTime;
+    ulib__uint64   fileId;
+    ulib__uint8    type;
+}snapshot_item;
+
+// A directory on the walk stack. Its path is the first pathLength chars of
+// the path buffer, entry is the next of its entries to look at.
+typedef struct snapshot_frame_
+{
+    ulib__uint64   dir;
+    ulib__uint64   entry;
+    ulib__SizeType pathLength;
+    ulib__bool     read;        // The entries were read, their metadata is fresh
+}snapshot_frame;
+
+// A directory of the old snapshot whose entries are being removed
+typedef struct snapshot_removed_
+{
+    ulib__uint64   dir;
+    ulib__uint64   entry;
+    ulib__SizeType pathLength;
+}snapshot_removed;
+
+typedef struct snapshot_scan_
+{
+    ListDirDeltaData*          data;
+    /* The old snapshot, oldDirs is ULIB_NULL if there is none */
+    ulib__uint8*               file;
+    const ulib_snapshot_dir*   oldDirs;
+    const ulib_snapshot_entry* oldEntries;
+    const _TCHAR*              oldNames;
+    /* The new snapshot */
+    ulib_snapshot_dir*         dirs;
+    ulib__SizeType             dirCount;
+    ulib__SizeType             dirSize;
+    ulib_snapshot_entry*       entries;
+    ulib__SizeType             entryCount;
+    ulib__SizeType             entrySize;
+    _TCHAR*                    names;
+    ulib__SizeType             namesUsed;
+    ulib__SizeType             namesSize;
+    /* Walk state */
+    _TCHAR*                    path;
+    ulib__SizeType             pathSize;
+    snapshot_item*             items;
+    ulib__SizeType             itemSize;
+    ulib_arena                 arena;       // Names of the directory being read
+    ulib_vector                frames;
+    ulib_vector                removed;
+    dir_buffer                 buffer;
+}snapshot_scan;
+
+// Appends a name with its NUL, returns its offset or ULIB_SNAPSHOT_NONE
+static ulib__uint64 SnapshotAddName(snapshot_scan* s,
+                                    const _TCHAR* name,
+                                    const ulib__SizeType nameLength){
+    ulib__uint64 offset = s->namesUsed;
+    if (ArrayReserve((void**)&s->names, &s->namesSize,
+                        s->namesUsed + nameLength + 1u, sizeof(_TCHAR))){
+        return (ULIB_SNAPSHOT_NONE);
+    }
+    memcpy(&s->names[s->namesUsed], name, nameLength * sizeof(_TCHAR));
+    s->names[s->namesUsed + nameLength] = _T('\0');
+    s->namesUsed += nameLength + 1u;
+    return (offset);
+}
+
+// Loads the old snapshot. Anything that doesn't match dir or the format is
+// ignored, the scan then reports everything as added.
+static void SnapshotLoad(snapshot_scan* s, const _TCHAR* dir){
+    const ulib_snapshot_header* h;
+    ulib__SizeType fileSize = 0;
+    ulib__uint64 i;
+    ulib__uint64 bytes;
+    s->file = _tReadEntireFile(s->data->snapshotFile, &fileSize);
+    if (s->file == ULIB_NULL || fileSize < sizeof(ulib_snapshot_header)){
+        ULIB_FREE(s->file);
+        return;
+    }
+    h = (const ulib_snapshot_header*)s->file;
+    bytes = sizeof(ulib_snapshot_header) + h->dirCount * sizeof(ulib_snapshot_dir) +
+            h->entryCount * sizeof(ulib_snapshot_entry) + h->namesSize * sizeof(_TCHAR);
+    if (h->magic != ULIB_SNAPSHOT_MAGIC || h->version != ULIB_SNAPSHOT_VERSION ||
+        h->charSize != sizeof(_TCHAR) || h->dirCount == 0 ||
+        h->dirCount > fileSize || h->entryCount > fileSize || h->namesSize > fileSize ||
+        bytes != fileSize || h->rootLength >= h->namesSize){
+        ULIB_FREE(s->file);
+        return;
+    }
+    s->oldDirs = (const ulib_snapshot_dir*)(s->file + sizeof(ulib_snapshot_header));
+    s->oldEntries = (const ulib_snapshot_entry*)(s->oldDirs + h->dirCount);
+    s->oldNames = (const _TCHAR*)(s->oldEntries + h->entryCount);
+    // Bounds are checked once here, the scan trusts them after
+    for (i = 0; i < h->dirCount; ++i){
+        if (s->oldDirs[i].firstEntry > h->entryCount ||
+            s->oldDirs[i].entryCount > h->entryCount - s->oldDirs[i].firstEntry){
+            break;
+        }
+    }
+    if (i == h->dirCount){
+        for (i = 0; i < h->entryCount; ++i){
+            const ulib_snapshot_entry* e = &s->oldEntries[i];
+            // A dir entry points to a later directory, so there are no cycles
+            if (e->name >= h->namesSize || e->nameLength >= h->namesSize - e->name ||
+                s->oldNames[e->name + e->nameLength] != _T('\0') ||
+                (e->dir != ULIB_SNAPSHOT_NONE &&
+                 (e->dir >= h->dirCount || s->oldDirs[e->dir].firstEntry <= i))){
+                break;
+            }
+        }
+    }
+    if (i != h->entryCount || s->oldNames[h->rootLength] != _T('\0') ||
+        _tcscmp(s->oldNames, dir) != 0){
+        s->oldDirs = ULIB_NULL;
+        ULIB_FREE(s->file);
+    }
+}
+
+// The new snapshot goes to a temp file renamed over the old one, a failed
+// write leaves the old snapshot as it was
+static ulib__bool SnapshotSave(snapshot_scan* s, const ulib__SizeType rootLength){
+    ulib_snapshot_header h;
+    ulib_file_segment segments[4];
+    memset(&h, 0, sizeof(h));
+    h.magic = ULIB_SNAPSHOT_MAGIC;
+    h.version = ULIB_SNAPSHOT_VERSION;
+    h.charSize = sizeof(_TCHAR);
+    h.rootLength = (ulib__uint32)rootLength;
+    h.dirCount = s->dirCount;
+    h.entryCount = s->entryCount;
+    h.namesSize = s->namesUsed;
+    segments[0].data = &h;
+    segments[0].size = sizeof(h);
+    segments[1].data = s->dirs;
+    segments[1].size = s->dirCount * sizeof(ulib_snapshot_dir);
+    segments[2].data = s->entries;
+    segments[2].size = s->entryCount * sizeof(ulib_snapshot_entry);
+    segments[3].data = s->names;
+    segments[3].size = s->namesUsed * sizeof(_TCHAR);
+    return (_tWriteEntireFileV(s->data->snapshotFile, segments, 4u, ULIB_WRITE_ATOMIC) ==
+            ULIB_SUCCESS ? ULIB_SUCCESS : ULIB_ERROR);
+}
+
+// Appends name to the path of a directory, returns the new path length
+static ulib__SizeType SnapshotPath(snapshot_scan* s,
+                                   const ulib__SizeType pathLength,
+                                   const _TCHAR* name,
+                                   const ulib__SizeType nameLength){
+    if (PathReserve(&s->path, &s->pathSize,
+                    pathLength + 1u + nameLength + ULIB_DIR_PATH_EXTRA)){
+        return (0);
+    }
+    s->path[pathLength] = ULIB_DIR_SEPARATOR;
+    memcpy(&s->path[pathLength + 1u], name, nameLength * sizeof(_TCHAR));
+    s->path[pathLength + 1u + nameLength] = _T('\0');
+    return (pathLength + 1u + nameLength);
+}
+
+static void SnapshotReport(snapshot_scan* s,
+                           const ulib__uint8 change,
+                           const ulib__SizeType pathLength,
+                           const _TCHAR* name,
+                           const ulib__SizeType nameLength,
+                           const ulib__uint8 type,
+                           const ulib__uint64 fileId,
+                           const ulib__uint64 size,
+                           const ulib__int64 modifiedTime){
+    ListDirDeltaData* data = s->data;
+    ListDirEntry e;
+    if (change == ULIB_DELTA_ADDED){
+        ++data->added;
+    }
+    else if (change == ULIB_DELTA_REMOVED){
+        ++data->removed;
+    }
+    else{
+        ++data->modified;
+    }
+    if (data->processDelta == ULIB_NULL ||
+        SnapshotPath(s, pathLength, name, nameLength) == 0){
+        return;
+    }
+    e.name = &s->path[pathLength + 1u];
+    e.nameLength = nameLength;
+    e.id = 0;
+    e.parentId = 0;
+    e.fileId = fileId;
+    e.size = size;
+    e.modifiedTime = modifiedTime;
+    e.creationTime = 0;
+    e.type = type;
+    data->processDelta(change, s->path, &e, data->deltaContext);
+}
+
+// Reports the old entry and, for a directory, everything under it
+static ulib__bool SnapshotRemove(snapshot_scan* s,
+                                 const ulib__SizeType pathLength,
+                                 const ulib__uint64 index){
+    const ulib_snapshot_entry* e = &s->oldEntries[index];
+    snapshot_removed* top;
+    ulib__SizeType childLength;
+    SnapshotReport(s, ULIB_DELTA_REMOVED, pathLength, &s->oldNames[e->name],
+                   e->nameLength, e->type, e->fileId, e->size, e->modifiedTime);
+    if (e->dir == ULIB_SNAPSHOT_NONE){
+        return (ULIB_SUCCESS);
+    }
+    childLength = SnapshotPath(s, pathLength, &s->oldNames[e->name], e->nameLength);
+    top = (snapshot_removed*)UlibVectorEmplace(&s->removed, 1u);
+    if (childLength == 0 || top == ULIB_NULL){
+        return (ULIB_ERROR);
+    }
+    top->dir = e->dir;
+    top->entry = s->oldDirs[e->dir].firstEntry;
+    top->pathLength = childLength;
+    while ((top = (snapshot_removed*)UlibVectorPeek(&s->removed, ULIB_NULL)) != ULIB_NULL){
+        snapshot_removed next;
+        if (top->entry == s->oldDirs[top->dir].firstEntry + s->oldDirs[top->dir].entryCount){
+            // The vector frees itself when emptied, the last frame is kept
+            if (UlibVectorCount(&s->removed) == 1u){
+                break;
+            }
+            UlibVectorPop(&s->removed, ULIB_NULL);
+            continue;
+        }
+        e = &s->oldEntries[top->entry++];
+        SnapshotReport(s, ULIB_DELTA_REMOVED, top->pathLength, &s->oldNames[e->name],
+                       e->nameLength, e->type, e->fileId, e->size, e->modifiedTime);
+        if (e->dir == ULIB_SNAPSHOT_NONE){
+            continue;
+        }
+        next.dir = e->dir;
+        next.entry = s->oldDirs[e->dir].firstEntry;
+        next.pathLength = SnapshotPath(s, top->pathLength, &s->oldNames[e->name],
+                                       e->nameLength);
+        if (next.pathLength == 0 || UlibVectorPush(&s->removed, &next, 1u)){
+            return (ULIB_ERROR);
+        }
+    }
+    // Leave the one frame, its entries are all done
+    if (top){
+        top->entry = s->oldDirs[top->dir].firstEntry + s->oldDirs[top->dir].entryCount;
+    }
+    return (ULIB_SUCCESS);
+}
+
+// Adds an entry to the new snapshot. dir is the old directory index of a
+// directory, replaced by the new one when the directory is visited.
+static ulib__bool SnapshotAddEntry(snapshot_scan* s,
+                                   const _TCHAR* name,
+                                   const ulib__SizeType nameLength,
+                                   const ulib__uint8 type,
+                                   const ulib__uint64 fileId,
+                                   const ulib__uint64 size,
+                                   const ulib__int64 modifiedTime,
+                                   const ulib__uint64 dir){
+    ulib_snapshot_entry* e;
+    if (ArrayReserve((void**)&s->entries, &s->entrySize, s->entryCount + 1u,
+                        sizeof(ulib_snapshot_entry))){
+        return (ULIB_ERROR);
+    }
+    e = &s->entries[s->entryCount];
+    memset(e, 0, sizeof(*e));
+    e->name = SnapshotAddName(s, name, nameLength);
+    if (e->name == ULIB_SNAPSHOT_NONE){
+        return (ULIB_ERROR);
+    }
+    e->nameLength = (ulib__uint32)nameLength;
+    e->type = type;
+    e->fileId = fileId;
+    e->size = size;
+    e->modifiedTime = modifiedTime;
+    e->dir = (type == ULIB_ENTRY_DIR) ? dir : ULIB_SNAPSHOT_NONE;
+    ++s->entryCount;
+    return (ULIB_SUCCESS);
+}
+
+static int SnapshotCompareItems(const void* a, const void* b){
+    return (_tcscmp(((const snapshot_item*)a)->name, ((const snapshot_item*)b)->name));
+}
+
+// Reads the directory at the top of the path, adds its entries sorted by
+// name and reports the differences with the old directory
+static ulib__bool SnapshotRead(snapshot_scan* s,
+                               const ulib__SizeType pathLength,
+                               const ulib__uint64 oldDir){
+    dir_reader reader;
+    dir_entry entry;
+    ulib_arena_mark mark = UlibArenaMark(&s->arena);
+    ulib__SizeType count = 0;
+    ulib__SizeType i = 0;
+    ulib__uint64 j = 0;
+    ulib__uint64 oldEnd = 0;
+    ulib__bool result = ULIB_SUCCESS;
+    ulib__uint8 opened;
+    ++s->data->dirsRead;
+    // A directory that can't be opened is empty, unless it failed for
+    // another reason, like running out of descriptors
+    opened = DirOpen(&reader, &s->buffer, ULIB_NO_DIR_HANDLE, s->path, s->path, pathLength);
+    if (opened == ULIB_ERROR){
+        result = ULIB_ERROR;
+    }
+    else if (opened == ULIB_SUCCESS){
+        while (DirNext(&reader, &s->buffer, &entry)){
+            snapshot_item* item;
+            _TCHAR* name;
+            if (ArrayReserve((void**)&s->items, &s->itemSize, count + 1u,
+                                sizeof(snapshot_item))){
+                result = ULIB_ERROR;
+                break;
+            }
+            name = (_TCHAR*)UlibArenaAlloc(&s->arena, (entry.nameLength + 1u) * sizeof(_TCHAR));
+            if (name == ULIB_NULL){
+                result = ULIB_ERROR;
+                break;
+            }
+            DirStat(&reader, &s->buffer, &entry);
+            memcpy(name, entry.name, (entry.nameLength + 1u) * sizeof(_TCHAR));
+            item = &s->items[count++];
+            item->name = name;
+            item->nameLength = entry.nameLength;
+            item->type = entry.type;
+            item->fileId = entry.fileId;
+            item->size = entry.isDir ? 0 : entry.size;
+            item->modifiedTime = entry.modifiedTime;
+        }
+        if (reader.error){
+            result = ULIB_ERROR;
+        }
+        DirClose(&reader);
+        DirHandleClose(reader.handle);
+    }
+    qsort(s->items, count, sizeof(snapshot_item), SnapshotCompareItems);
+    if (oldDir != ULIB_SNAPSHOT_NONE){
+        j = s->oldDirs[oldDir].firstEntry;
+        oldEnd = j + s->oldDirs[oldDir].entryCount;
+    }
+    // Merge of the two sorted lists
+    while (result == ULIB_SUCCESS && (i < count || j < oldEnd)){
+        const snapshot_item* item = (i < count) ? &s->items[i] : ULIB_NULL;
+        const ulib_snapshot_entry* old = (j < oldEnd) ? &s->oldEntries[j] : ULIB_NULL;
+        int order = (item == ULIB_NULL) ? 1 : (old == ULIB_NULL) ? -1 :
+                    _tcscmp(item->name, &s->oldNames[old->name]);
+        if (order > 0 || (order == 0 && item->type != old->type)){
+            // Gone, or replaced by an entry of another type
+            result = SnapshotRemove(s, pathLength, j++);
+            if (order > 0){
+                continue;
+            }
+            order = -1;
+        }
+        if (order < 0){
+            SnapshotReport(s, ULIB_DELTA_ADDED, pathLength, item->name, item->nameLength,
+                           item->type, item->fileId, item->size, item->modifiedTime);
+            result |= SnapshotAddEntry(s, item->name, item->nameLength, item->type,
+                                       item->fileId, item->size, item->modifiedTime,
+                                       ULIB_SNAPSHOT_NONE);
+            ++i;
+            continue;
+        }
+        if (item->type != ULIB_ENTRY_DIR &&
+            (item->size != old->size || item->modifiedTime != old->modifiedTime)){
+            SnapshotReport(s, ULIB_DELTA_MODIFIED, pathLength, item->name, item->nameLength,
+                           item->type, item->fileId, item->size, item->modifiedTime);
+        }
+        result |= SnapshotAddEntry(s, item->name, item->nameLength, item->type,
+                                   item->fileId, item->size, item->modifiedTime, old->dir);
+        ++i;
+        ++j;
+    }
+    UlibArenaRewind(&s->arena, mark);
+    return (result);
+}
+
+// Copies the entries of an unchanged directory from the old snapshot
+static ulib__bool SnapshotReuse(snapshot_scan* s, const ulib__uint64 oldDir){
+    ulib__uint64 j = s->oldDirs[oldDir].firstEntry;
+    ulib__uint64 end = j + s->oldDirs[oldDir].entryCount;
+    ++s->data->dirsReused;
+    for (; j < end; ++j){
+        const ulib_snapshot_entry* old = &s->oldEntries[j];
+        if (SnapshotAddEntry(s, &s->oldNames[old->name], old->nameLength, old->type,
+                             old->fileId, old->size, old->modifiedTime, old->dir)){
+            return (ULIB_ERROR);
+        }
+    }
+    return (ULIB_SUCCESS);
+}
+
+// Adds the directory at the top of the path to the new snapshot, with its
+// entries, and pushes it on the walk stack
+static ulib__bool SnapshotVisit(snapshot_scan* s,
+                                const ulib__SizeType pathLength,
+                                const ulib__uint64 parent,
+                                const ulib__uint64 oldDir,
+                                const ulib__uint64 fileId,
+                                const ulib__int64 modifiedTime){
+    ulib_snapshot_dir* d;
+    snapshot_frame* top;
+    ulib__uint64 index = s->dirCount;
+    ulib__bool reuse = (oldDir != ULIB_SNAPSHOT_NONE && s->data->fullScan == ULIB_FALSE &&
+                        s->oldDirs[oldDir].fileId == fileId &&
+                        s->oldDirs[oldDir].modifiedTime == modifiedTime) ?
+                       ULIB_TRUE : ULIB_FALSE;
+    if (ArrayReserve((void**)&s->dirs, &s->dirSize, s->dirCount + 1u,
+                        sizeof(ulib_snapshot_dir))){
+        return (ULIB_ERROR);
+    }
+    d = &s->dirs[s->dirCount++];
+    d->fileId = fileId;
+    d->modifiedTime = modifiedTime;
+    d->parent = parent;
+    d->firstEntry = s->entryCount;
+    if (reuse ? SnapshotReuse(s, oldDir) : SnapshotRead(s, pathLength, oldDir)){
+        return (ULIB_ERROR);
+    }
+    s->dirs[index].entryCount = s->entryCount - s->dirs[index].firstEntry;
+    top = (snapshot_frame*)UlibVectorEmplace(&s->frames, 1u);
+    if (top == ULIB_NULL){
+        return (ULIB_ERROR);
+    }
+    top->dir = index;
+    top->entry = s->dirs[index].firstEntry;
+    top->pathLength = pathLength;
+    top->read = reuse ? ULIB_FALSE : ULIB_TRUE;
+    return (ULIB_SUCCESS);
+}
+
+// Walks the tree, depth first, from the start directory
+static ulib__uint8 SnapshotWalk(snapshot_scan* s, ulib__SizeType pathLength){
+    ListDirDeltaData* data = s->data;
+    dir_entry root;
+    snapshot_frame* top;
+    if (PathStat(data->dir, &root) || root.isDir == ULIB_FALSE){
+        return (ULIB_FILE_NOT_FOUND);
+    }
+    if (SnapshotVisit(s, pathLength, ULIB_SNAPSHOT_NONE, s->oldDirs ? 0 : ULIB_SNAPSHOT_NONE,
+                      root.fileId, root.modifiedTime)){
+        return (ULIB_ERROR);
+    }
+    while ((top = (snapshot_frame*)UlibVectorPeek(&s->frames, ULIB_NULL)) != ULIB_NULL){
+        ulib_snapshot_entry* e;
+        ulib__uint64 entry;
+        if (data->shouldExit && *data->shouldExit){
+            return (ULIB_SUCCESS);
+        }
+        if (top->entry == s->dirs[top->dir].firstEntry + s->dirs[top->dir].entryCount){
+            // The vector frees itself when emptied, the last frame is kept
+            if (UlibVectorCount(&s->frames) == 1u){
+                break;
+            }
+            UlibVectorPop(&s->frames, ULIB_NULL);
+            continue;
+        }
+        entry = top->entry++;
+        e = &s->entries[entry];
+        if (e->type != ULIB_ENTRY_DIR){
+            continue;
+        }
+        pathLength = SnapshotPath(s, top->pathLength, &s->names[e->name], e->nameLength);
+        if (pathLength == 0){
+            return (ULIB_ERROR);
+        }
+        if (top->read == ULIB_FALSE){
+            // The parent was reused, the metadata of the entry is old
+            dir_entry stat;
+            if (PathStat(s->path, &stat) == ULIB_SUCCESS){
+                e->fileId = stat.fileId;
+                e->modifiedTime = stat.modifiedTime;
+            }
+            else{
+                e->modifiedTime = 0;
+            }
+        }
+        // top and e move when the arrays grow
+        if (SnapshotVisit(s, pathLength, top->dir, e->dir, e->fileId, e->modifiedTime)){
+            return (ULIB_ERROR);
+        }
+        s->entries[entry].dir = s->dirCount - 1u;
+    }
+    return (SnapshotSave(s, _tcslen(data->dir)));
+}
+
+ulib__uint8 ListDirDelta(ListDirDeltaData* data){
+    snapshot_scan s;
+    ulib__SizeType dirLength = _tcslen(data->dir);
+    ulib__uint8 result = ULIB_ERROR;
+    memset(&s, 0, sizeof(s));
+    s.data = data;
+    data->dirsRead = 0;
+    data->dirsReused = 0;
+    data->added = 0;
+    data->removed = 0;
+    data->modified = 0;
+    INIT_ULIB_ARENA(s.arena, 64u * ULIB_KILOBYTE);
+    INIT_ULIB_VECTOR_FIXED(s.frames, 64u * sizeof(snapshot_frame), sizeof(snapshot_frame));
+    INIT_ULIB_VECTOR_FIXED(s.removed, 64u * sizeof(snapshot_removed), sizeof(snapshot_removed));
+    if (s.frames.workBuffer && s.removed.workBuffer && DirBufferInit(&s.buffer) == ULIB_SUCCESS &&
+        SnapshotAddName(&s, data->dir, dirLength) != ULIB_SNAPSHOT_NONE &&
+        PathReserve(&s.path, &s.pathSize, dirLength + ULIB_DIR_PATH_EXTRA) == ULIB_SUCCESS){
+        SnapshotLoad(&s, data->dir);
+        memcpy(s.path, data->dir, (dirLength + 1u) * sizeof(_TCHAR));
+        // The names are appended after a separator
+        while (dirLength && ULIB_IS_DIR_SEPARATOR(s.path[dirLength - 1])){
+            s.path[--dirLength] = _T('\0');
+        }
+        result = SnapshotWalk(&s, dirLength);
+    }
+    DirBufferFree(&s.buffer);
+    UlibVectorFree(&s.frames);
+    UlibVectorFree(&s.removed);
+    ULIB_FREE(s.frames.bufferTable);
+    ULIB_FREE(s.removed.bufferTable);
+    UlibArenaFree(&s.arena);
+    ULIB_FREE(s.file);
+    ULIB_FREE(s.dirs);
+    ULIB_FREE(s.entries);
+    ULIB_FREE(s.names);
+    ULIB_FREE(s.items);
+    ULIB_FREE(s.path);
+    return (result);
+}
+#endif // #ifdef IMPLEMENTATION
+#ifdef __cplusplus
+} /* namespace ulib{ */
+#endif
+#endif // #ifndef _ulib_listdir_snapshot_h_
@@ -0,0 +1,293 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  Threads, mutexes and atomic counters
+*  Thin wrappers over the Windows API and pthreads.
+*  Example:
+*   static void Work(void* arg);
+*   ulib_thread thread;
+*   if (UlibThreadStart(&thread, Work, arg) == ULIB_SUCCESS)
+*       UlibThreadJoin(&thread);
+* NOTES:
+*   1. The ulib_thread structure must stay valid until UlibThreadJoin().
+*   2. On Linux, link with -pthread.
+*   3. The atomic functions are full barriers.
+***********************************************************************************/
+#ifndef _ulib_thread_h_
+#define _ulib_thread_h_
+
+#include "ulib_common.h"
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+namespace ulib{
+#endif
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+    typedef void (*UlibThreadFunction)(void* arg);
+
+    typedef struct ulib_thread_ {
+#ifdef _WIN32
+        HANDLE              handle;
+#else
+        pthread_t           handle;
+#endif
+        UlibThreadFunction  function;
+        void*               arg;
+    }ulib_thread;
+
+#ifdef _WIN32
+    typedef CRITICAL_SECTION ulib_mutex;
+#else
+    typedef pthread_mutex_t  ulib_mutex;
+#endif
+
+    typedef volatile ulib__int32 ulib_atomic32;
+    typedef volatile ulib__int64 ulib_atomic64;
+
+/******************************************************************************
+* Function:
+*          ulib__bool UlibThreadStart(OUT ulib_thread* thread,
+*                                     IN UlibThreadFunction function,
+*                                     IN void* arg);
+* Runs function(arg) on a new thread
+* Parameters:
+*      Input:  UlibThreadFunction function
+*              void* arg
+*      Output: ulib_thread* thread
+*      Return: ULIB_SUCCESS if the thread was started
+*              ULIB_ERROR otherwise
+******************************************************************************/
+    ulib__bool UlibThreadStart(OUT ulib_thread* thread,
+                               IN UlibThreadFunction function,
+                               IN void* arg);
+
+/******************************************************************************
+* Function:
+*          void UlibThreadJoin(IN ulib_thread* thread);
+* Waits for the thread to end and releases it
+******************************************************************************/
+    void UlibThreadJoin(IN ulib_thread* thread);
+
+/******************************************************************************
+* Function:
+*          void UlibThreadYield(void);
+*          void UlibThreadSleep(IN const ulib__uint32 milliseconds);
+* Gives the CPU to another thread / sleeps the calling thread
+******************************************************************************/
+    void UlibThreadYield(void);
+    void UlibThreadSleep(IN const ulib__uint32 milliseconds);
+
+/******************************************************************************
+* Function:
+*          ulib__uint32 UlibCpuCount(void);
+* Number of logical processors, at least 1
+******************************************************************************/
+    ulib__uint32 UlibCpuCount(void);
+
+/******************************************************************************
+* Function:
+*          void UlibMutexInit(OUT ulib_mutex* mutex);
+*          void UlibMutexLock(IN ulib_mutex* mutex);
+*          void UlibMutexUnlock(IN ulib_mutex* mutex);
+*          void UlibMutexDestroy(IN ulib_mutex* mutex);
+******************************************************************************/
+    void UlibMutexInit(OUT ulib_mutex* mutex);
+    void UlibMutexLock(IN ulib_mutex* mutex);
+    void UlibMutexUnlock(IN ulib_mutex* mutex);
+    void UlibMutexDestroy(IN ulib_mutex* mutex);
+
+/******************************************************************************
+* Function:
+*          ulib__int32 UlibAtomicAdd(IN ulib_atomic32* value,
+*                                    IN const ulib__int32 add);
+*          ulib__int64 UlibAtomicAdd64(IN ulib_atomic64* value,
+*                                      IN const ulib__int64 add);
+* Adds add to value
+* Return: the new value
+******************************************************************************/
+    ulib__int32 UlibAtomicAdd(IN ulib_atomic32* value,
+                              IN const ulib__int32 add);
+    ulib__int64 UlibAtomicAdd64(IN ulib_atomic64* value,
+                                IN const ulib__int64 add);
+
+/******************************************************************************
+* Function:
+*          ulib__int32 UlibAtomicLoad(IN ulib_atomic32* value);
+*          void UlibAtomicStore(IN ulib_atomic32* value,
+*                               IN const ulib__int32 newValue);
+******************************************************************************/
+    ulib__int32 UlibAtomicLoad(IN ulib_atomic32* value);
+    void UlibAtomicStore(IN ulib_atomic32* value,
+                         IN const ulib__int32 newValue);
+#ifdef __cplusplus
+} // extern "C" {
+#endif
+
+/* ========================================================================= */
+#ifdef IMPLEMENTATION
+#ifdef _WIN32
+static DWORD WINAPI ThreadEntry(LPVOID arg){
+    ulib_thread* thread = (ulib_thread*)arg;
+    thread->function(thread->arg);
+    return (0);
+}
+
+ulib__bool UlibThreadStart(ulib_thread* thread,
+                           UlibThreadFunction function,
+                           void* arg){
+    thread->function = function;
+    thread->arg = arg;
+    thread->handle = CreateThread(ULIB_NULL, 0, ThreadEntry, thread, 0, ULIB_NULL);
+    return (thread->handle ? ULIB_SUCCESS : ULIB_ERROR);
+}
+
+void UlibThreadJoin(ulib_thread* thread){
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+void UlibThreadYield(void){
+    SwitchToThread();
+}
+
+void UlibThreadSleep(const ulib__uint32 milliseconds){
+    Sleep(milliseconds);
+}
+
+ulib__uint32 UlibCpuCount(void){
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1u);
+}
+
+void UlibMutexInit(ulib_mutex* mutex){
+    InitializeCriticalSection(mutex);
+}
+
+void UlibMutexLock(ulib_mutex* mutex){
+    EnterCriticalSection(mutex);
+}
+
+void UlibMutexUnlock(ulib_mutex* mutex){
+    LeaveCriticalSection(mutex);
+}
+
+void UlibMutexDestroy(ulib_mutex* mutex){
+    DeleteCriticalSection(mutex);
+}
+
+ulib__int32 UlibAtomicAdd(ulib_atomic32* value, const ulib__int32 add){
+    return (InterlockedExchangeAdd((volatile LONG*)value, add) + add);
+}
+
+ulib__int64 UlibAtomicAdd64(ulib_atomic64* value, const ulib__int64 add){
+    return (InterlockedExchangeAdd64((volatile LONG64*)value, add) + add);
+}
+
+ulib__int32 UlibAtomicLoad(ulib_atomic32* value){
+    return (InterlockedCompareExchange((volatile LONG*)value, 0, 0));
+}
+
+void UlibAtomicStore(ulib_atomic32* value, const ulib__int32 newValue){
+    InterlockedExchange((volatile LONG*)value, newValue);
+}
+#else
+static void* ThreadEntry(void* arg){
+    ulib_thread* thread = (ulib_thread*)arg;
+    thread->function(thread->arg);
+    return (ULIB_NULL);
+}
+
+ulib__bool UlibThreadStart(ulib_thread* thread,
+                           UlibThreadFunction function,
+                           void* arg){
+    thread->function = function;
+    thread->arg = arg;
+    if (pthread_create(&thread->handle, ULIB_NULL, ThreadEntry, thread) != 0){
+        return (ULIB_ERROR);
+    }
+    return (ULIB_SUCCESS);
+}
+
+void UlibThreadJoin(ulib_thread* thread){
+    pthread_join(thread->handle, ULIB_NULL);
+}
+
+void UlibThreadYield(void){
+    sched_yield();
+}
+
+void UlibThreadSleep(const ulib__uint32 milliseconds){
+    struct timespec t;
+    t.tv_sec = milliseconds / 1000u;
+    t.tv_nsec = (long)(milliseconds % 1000u) * 1000000L;
+    nanosleep(&t, ULIB_NULL);
+}
+
+ulib__uint32 UlibCpuCount(void){
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0 ? (ulib__uint32)count : 1u);
+}
+
+void UlibMutexInit(ulib_mutex* mutex){
+    pthread_mutex_init(mutex, ULIB_NULL);
+}
+
+void UlibMutexLock(ulib_mutex* mutex){
+    pthread_mutex_lock(mutex);
+}
+
+void UlibMutexUnlock(ulib_mutex* mutex){
+    pthread_mutex_unlock(mutex);
+}
+
+void UlibMutexDestroy(ulib_mutex* mutex){
+    pthread_mutex_destroy(mutex);
+}
+
+ulib__int32 UlibAtomicAdd(ulib_atomic32* value, const ulib__int32 add){
+    return (__atomic_add_fetch(value, add, __ATOMIC_SEQ_CST));
+}
+
+ulib__int64 UlibAtomicAdd64(ulib_atomic64* value, const ulib__int64 add){
+    return (__atomic_add_fetch(value, add, __ATOMIC_SEQ_CST));
+}
+
+ulib__int32 UlibAtomicLoad(ulib_atomic32* value){
+    return (__atomic_load_n(value, __ATOMIC_SEQ_CST));
+}
+
+void UlibAtomicStore(ulib_atomic32* value, const ulib__int32 newValue){
+    __atomic_store_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+#endif // #ifdef _WIN32
+#endif // #ifdef IMPLEMENTATION
+#ifdef __cplusplus // namespace ulib{
+}
+#endif
+#endif // #ifndef _ulib_thread_h_
@@ -1,237 +1,1261 @@
-/*
-
-Copyright (c) 2018-2021, Croitor Cristian
-
-THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
-AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
-ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
-LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
-CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
-SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
-INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
-CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
-ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
-POSSIBILITY OF SUCH DAMAGE.
-
-For licensing, please check the LICENSE file included with the source code.
-*/
-
-/***********************************************************************************
-*  Implementation of a LIFO linear vector
-*  Pushing the data results in a copy in the vector buffer
-*  Popping the data gets you a copy of the data, and moves the last index down
-*  Iteration over the whole vector can be done like this:
-*   while (UlibVectorPop(output) == ULIB_SUCCESS)
-* NOTES:
-*   1. The vector uses buffers of fixed size specified: BufferSize * ElementSize
-*       INIT_ULIB_VECTOR(vec, BufferSize, ElementSize)
-*   2. If the buffer fills, a new one is allocated of the same size.
-*   3. The size of this buffer should be determined by user.
-*   4. Pop function automatically frees the memory used by the buffer
-*   5. In case of an error, the error code is stored in ulibError global variable
-*   UlibGetLastErrorText(char* str) can be used to get the error text description
-***********************************************************************************/
-#ifndef _ulib_vector_h_
-#define _ulib_vector_h_
-
-#include "ulib_common.h"
-
-#ifdef __cplusplus
-namespace ulib{
-#endif
-
-#ifdef __cplusplus
-extern "C"{
-#endif
-    typedef struct buffer_ {
-        ulib__uint8*       data;
-        struct buffer_*    previousBuffer;
-        ulib__SizeType     lastIndex;
-    }buffer;
-
-    typedef struct ulib_vector_ {
-        ulib__SizeType   bufferSize;     // Buffer size
-        ulib__SizeType   elemSize;       // Element size
-        buffer*          workBuffer;     // The current working buffer
-        ulib__SizeType   lastIndexSize;  // Last index size in bytes
-        ulib__uint32     ulibVectorAllocations;
-        ulib__uint32     ulibVectorFree;
-    }ulib_vector;
-
-    buffer* Allocate(IN ulib_vector*);
-
-#define INIT_ULIB_VECTOR(vec, BufferSize, ElementSize)\
-    vec.bufferSize = BufferSize;\
-    vec.elemSize = ElementSize;\
-    vec.ulibVectorAllocations = 0u;\
-    vec.ulibVectorFree = 0u;\
-    vec.workBuffer = Allocate(&vec);\
-    vec.lastIndexSize = sizeof(vec.workBuffer->lastIndex);
-
-
-/* Public functions */
-/******************************************************************************
-* Function:
-*           ulib__bool UlibVectorPush(IN ulib_vector* v,
-*                                     IN const void* data,
-*                                     IN const ulib__SizeType length);
-* Parameters:
-*      Input:  ulib_vector* v
-*              const void* data
-*              const ulib__SizeType length
-*      Return: ULIB_SUCCESS if successful
-*              ULIB_ERROR if an error occurred
-******************************************************************************/
-    ulib__bool UlibVectorPush(IN ulib_vector* v,
-                              IN const void* data,
-                              IN const ulib__SizeType length);
-
-/******************************************************************************
-* Function:
-*           ulib__bool UlibVectorPop(IN ulib_vector* v, OUT void* output);
-* Parameters:
-*      Output:  void* output
-*      Return: ULIB_SUCCESS if successful
-*              ULIB_ERROR if no more strings are stored in the vector
-******************************************************************************/
-    ulib__bool UlibVectorPop(IN ulib_vector* v, OUT void* output);
-
-/******************************************************************************
-* Function:
-*          void UlibVectorFree(IN ulib_vector* v);
-* Frees all memory used by the vector, used in case not all the vector was
-* traversed using UlibVectorPop()
-* Parameters:
-*      Input:  ulib_vector* v
-*      Return: none
-******************************************************************************/
-    void UlibVectorFree(IN ulib_vector* v);
-#ifdef __cplusplus
-}
-#endif
-
-/******************************************************************************
-* Internal functions
-******************************************************************************/
-// Statistics - total number of allocations
-#ifdef IMPLEMENTATION
-buffer* Allocate(ulib_vector* v){
-    buffer* buff = (buffer*)malloc(sizeof(buffer));
-    if (buff){
-        buff->data = (ulib__uint8*)malloc(v->elemSize * v->bufferSize);
-        if (buff->data){
-            buff->previousBuffer = ULIB_NULL;
-            buff->lastIndex = 0;
-#ifdef ULIB_VECTOR_DEBUG
-            ++(v->ulibVectorAllocations);
-#endif
-            return (buff);
-        }
-        ULIB_FREE(buff->data);
-        ulibError = ULIB_MALLOC_ERROR;
-        return (ULIB_NULL);
-    }
-    ULIB_FREE(buff);
-    ulibError = ULIB_MALLOC_ERROR;
-    return (ULIB_NULL);
-}
-
-void Free(buffer** buf, ulib__uint32* count){
-    ULIB_FREE((*buf)->data);
-    ULIB_FREE(*buf);
-#ifdef ULIB_VECTOR_DEBUG
-    ++(*count);
-#else
-    ULIB_UNUSED(count);
-#endif
-}
-
-
-void UlibVectorFree(ulib_vector* v){
-    if (v){
-        while (UlibVectorPop(v, ULIB_NULL));
-    }
-}
-
-ulib__bool UlibVectorPushElement(ulib_vector* v,
-                                 const void* data) {
-    return UlibVectorPush(v, data, v->elemSize);
-}
-
-ulib__bool UlibVectorPush(ulib_vector* v,
-                          const void* data,
-                          const ulib__SizeType length){
-    if (v){
-        if (v->workBuffer){
-            ulib__SizeType len = v->elemSize * length;
-            ulib__SizeType startOffset = v->workBuffer->lastIndex;
-            // Data and index is bigger than the chunk allocated of BUFFER_SIZE
-            if (len + v->lastIndexSize > v->bufferSize){
-                ulibError = ULIB_VECTOR_BUFFER_TOO_SMALL;
-                return (ULIB_ERROR);
-            }
-            else if (startOffset + len + v->lastIndexSize > v->bufferSize){// Does not fit in current buffer, a new one is needed
-                buffer* newMem = Allocate(v);
-                if (newMem == ULIB_NULL){
-                    return (ULIB_ERROR);
-                }
-                newMem->previousBuffer = v->workBuffer;
-                v->workBuffer = newMem;
-                startOffset = 0;
-            } // else if (startOffset + len + v->lastIndexSize > BUFFER_SIZE)
-            if (data){
-                memcpy(&v->workBuffer->data[v->workBuffer->lastIndex], data, len);
-                v->workBuffer->lastIndex += len;
-                memcpy(&v->workBuffer->data[v->workBuffer->lastIndex],
-                       &startOffset,
-                       v->lastIndexSize);
-                v->workBuffer->lastIndex += v->lastIndexSize;
-                return (ULIB_SUCCESS);
-            }
-        }// if (v->workBuffer)
-        ulibError = ULIB_VECTOR_NOT_INIT;
-    }// if (v)
-    return (ULIB_ERROR);
-}
-
-
-ulib__bool UlibVectorPop(ulib_vector* v, void* output){
-    if (v){// Data valid in current work buffer
-        ulib__SizeType start_offset;
-        if (!v->workBuffer){
-            ulibError = ULIB_INVALID_VECTOR;
-            return (ULIB_ERROR);
-        }
-        // Check if we still have data in work buffer
-        if (v->workBuffer->lastIndex == 0 && v->workBuffer->previousBuffer != ULIB_NULL){
-            buffer* current = v->workBuffer;
-            v->workBuffer = v->workBuffer->previousBuffer;
-            Free(&current, &v->ulibVectorFree);
-        }
-        if (v->workBuffer->lastIndex == 0){
-            // Got to the beginning of the list
-            Free(&v->workBuffer, &v->ulibVectorFree);
-            return (ULIB_ERROR);
-        }
-        // Get the index in the buffer
-        memcpy(&start_offset,
-               &v->workBuffer->data[v->workBuffer->lastIndex - v->lastIndexSize],
-               v->lastIndexSize);
-        // Get the string
-        if (output){
-            memcpy(output,
-                   &v->workBuffer->data[start_offset],
-                   v->workBuffer->lastIndex - v->lastIndexSize - start_offset);
-        }
-        v->workBuffer->lastIndex = start_offset;
-        return (ULIB_SUCCESS);
-    } // if (v)
-    return (ULIB_ERROR);
-}
-
-#endif // IMPLEMENTATION
-#ifdef __cplusplus
-} // namespace ulib
-#endif
-#endif // _ulib_vector_h_
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  Implementation of a LIFO linear vector
+*  Pushing the data results in a copy in the vector buffer
+*  Popping the data gets you a copy of the data, and moves the last index down
+*  Iteration over the whole vector can be done like this:
+*   while (UlibVectorPop(output) == ULIB_SUCCESS)
+* NOTES:
+*   1. The vector uses buffers of fixed size specified: BufferSize * ElementSize
+*       INIT_ULIB_VECTOR(vec, BufferSize, ElementSize)
+*   2. If the buffer fills, a new one is allocated of the same size.
+*   3. The size of this buffer should be determined by user.
+*   4. Pop function retires emptied buffers to a per vector cache, and frees
+*      them only when the cache holds more than maxFreeBuffers. Popping past
+*      the last element frees all the memory used by the vector.
+*   5. The buffer header and its data are one allocation.
+*   6. Every pushed element is followed by its start offset, so elements can
+*      have different lengths. When all elements have the same size use
+*       INIT_ULIB_VECTOR_FIXED(vec, BufferSize, ElementSize)
+*      which stores the elements densely without the offset.
+*   7. Elements can be read without popping them with UlibVectorAt() (fixed
+*      stride mode) and with the cursors: UlibVectorCursorInit()
+*   8. With UlibVectorEnableSpill() the buffers are mapped from a temp file,
+*      and the oldest ones are paged out when the vector grows over a memory
+*      budget. They are paged back in when UlibVectorPop() reaches them.
+*   9. Allocation statistics are kept by every vector, UlibVectorGetStats()
+*      copies them. Define ULIB_VECTOR_NO_STATS in all files that include
+*      this one to remove them.
+*   10. The buffers can be taken from an arena (ulib_arena.h), see
+*      INIT_ULIB_VECTOR_ARENA(). They are then given back with the arena,
+*      and emptied buffers are always kept for reuse.
+*   11. In case of an error, the error code is stored in ulibError global variable
+*   UlibGetLastErrorText(char* str) can be used to get the error text description
+***********************************************************************************/
+#ifndef _ulib_vector_h_
+#define _ulib_vector_h_
+
+#include "ulib_common.h"
+#include "ulib_arena.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef __cplusplus
+namespace ulib{
+#endif
+
+// Default number of emptied buffers a vector keeps for reuse.
+// Define it before including this file to change it, or use
+// UlibVectorSetMaxFreeBuffers() on a vector.
+#ifndef ULIB_VECTOR_MAX_FREE_BUFFERS
+#define ULIB_VECTOR_MAX_FREE_BUFFERS 2u
+#endif
+
+// Statistics bookkeeping, compiled out with ULIB_VECTOR_NO_STATS
+#ifndef ULIB_VECTOR_NO_STATS
+#define ULIB_VECTOR_STAT(statement) statement
+#else
+#define ULIB_VECTOR_STAT(statement)
+#endif
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+    typedef struct buffer_ {
+        ulib__uint8*       data;
+        struct buffer_*    previousBuffer;
+        ulib__SizeType     lastIndex;
+    }buffer;
+
+    // Spill mode state, see UlibVectorEnableSpill()
+    typedef struct ulib_vector_spill_ {
+#ifdef _WIN32
+        HANDLE           file;           // Temp file backing the buffers
+#else
+        int              file;
+#endif
+        ulib__SizeType   mapSize;        // Bytes mapped per buffer
+        ulib__SizeType   fileSize;
+        ulib__SizeType   memoryBudget;   // Max resident bytes
+        ulib__SizeType   spilledBuffers; // Buffers [0, spilledBuffers) are paged out
+        ulib__SizeType   residentBytes;
+        ulib__SizeType   spilledBytes;
+    }ulib_vector_spill;
+
+    typedef struct ulib_vector_ {
+        ulib__SizeType   bufferSize;     // Buffer size
+        ulib__SizeType   elemSize;       // Element size
+        buffer*          workBuffer;     // The current working buffer
+        ulib__SizeType   lastIndexSize;  // Last index size in bytes
+        ulib__bool       fixedStride;    // Elements of elemSize, no offsets
+        buffer*          freeBuffers;    // Emptied buffers kept for reuse
+        ulib__uint32     freeBuffersCount;
+        ulib__uint32     maxFreeBuffers; // Max buffers kept in freeBuffers
+        buffer**         bufferTable;    // Buffers in push order, oldest first
+        ulib__SizeType   bufferCount;    // Buffers in use
+        ulib__SizeType   bufferTableSize;
+        ulib_vector_spill* spill;        // ULIB_NULL if spill mode is off
+        ulib_arena*      arena;          // Buffers come from the arena if set
+#ifndef ULIB_VECTOR_NO_STATS
+        ulib__SizeType   ulibVectorAllocations;
+        ulib__SizeType   ulibVectorFree;
+        ulib__SizeType   peakBuffers;    // Max buffers allocated at once
+        ulib__SizeType   cacheHits;      // New buffer taken from freeBuffers
+        ulib__SizeType   cacheMisses;    // New buffer had to be allocated
+#endif
+    }ulib_vector;
+
+#ifndef ULIB_VECTOR_NO_STATS
+    // Snapshot of the vector statistics, see UlibVectorGetStats()
+    typedef struct ulib_vector_stats_ {
+        ulib__SizeType   allocations;       // Buffers allocated (or mapped)
+        ulib__SizeType   frees;             // Buffers freed (or unmapped)
+        ulib__SizeType   liveBuffers;       // Buffers allocated now, cached included
+        ulib__SizeType   peakBuffers;       // High-water mark of liveBuffers
+        ulib__SizeType   reservedBytes;     // Memory held by the live buffers
+        ulib__SizeType   peakReservedBytes; // High-water mark of reservedBytes
+        ulib__SizeType   usedBytes;         // Bytes of the elements stored
+        ulib__SizeType   cachedBuffers;     // Emptied buffers kept for reuse
+        ulib__SizeType   cacheHits;
+        ulib__SizeType   cacheMisses;
+        ulib__SizeType   residentBytes;     // Spill mode, see UlibVectorSpillBytes()
+        ulib__SizeType   spilledBytes;
+    }ulib_vector_stats;
+#endif
+
+    // Non destructive iteration, see UlibVectorCursorInit()
+    typedef struct ulib_vector_cursor_ {
+        ulib_vector*     vector;
+        ulib__SizeType   bufferIndex;    // Index in vector->bufferTable
+        ulib__SizeType   offset;         // Byte offset in the buffer
+        ulib__bool       reverse;        // ULIB_TRUE - from the top down
+    }ulib_vector_cursor;
+
+    buffer* Allocate(IN ulib_vector*);
+
+#define INIT_ULIB_VECTOR(vec, BufferSize, ElementSize)\
+    INIT_ULIB_VECTOR_MODE(vec, BufferSize, ElementSize, ULIB_FALSE, ULIB_NULL)
+
+// Fixed stride mode: elements are elemSize bytes, stored back to back
+// without the start offset. The buffer size is rounded down to a multiple
+// of ElementSize.
+#define INIT_ULIB_VECTOR_FIXED(vec, BufferSize, ElementSize)\
+    INIT_ULIB_VECTOR_MODE(vec,\
+                          ((BufferSize) / (ElementSize)) * (ElementSize),\
+                          ElementSize,\
+                          ULIB_TRUE,\
+                          ULIB_NULL)
+
+// The buffers are allocated from Arena (ulib_arena*). The arena must not be
+// reset or rewound past them while the vector is in use.
+#define INIT_ULIB_VECTOR_ARENA(vec, BufferSize, ElementSize, Arena)\
+    INIT_ULIB_VECTOR_MODE(vec, BufferSize, ElementSize, ULIB_FALSE, Arena)
+
+#define INIT_ULIB_VECTOR_FIXED_ARENA(vec, BufferSize, ElementSize, Arena)\
+    INIT_ULIB_VECTOR_MODE(vec,\
+                          ((BufferSize) / (ElementSize)) * (ElementSize),\
+                          ElementSize,\
+                          ULIB_TRUE,\
+                          Arena)
+
+#define INIT_ULIB_VECTOR_MODE(vec, BufferSize, ElementSize, FixedStride, Arena)\
+    vec.bufferSize = BufferSize;\
+    vec.arena = Arena;\
+    vec.elemSize = ElementSize;\
+    vec.fixedStride = FixedStride;\
+    vec.freeBuffers = ULIB_NULL;\
+    vec.freeBuffersCount = 0u;\
+    vec.maxFreeBuffers = ULIB_VECTOR_MAX_FREE_BUFFERS;\
+    ULIB_VECTOR_STAT(vec.ulibVectorAllocations = 0u);\
+    ULIB_VECTOR_STAT(vec.ulibVectorFree = 0u);\
+    ULIB_VECTOR_STAT(vec.peakBuffers = 0u);\
+    ULIB_VECTOR_STAT(vec.cacheHits = 0u);\
+    ULIB_VECTOR_STAT(vec.cacheMisses = 0u);\
+    vec.workBuffer = Allocate(&vec);\
+    vec.bufferTable = ULIB_NULL;\
+    vec.bufferCount = vec.workBuffer ? 1u : 0u;\
+    vec.bufferTableSize = 0u;\
+    vec.spill = ULIB_NULL;\
+    vec.lastIndexSize = vec.fixedStride ? 0u : sizeof(vec.workBuffer->lastIndex);
+
+
+/* Public functions */
+/******************************************************************************
+* Function:
+*           ulib__bool UlibVectorPush(IN ulib_vector* v,
+*                                     IN const void* data,
+*                                     IN const ulib__SizeType length);
+* length is the number of elements in data. In fixed stride mode they are
+* pushed as length separate elements, and may span buffers. Otherwise they
+* are one element that is popped at once.
+* Parameters:
+*      Input:  ulib_vector* v
+*              const void* data
+*              const ulib__SizeType length
+*      Return: ULIB_SUCCESS if successful
+*              ULIB_ERROR if an error occurred
+******************************************************************************/
+    ulib__bool UlibVectorPush(IN ulib_vector* v,
+                              IN const void* data,
+                              IN const ulib__SizeType length);
+
+/******************************************************************************
+* Function:
+*           ulib__bool UlibVectorPop(IN ulib_vector* v, OUT void* output);
+* Parameters:
+*      Output:  void* output
+*      Return: ULIB_SUCCESS if successful
+*              ULIB_ERROR if no more strings are stored in the vector
+******************************************************************************/
+    ulib__bool UlibVectorPop(IN ulib_vector* v, OUT void* output);
+
+/******************************************************************************
+* Function:
+*           ulib__bool UlibVectorPushN(IN ulib_vector* v,
+*                                      IN const void* data,
+*                                      IN const ulib__SizeType count);
+* Pushes count elements of elemSize bytes, each one is popped separately.
+* In fixed stride mode this is one copy per buffer.
+* Parameters:
+*      Input:  ulib_vector* v
+*              const void* data
+*              const ulib__SizeType count
+*      Return: ULIB_SUCCESS if successful
+*              ULIB_ERROR if an error occurred
+******************************************************************************/
+    ulib__bool UlibVectorPushN(IN ulib_vector* v,
+                               IN const void* data,
+                               IN const ulib__SizeType count);
+
+/******************************************************************************
+* Function:
+*           ulib__bool UlibVectorPopN(IN ulib_vector* v,
+*                                     OUT void* output,
+*                                     IN const ulib__SizeType count,
+*                                     OUT ulib__SizeType* popped);
+* Pops up to count elements of elemSize bytes. They are stored in output in
+* the order they were pushed, so PushN followed by PopN gives the same data.
+* In fixed stride mode this is one copy per buffer. Otherwise it stops at the
+* first element that is not elemSize bytes long (ULIB_VECTOR_ELEMENT_SIZE).
+* Like UlibVectorPop, calling it on an empty vector frees the vector.
+* Parameters:
+*      Input:  ulib_vector* v
+*              const ulib__SizeType count
+*      Output: void* output - room for count elements, can be NULL
+*              ulib__SizeType* popped - number of popped elements, can be NULL
+*      Return: ULIB_SUCCESS if at least one element was popped
+*              ULIB_ERROR otherwise
+******************************************************************************/
+    ulib__bool UlibVectorPopN(IN ulib_vector* v,
+                              OUT void* output,
+                              IN const ulib__SizeType count,
+                              OUT ulib__SizeType* popped);
+
+/******************************************************************************
+* Function:
+*           void* UlibVectorEmplace(IN ulib_vector* v,
+*                                   IN const ulib__SizeType length);
+* Reserves an element of length * elemSize bytes on top of the vector and
+* returns a pointer to it, the caller writes the element in place.
+* In fixed stride mode length must be 1.
+* Parameters:
+*      Input:  ulib_vector* v
+*              const ulib__SizeType length
+*      Return: pointer to the reserved element if successful
+*              ULIB_NULL if an error occurred
+******************************************************************************/
+    void* UlibVectorEmplace(IN ulib_vector* v, IN const ulib__SizeType length);
+
+/******************************************************************************
+* Function:
+*           void* UlibVectorPeek(IN ulib_vector* v,
+*                                OUT ulib__SizeType* length);
+* Returns a pointer to the top element without removing it. The pointer is
+* valid until the next push or pop. UlibVectorPop(v, ULIB_NULL) drops it.
+* Parameters:
+*      Input:  ulib_vector* v
+*      Output: ulib__SizeType* length - element length in bytes, can be NULL
+*      Return: pointer to the top element
+*              ULIB_NULL if the vector is empty
+******************************************************************************/
+    void* UlibVectorPeek(IN ulib_vector* v, OUT ulib__SizeType* length);
+
+/******************************************************************************
+* Function:
+*           ulib__SizeType UlibVectorCount(IN ulib_vector* v);
+* Returns the number of elements in the vector. O(1) in fixed stride mode,
+* otherwise all the elements are walked.
+* Parameters:
+*      Input:  ulib_vector* v
+*      Return: number of elements
+******************************************************************************/
+    ulib__SizeType UlibVectorCount(IN ulib_vector* v);
+
+/******************************************************************************
+* Function:
+*           void* UlibVectorAt(IN ulib_vector* v,
+*                              IN const ulib__SizeType index);
+* Returns a pointer to the element at index in O(1), 0 is the first pushed
+* element. Fixed stride mode only.
+* Parameters:
+*      Input:  ulib_vector* v
+*              const ulib__SizeType index
+*      Return: pointer to the element
+*              ULIB_NULL if index is out of range or the vector is not in
+*              fixed stride mode (ULIB_VECTOR_WRONG_MODE)
+******************************************************************************/
+    void* UlibVectorAt(IN ulib_vector* v, IN const ulib__SizeType index);
+
+/******************************************************************************
+* Function:
+*           ulib__bool UlibVectorCursorInit(OUT ulib_vector_cursor* cursor,
+*                                           IN ulib_vector* v,
+*                                           IN const ulib__bool reverse);
+* Prepares a cursor that reads the elements without removing them.
+* reverse == ULIB_FALSE goes in push order (FIFO) and needs fixed stride
+* mode, reverse == ULIB_TRUE goes from the top down (LIFO) in both modes.
+* Pushing or popping invalidates the cursor.
+* Parameters:
+*      Input:  ulib_vector* v
+*              const ulib__bool reverse
+*      Output: ulib_vector_cursor* cursor
+*      Return: ULIB_SUCCESS if successful
+*              ULIB_ERROR if the mode is not supported (ULIB_VECTOR_WRONG_MODE)
+******************************************************************************/
+    ulib__bool UlibVectorCursorInit(OUT ulib_vector_cursor* cursor,
+                                    IN ulib_vector* v,
+                                    IN const ulib__bool reverse);
+
+/******************************************************************************
+* Function:
+*           void* UlibVectorCursorNext(INOUT ulib_vector_cursor* cursor,
+*                                      OUT ulib__SizeType* length);
+* Returns the next element of the cursor and advances it. The next buffer is
+* prefetched when the cursor enters a buffer.
+* Iteration can be done like this:
+*   while ((element = UlibVectorCursorNext(&cursor, &length)) != ULIB_NULL)
+* Parameters:
+*      Input:  ulib_vector_cursor* cursor
+*      Output: ulib__SizeType* length - element length in bytes, can be NULL
+*      Return: pointer to the element
+*              ULIB_NULL when all elements were read
+******************************************************************************/
+    void* UlibVectorCursorNext(INOUT ulib_vector_cursor* cursor,
+                               OUT ulib__SizeType* length);
+
+/******************************************************************************
+* Function:
+*          void UlibVectorFree(IN ulib_vector* v);
+* Frees all memory used by the vector, used in case not all the vector was
+* traversed using UlibVectorPop()
+* Parameters:
+*      Input:  ulib_vector* v
+*      Return: none
+******************************************************************************/
+    void UlibVectorFree(IN ulib_vector* v);
+
+/******************************************************************************
+* Function:
+*          void UlibVectorSetMaxFreeBuffers(IN ulib_vector* v,
+*                                           IN const ulib__uint32 count);
+* Sets how many emptied buffers the vector keeps for reuse. Buffers above the
+* new limit are freed immediately. 0 disables the cache. In spill mode the
+* cache stays off, whatever the count.
+* cacheHits / cacheMisses from UlibVectorGetStats() can be used to size
+* the limit.
+* Parameters:
+*      Input:  ulib_vector* v
+*              const ulib__uint32 count
+*      Return: none
+******************************************************************************/
+    void UlibVectorSetMaxFreeBuffers(IN ulib_vector* v,
+                                     IN const ulib__uint32 count);
+
+/******************************************************************************
+* Function:
+*          ulib__bool UlibVectorEnableSpill(IN ulib_vector* v,
+*                                           IN const _TCHAR* directory,
+*                                           IN const ulib__SizeType memoryBudget);
+* Switches an empty vector to spill mode. Buffers are mapped from a temp file
+* created in directory, deleted when the vector is freed. When the buffers
+* use more than memoryBudget bytes, the oldest ones are paged out to the file.
+* The work buffer is never paged out. Buffers are not cached in spill mode.
+* Parameters:
+*      Input:  ulib_vector* v
+*              const _TCHAR* directory - ULIB_NULL for the system temp dir
+*              const ulib__SizeType memoryBudget
+*      Return: ULIB_SUCCESS if successful
+*              ULIB_ERROR if the vector is not empty (ULIB_VECTOR_WRONG_MODE)
+*              or the temp file could not be created (ULIB_FILE_NOT_FOUND)
+******************************************************************************/
+    ulib__bool UlibVectorEnableSpill(IN ulib_vector* v,
+                                     IN const _TCHAR* directory,
+                                     IN const ulib__SizeType memoryBudget);
+
+/******************************************************************************
+* Function:
+*          void UlibVectorSpillBytes(IN ulib_vector* v,
+*                                    OUT ulib__SizeType* resident,
+*                                    OUT ulib__SizeType* spilled);
+* Bytes of buffers kept in memory and paged out to the temp file.
+* Both are 0 if spill mode is off.
+* Parameters:
+*      Input:  ulib_vector* v
+*      Output: ulib__SizeType* resident
+*              ulib__SizeType* spilled
+*      Return: none
+******************************************************************************/
+    void UlibVectorSpillBytes(IN ulib_vector* v,
+                              OUT ulib__SizeType* resident,
+                              OUT ulib__SizeType* spilled);
+
+#ifndef ULIB_VECTOR_NO_STATS
+/******************************************************************************
+* Function:
+*          void UlibVectorGetStats(IN ulib_vector* v,
+*                                  OUT ulib_vector_stats* stats);
+* Copies the allocation statistics of the vector to stats. The counters are
+* kept for the lifetime of the vector, also after it was released.
+* usedBytes is computed from the buffers, in variable length mode this walks
+* the buffer list.
+* Parameters:
+*      Input:  ulib_vector* v
+*      Output: ulib_vector_stats* stats
+*      Return: none
+******************************************************************************/
+    void UlibVectorGetStats(IN ulib_vector* v,
+                            OUT ulib_vector_stats* stats);
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+/******************************************************************************
+* Internal functions
+******************************************************************************/
+// Size of the buffer header, rounded so the data following it is aligned
+#define ULIB_VECTOR_HEADER_SIZE ((sizeof(buffer) + 15u) & ~(ulib__SizeType)15u)
+#ifdef IMPLEMENTATION
+#ifndef ULIB_VECTOR_NO_STATS
+static void CountAllocation(ulib_vector* v){
+    ++(v->ulibVectorAllocations);
+    if (v->ulibVectorAllocations - v->ulibVectorFree > v->peakBuffers){
+        v->peakBuffers = v->ulibVectorAllocations - v->ulibVectorFree;
+    }
+}
+#endif
+
+buffer* Allocate(ulib_vector* v){
+    // Header and data in one block, data starts after the header
+    buffer* buff = (buffer*)(v->arena ?
+                   UlibArenaAlloc(v->arena, ULIB_VECTOR_HEADER_SIZE + v->bufferSize) :
+                   malloc(ULIB_VECTOR_HEADER_SIZE + v->bufferSize));
+    if (buff){
+        buff->data = (ulib__uint8*)buff + ULIB_VECTOR_HEADER_SIZE;
+        buff->previousBuffer = ULIB_NULL;
+        buff->lastIndex = 0;
+        ULIB_VECTOR_STAT(CountAllocation(v));
+        return (buff);
+    }
+    ulibError = ULIB_MALLOC_ERROR;
+    return (ULIB_NULL);
+}
+
+void Free(buffer** buf, ulib_vector* v){
+    if (v->arena){
+        // Given back with the arena
+        *buf = ULIB_NULL;
+    }
+    else{
+        ULIB_FREE(*buf);
+    }
+    ULIB_VECTOR_STAT(++(v->ulibVectorFree));
+}
+
+/* Spill mode - temp file and buffer mappings */
+#ifdef _WIN32
+static ulib__bool SpillOpen(ulib_vector_spill* s, const _TCHAR* directory){
+    _TCHAR tempDir[MAX_PATH + 1];
+    _TCHAR name[MAX_PATH + 1];
+    SYSTEM_INFO info;
+    if (directory == ULIB_NULL){
+        if (GetTempPath(MAX_PATH + 1, tempDir) == 0){
+            return (ULIB_ERROR);
+        }
+        directory = tempDir;
+    }
+    if (GetTempFileName(directory, _T("ulv"), 0, name) == 0){
+        return (ULIB_ERROR);
+    }
+    s->file = CreateFile(name, GENERIC_READ | GENERIC_WRITE, 0, ULIB_NULL,
+                         CREATE_ALWAYS,
+                         FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                         ULIB_NULL);
+    if (s->file == INVALID_HANDLE_VALUE){
+        DeleteFile(name);
+        return (ULIB_ERROR);
+    }
+    // Views must start at a multiple of the allocation granularity
+    GetSystemInfo(&info);
+    s->mapSize = (s->mapSize + info.dwAllocationGranularity - 1u) /
+                 info.dwAllocationGranularity * info.dwAllocationGranularity;
+    return (ULIB_SUCCESS);
+}
+
+static void* SpillMap(ulib_vector_spill* s, const ulib__SizeType slot){
+    ulib__uint64 offset = (ulib__uint64)slot * s->mapSize;
+    ulib__uint64 end = offset + s->mapSize;
+    void* view = ULIB_NULL;
+    // The mapping grows the file, the view keeps the mapping alive
+    HANDLE mapping = CreateFileMapping(s->file, ULIB_NULL, PAGE_READWRITE,
+                                       (DWORD)(end >> 32), (DWORD)end,
+                                       ULIB_NULL);
+    if (mapping){
+        view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS,
+                             (DWORD)(offset >> 32), (DWORD)offset, s->mapSize);
+        CloseHandle(mapping);
+    }
+    return (view);
+}
+
+static void SpillUnmap(ulib_vector_spill* s, void* view){
+    ULIB_UNUSED(s);
+    UnmapViewOfFile(view);
+}
+
+static void SpillPageOut(ulib_vector_spill* s, void* view){
+    // Unlocking pages that are not locked removes them from the working set
+    VirtualUnlock(view, s->mapSize);
+}
+
+static void SpillPageIn(ulib_vector_spill* s, void* view){
+    ULIB_UNUSED(s);
+    ULIB_UNUSED(view);
+}
+
+static void SpillClose(ulib_vector_spill* s){
+    CloseHandle(s->file);
+}
+#else
+static ulib__bool SpillOpen(ulib_vector_spill* s, const _TCHAR* directory){
+    char name[4096];
+    ulib__SizeType page = (ulib__SizeType)sysconf(_SC_PAGESIZE);
+    if (directory == ULIB_NULL){
+        directory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    }
+    s->file = -1;
+#ifdef O_TMPFILE
+    s->file = open(directory, O_TMPFILE | O_RDWR | O_EXCL, 0600);
+#endif
+    if (s->file == -1){ // No O_TMPFILE support, create and unlink
+        if (snprintf(name, sizeof(name), "%s/ulib_vector_XXXXXX", directory) >=
+            (int)sizeof(name)){
+            return (ULIB_ERROR);
+        }
+        s->file = mkstemp(name);
+        if (s->file == -1){
+            return (ULIB_ERROR);
+        }
+        unlink(name);
+    }
+    s->mapSize = (s->mapSize + page - 1u) / page * page;
+    return (ULIB_SUCCESS);
+}
+
+static void* SpillMap(ulib_vector_spill* s, const ulib__SizeType slot){
+    void* view;
+    ulib__SizeType end = (slot + 1u) * s->mapSize;
+    if (end > s->fileSize){
+        if (ftruncate(s->file, (off_t)end) != 0){
+            return (ULIB_NULL);
+        }
+        s->fileSize = end;
+    }
+    view = mmap(ULIB_NULL, s->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                s->file, (off_t)(slot * s->mapSize));
+    return (view == MAP_FAILED ? ULIB_NULL : view);
+}
+
+static void SpillUnmap(ulib_vector_spill* s, void* view){
+    munmap(view, s->mapSize);
+}
+
+static void SpillPageOut(ulib_vector_spill* s, void* view){
+    // Shared file pages keep their data in the file, only the RSS drops
+    madvise(view, s->mapSize, MADV_DONTNEED);
+}
+
+static void SpillPageIn(ulib_vector_spill* s, void* view){
+    madvise(view, s->mapSize, MADV_WILLNEED);
+}
+
+static void SpillClose(ulib_vector_spill* s){
+    close(s->file);
+}
+#endif // #ifdef _WIN32
+
+// Maps the buffer for bufferTable slot from the spill file
+static buffer* MapBuffer(ulib_vector* v, const ulib__SizeType slot){
+    buffer* buff = (buffer*)SpillMap(v->spill, slot);
+    if (buff == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_NULL);
+    }
+    buff->data = (ulib__uint8*)buff + ULIB_VECTOR_HEADER_SIZE;
+    buff->previousBuffer = ULIB_NULL;
+    buff->lastIndex = 0;
+    v->spill->residentBytes += v->spill->mapSize;
+    ULIB_VECTOR_STAT(CountAllocation(v));
+    return (buff);
+}
+
+// Frees or unmaps a buffer
+static void ReleaseBuffer(ulib_vector* v, buffer** buff){
+    if (v->spill){
+        SpillUnmap(v->spill, *buff);
+        v->spill->residentBytes -= v->spill->mapSize;
+        *buff = ULIB_NULL;
+        ULIB_VECTOR_STAT(++(v->ulibVectorFree));
+        return;
+    }
+    Free(buff, v);
+}
+
+// Pages out the oldest buffers while the vector is over its memory budget
+static void SpillColdBuffers(ulib_vector* v){
+    ulib_vector_spill* s = v->spill;
+    while (s->residentBytes > s->memoryBudget &&
+           s->spilledBuffers + 1u < v->bufferCount){
+        SpillPageOut(s, v->bufferTable[s->spilledBuffers]);
+        ++(s->spilledBuffers);
+        s->residentBytes -= s->mapSize;
+        s->spilledBytes += s->mapSize;
+    }
+}
+
+// Takes a buffer from the cache, or allocates a new one
+static buffer* AcquireBuffer(ulib_vector* v){
+    buffer* buff = v->freeBuffers;
+    if (v->spill){
+        return (MapBuffer(v, v->bufferCount));
+    }
+    if (buff){
+        v->freeBuffers = buff->previousBuffer;
+        --(v->freeBuffersCount);
+        ULIB_VECTOR_STAT(++(v->cacheHits));
+        buff->previousBuffer = ULIB_NULL;
+        buff->lastIndex = 0;
+        return (buff);
+    }
+    ULIB_VECTOR_STAT(++(v->cacheMisses));
+    return (Allocate(v));
+}
+
+// Keeps an emptied buffer in the cache, or frees it if the cache is full
+static void RetireBuffer(ulib_vector* v, buffer* buff){
+    // Arena memory can't be freed, so it is always kept for reuse.
+    // Mapped spill buffers are never cached, they are unmapped.
+    if (!v->spill && (v->freeBuffersCount < v->maxFreeBuffers || v->arena)){
+        buff->previousBuffer = v->freeBuffers;
+        v->freeBuffers = buff;
+        ++(v->freeBuffersCount);
+        return;
+    }
+    ReleaseBuffer(v, &buff);
+}
+
+// Frees cached buffers until at most count are left
+static void TrimFreeBuffers(ulib_vector* v, const ulib__uint32 count){
+    while (v->freeBuffersCount > count){
+        buffer* buff = v->freeBuffers;
+        v->freeBuffers = buff->previousBuffer;
+        --(v->freeBuffersCount);
+        Free(&buff, v);
+    }
+}
+
+// Makes a new work buffer on top of the current one
+static buffer* NextBuffer(ulib_vector* v){
+    buffer* buff;
+    if (v->bufferCount >= v->bufferTableSize){
+        ulib__SizeType size = v->bufferTableSize ? v->bufferTableSize << 1u : 16u;
+        buffer** table = (buffer**)realloc(v->bufferTable, size * sizeof(buffer*));
+        if (table == ULIB_NULL){
+            ulibError = ULIB_MALLOC_ERROR;
+            return (ULIB_NULL);
+        }
+        if (v->bufferTable == ULIB_NULL){
+            table[0] = v->workBuffer; // Table is created with the second buffer
+        }
+        v->bufferTable = table;
+        v->bufferTableSize = size;
+    }
+    buff = AcquireBuffer(v);
+    if (buff){
+        buff->previousBuffer = v->workBuffer;
+        v->workBuffer = buff;
+        v->bufferTable[v->bufferCount++] = buff;
+        if (v->spill){
+            SpillColdBuffers(v);
+        }
+    }
+    return (buff);
+}
+
+// Retires the emptied work buffer, the previous one becomes the work buffer
+static void PreviousBuffer(ulib_vector* v){
+    buffer* current = v->workBuffer;
+    v->workBuffer = current->previousBuffer;
+    --(v->bufferCount);
+    RetireBuffer(v, current);
+    if (v->spill && v->bufferCount - 1u < v->spill->spilledBuffers){
+        // Pop reached a paged out buffer
+        v->spill->spilledBuffers = v->bufferCount - 1u;
+        v->spill->residentBytes += v->spill->mapSize;
+        v->spill->spilledBytes -= v->spill->mapSize;
+        SpillPageIn(v->spill, v->workBuffer);
+    }
+}
+
+// Buffer i of the vector, 0 is the oldest one
+static buffer* BufferAt(const ulib_vector* v, const ulib__SizeType i){
+    return (v->bufferTable ? v->bufferTable[i] : v->workBuffer);
+}
+
+void UlibVectorSetMaxFreeBuffers(ulib_vector* v, const ulib__uint32 count){
+    if (v){
+        // The cache stays off in spill mode
+        v->maxFreeBuffers = v->spill ? 0u : count;
+        TrimFreeBuffers(v, v->maxFreeBuffers);
+    }
+}
+
+ulib__bool UlibVectorEnableSpill(ulib_vector* v,
+                                 const _TCHAR* directory,
+                                 const ulib__SizeType memoryBudget){
+    ulib_vector_spill* s;
+    buffer* first;
+    if (!v || !v->workBuffer){
+        ulibError = ULIB_INVALID_VECTOR;
+        return (ULIB_ERROR);
+    }
+    if (v->spill || v->bufferCount != 1u || v->workBuffer->lastIndex != 0){
+        ulibError = ULIB_VECTOR_WRONG_MODE;
+        return (ULIB_ERROR);
+    }
+    s = (ulib_vector_spill*)calloc(1u, sizeof(ulib_vector_spill));
+    if (s == ULIB_NULL){
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_ERROR);
+    }
+    s->mapSize = ULIB_VECTOR_HEADER_SIZE + v->bufferSize;
+    s->memoryBudget = memoryBudget;
+    if (SpillOpen(s, directory) != ULIB_SUCCESS){
+        free(s);
+        ulibError = ULIB_FILE_NOT_FOUND;
+        return (ULIB_ERROR);
+    }
+    v->spill = s;
+    first = MapBuffer(v, 0u);
+    if (first == ULIB_NULL){
+        SpillClose(s);
+        ULIB_FREE(v->spill);
+        return (ULIB_ERROR);
+    }
+    // Mapped buffers replace the allocated ones
+    Free(&v->workBuffer, v);
+    v->workBuffer = first;
+    if (v->bufferTable){
+        v->bufferTable[0] = first;
+    }
+    UlibVectorSetMaxFreeBuffers(v, 0u);
+    // Only the mapped buffer counts for the high-water mark
+    ULIB_VECTOR_STAT(v->peakBuffers = 1u);
+    return (ULIB_SUCCESS);
+}
+
+void UlibVectorSpillBytes(ulib_vector* v,
+                          ulib__SizeType* resident,
+                          ulib__SizeType* spilled){
+    ulib__bool on = (v && v->spill) ? ULIB_TRUE : ULIB_FALSE;
+    if (resident){
+        *resident = on ? v->spill->residentBytes : 0u;
+    }
+    if (spilled){
+        *spilled = on ? v->spill->spilledBytes : 0u;
+    }
+}
+
+#ifndef ULIB_VECTOR_NO_STATS
+void UlibVectorGetStats(ulib_vector* v, ulib_vector_stats* stats){
+    buffer* buff;
+    ulib__SizeType bufferBytes;
+    if (!v || !stats){
+        return;
+    }
+    bufferBytes = v->spill ? v->spill->mapSize :
+                             ULIB_VECTOR_HEADER_SIZE + v->bufferSize;
+    stats->allocations = v->ulibVectorAllocations;
+    stats->frees = v->ulibVectorFree;
+    stats->liveBuffers = v->ulibVectorAllocations - v->ulibVectorFree;
+    stats->peakBuffers = v->peakBuffers;
+    stats->reservedBytes = stats->liveBuffers * bufferBytes;
+    stats->peakReservedBytes = v->peakBuffers * bufferBytes;
+    stats->usedBytes = 0;
+    if (v->workBuffer && v->fixedStride){
+        // All buffers but the work buffer are full
+        stats->usedBytes = (v->bufferCount - 1u) * v->bufferSize +
+                           v->workBuffer->lastIndex;
+    }
+    else{
+        for (buff = v->workBuffer; buff; buff = buff->previousBuffer){
+            stats->usedBytes += buff->lastIndex;
+        }
+    }
+    stats->cachedBuffers = v->freeBuffersCount;
+    stats->cacheHits = v->cacheHits;
+    stats->cacheMisses = v->cacheMisses;
+    UlibVectorSpillBytes(v, &stats->residentBytes, &stats->spilledBytes);
+}
+#endif
+
+void UlibVectorFree(ulib_vector* v){
+    if (v){
+        while (UlibVectorPop(v, ULIB_NULL) == ULIB_SUCCESS);
+    }
+}
+
+ulib__bool UlibVectorPushElement(ulib_vector* v,
+                                 const void* data) {
+    return UlibVectorPush(v, data, v->elemSize);
+}
+
+// Fixed stride push, the elements are copied densely and may span buffers.
+// On a malloc error the elements already copied stay in the vector.
+static ulib__bool PushFixed(ulib_vector* v,
+                            const ulib__uint8* data,
+                            const ulib__SizeType length){
+    ulib__SizeType len = v->elemSize * length;
+    if (v->bufferSize == 0){
+        ulibError = ULIB_VECTOR_BUFFER_TOO_SMALL;
+        return (ULIB_ERROR);
+    }
+    if (!data){
+        ulibError = ULIB_VECTOR_NOT_INIT;
+        return (ULIB_ERROR);
+    }
+    while (len){
+        ulib__SizeType room = v->bufferSize - v->workBuffer->lastIndex;
+        if (room == 0){ // Current buffer is full, a new one is needed
+            if (NextBuffer(v) == ULIB_NULL){
+                return (ULIB_ERROR);
+            }
+            room = v->bufferSize;
+        }
+        if (room > len){
+            room = len;
+        }
+        memcpy(&v->workBuffer->data[v->workBuffer->lastIndex], data, room);
+        v->workBuffer->lastIndex += room;
+        data += room;
+        len -= room;
+    }
+    return (ULIB_SUCCESS);
+}
+
+// Variable length mode - reserves len bytes followed by their start offset
+// and returns a pointer to the reserved bytes
+static ulib__uint8* Reserve(ulib_vector* v, const ulib__SizeType len){
+    ulib__SizeType startOffset = v->workBuffer->lastIndex;
+    // Data and index is bigger than the chunk allocated of BUFFER_SIZE
+    if (len + v->lastIndexSize > v->bufferSize){
+        ulibError = ULIB_VECTOR_BUFFER_TOO_SMALL;
+        return (ULIB_NULL);
+    }
+    else if (startOffset + len + v->lastIndexSize > v->bufferSize){// Does not fit in current buffer, a new one is needed
+        if (NextBuffer(v) == ULIB_NULL){
+            return (ULIB_NULL);
+        }
+        startOffset = 0;
+    } // else if (startOffset + len + v->lastIndexSize > BUFFER_SIZE)
+    v->workBuffer->lastIndex += len;
+    memcpy(&v->workBuffer->data[v->workBuffer->lastIndex],
+           &startOffset,
+           v->lastIndexSize);
+    v->workBuffer->lastIndex += v->lastIndexSize;
+    return (&v->workBuffer->data[startOffset]);
+}
+
+ulib__bool UlibVectorPush(ulib_vector* v,
+                          const void* data,
+                          const ulib__SizeType length){
+    if (v){
+        if (v->workBuffer && v->fixedStride){
+            return (PushFixed(v, (const ulib__uint8*)data, length));
+        }
+        if (v->workBuffer && data){
+            ulib__uint8* dst = Reserve(v, v->elemSize * length);
+            if (dst == ULIB_NULL){
+                return (ULIB_ERROR);
+            }
+            memcpy(dst, data, v->elemSize * length);
+            return (ULIB_SUCCESS);
+        }// if (v->workBuffer && data)
+        ulibError = ULIB_VECTOR_NOT_INIT;
+    }// if (v)
+    return (ULIB_ERROR);
+}
+
+ulib__bool UlibVectorPushN(ulib_vector* v,
+                           const void* data,
+                           const ulib__SizeType count){
+    const ulib__uint8* src = (const ulib__uint8*)data;
+    ulib__SizeType i = 0;
+    if (v){
+        if (v->workBuffer && v->fixedStride){
+            return (PushFixed(v, src, count));
+        }
+        if (v->workBuffer && data){
+            for (; i < count; ++i, src += v->elemSize){
+                ulib__uint8* dst = Reserve(v, v->elemSize);
+                if (dst == ULIB_NULL){
+                    return (ULIB_ERROR);
+                }
+                memcpy(dst, src, v->elemSize);
+            }
+            return (ULIB_SUCCESS);
+        }// if (v->workBuffer && data)
+        ulibError = ULIB_VECTOR_NOT_INIT;
+    }// if (v)
+    return (ULIB_ERROR);
+}
+
+void* UlibVectorEmplace(ulib_vector* v, const ulib__SizeType length){
+    if (v){
+        if (!v->workBuffer){
+            ulibError = ULIB_VECTOR_NOT_INIT;
+            return (ULIB_NULL);
+        }
+        if (!v->fixedStride){
+            return (Reserve(v, v->elemSize * length));
+        }
+        if (length != 1u){
+            ulibError = ULIB_VECTOR_ELEMENT_SIZE;
+            return (ULIB_NULL);
+        }
+        if (v->bufferSize == 0){
+            ulibError = ULIB_VECTOR_BUFFER_TOO_SMALL;
+            return (ULIB_NULL);
+        }
+        if (v->workBuffer->lastIndex == v->bufferSize &&
+            NextBuffer(v) == ULIB_NULL){
+            return (ULIB_NULL);
+        }
+        v->workBuffer->lastIndex += v->elemSize;
+        return (&v->workBuffer->data[v->workBuffer->lastIndex - v->elemSize]);
+    }// if (v)
+    return (ULIB_NULL);
+}
+
+void* UlibVectorPeek(ulib_vector* v, ulib__SizeType* length){
+    buffer* buff;
+    ulib__SizeType startOffset;
+    if (!v || !v->workBuffer){
+        ulibError = ULIB_INVALID_VECTOR;
+        return (ULIB_NULL);
+    }
+    buff = v->workBuffer;
+    // An emptied work buffer is retired only by the next pop
+    if (buff->lastIndex == 0){
+        buff = buff->previousBuffer;
+    }
+    if (!buff || buff->lastIndex == 0){
+        return (ULIB_NULL);
+    }
+    if (v->fixedStride){
+        startOffset = buff->lastIndex - v->elemSize;
+    }
+    else{
+        memcpy(&startOffset,
+               &buff->data[buff->lastIndex - v->lastIndexSize],
+               v->lastIndexSize);
+    }
+    if (length){
+        *length = buff->lastIndex - v->lastIndexSize - startOffset;
+    }
+    return (&buff->data[startOffset]);
+}
+
+ulib__bool UlibVectorPopN(ulib_vector* v,
+                          void* output,
+                          const ulib__SizeType count,
+                          ulib__SizeType* popped){
+    ulib__uint8* out = (ulib__uint8*)output;
+    ulib__SizeType remaining = count;
+    ulib__SizeType n;
+    ulib__bool sizeMismatch = ULIB_FALSE;
+    if (popped){
+        *popped = 0;
+    }
+    if (!v || !v->workBuffer){
+        ulibError = ULIB_INVALID_VECTOR;
+        return (ULIB_ERROR);
+    }
+    // Output is filled from the end, so the elements keep the push order
+    while (remaining){
+        buffer* buff = v->workBuffer;
+        if (buff->lastIndex == 0){
+            if (buff->previousBuffer == ULIB_NULL){
+                break;
+            }
+            PreviousBuffer(v);
+            continue;
+        }
+        if (v->fixedStride){
+            n = buff->lastIndex / v->elemSize;
+            if (n > remaining){
+                n = remaining;
+            }
+            remaining -= n;
+            buff->lastIndex -= n * v->elemSize;
+            if (out){
+                memcpy(&out[remaining * v->elemSize],
+                       &buff->data[buff->lastIndex],
+                       n * v->elemSize);
+            }
+        }
+        else{
+            ulib__SizeType startOffset;
+            memcpy(&startOffset,
+                   &buff->data[buff->lastIndex - v->lastIndexSize],
+                   v->lastIndexSize);
+            if (buff->lastIndex - v->lastIndexSize - startOffset != v->elemSize){
+                ulibError = ULIB_VECTOR_ELEMENT_SIZE;
+                sizeMismatch = ULIB_TRUE;
+                break;
+            }
+            --remaining;
+            if (out){
+                memcpy(&out[remaining * v->elemSize],
+                       &buff->data[startOffset],
+                       v->elemSize);
+            }
+            buff->lastIndex = startOffset;
+        }
+    }// while (remaining)
+    n = count - remaining;
+    if (n == 0){
+        if (count && !sizeMismatch){
+            // Nothing left, release the vector like UlibVectorPop does
+            return (UlibVectorPop(v, ULIB_NULL));
+        }
+        return (ULIB_ERROR);
+    }
+    if (remaining && out){
+        memmove(out, &out[remaining * v->elemSize], n * v->elemSize);
+    }
+    if (popped){
+        *popped = n;
+    }
+    return (ULIB_SUCCESS);
+}
+
+ulib__bool UlibVectorPop(ulib_vector* v, void* output){
+    if (v){// Data valid in current work buffer
+        ulib__SizeType start_offset;
+        if (!v->workBuffer){
+            ulibError = ULIB_INVALID_VECTOR;
+            return (ULIB_ERROR);
+        }
+        // Check if we still have data in work buffer
+        if (v->workBuffer->lastIndex == 0 && v->workBuffer->previousBuffer != ULIB_NULL){
+            PreviousBuffer(v);
+        }
+        if (v->workBuffer->lastIndex == 0){
+            // Got to the beginning of the list, the vector is released
+            ReleaseBuffer(v, &v->workBuffer);
+            TrimFreeBuffers(v, 0u);
+            if (v->spill){
+                SpillClose(v->spill);
+                ULIB_FREE(v->spill);
+            }
+            ULIB_FREE(v->bufferTable);
+            v->bufferCount = 0;
+            v->bufferTableSize = 0;
+            return (ULIB_ERROR);
+        }
+        if (v->fixedStride){
+            v->workBuffer->lastIndex -= v->elemSize;
+            if (output){
+                memcpy(output,
+                       &v->workBuffer->data[v->workBuffer->lastIndex],
+                       v->elemSize);
+            }
+            return (ULIB_SUCCESS);
+        }
+        // Get the index in the buffer
+        memcpy(&start_offset,
+               &v->workBuffer->data[v->workBuffer->lastIndex - v->lastIndexSize],
+               v->lastIndexSize);
+        // Get the string
+        if (output){
+            memcpy(output,
+                   &v->workBuffer->data[start_offset],
+                   v->workBuffer->lastIndex - v->lastIndexSize - start_offset);
+        }
+        v->workBuffer->lastIndex = start_offset;
+        return (ULIB_SUCCESS);
+    } // if (v)
+    return (ULIB_ERROR);
+}
+
+ulib__SizeType UlibVectorCount(ulib_vector* v){
+    ulib_vector_cursor cursor;
+    ulib__SizeType count = 0;
+    if (!v || !v->workBuffer){
+        return (0);
+    }
+    if (v->fixedStride){
+        // All buffers but the work buffer are full
+        return ((v->bufferCount - 1u) * (v->bufferSize / v->elemSize) +
+                v->workBuffer->lastIndex / v->elemSize);
+    }
+    UlibVectorCursorInit(&cursor, v, ULIB_TRUE);
+    while (UlibVectorCursorNext(&cursor, ULIB_NULL)){
+        ++count;
+    }
+    return (count);
+}
+
+void* UlibVectorAt(ulib_vector* v, const ulib__SizeType index){
+    ulib__SizeType perBuffer;
+    ulib__SizeType bufferIndex;
+    buffer* buff;
+    if (!v || !v->workBuffer){
+        ulibError = ULIB_INVALID_VECTOR;
+        return (ULIB_NULL);
+    }
+    if (!v->fixedStride){
+        ulibError = ULIB_VECTOR_WRONG_MODE;
+        return (ULIB_NULL);
+    }
+    perBuffer = v->bufferSize / v->elemSize;
+    bufferIndex = index / perBuffer;
+    if (bufferIndex >= v->bufferCount){
+        return (ULIB_NULL);
+    }
+    buff = BufferAt(v, bufferIndex);
+    if ((index - bufferIndex * perBuffer) * v->elemSize >= buff->lastIndex){
+        return (ULIB_NULL);
+    }
+    return (&buff->data[(index - bufferIndex * perBuffer) * v->elemSize]);
+}
+
+// Prefetches the header and the data of buffer i, if there is one
+static void PrefetchBuffer(const ulib_vector* v, const ulib__SizeType i){
+    if (i < v->bufferCount){
+        buffer* buff = BufferAt(v, i);
+        ULIB_PREFETCH(buff);
+        ULIB_PREFETCH((ulib__uint8*)buff + ULIB_VECTOR_HEADER_SIZE + v->bufferSize - 1u);
+    }
+}
+
+ulib__bool UlibVectorCursorInit(ulib_vector_cursor* cursor,
+                                ulib_vector* v,
+                                const ulib__bool reverse){
+    if (!cursor || !v || !v->workBuffer){
+        ulibError = ULIB_INVALID_VECTOR;
+        return (ULIB_ERROR);
+    }
+    if (!reverse && !v->fixedStride){
+        // Elements can be found only from their end, by the start offset
+        ulibError = ULIB_VECTOR_WRONG_MODE;
+        return (ULIB_ERROR);
+    }
+    cursor->vector = v;
+    cursor->reverse = reverse;
+    if (reverse){
+        cursor->bufferIndex = v->bufferCount - 1u;
+        cursor->offset = v->workBuffer->lastIndex;
+        PrefetchBuffer(v, cursor->bufferIndex - 1u);
+    }
+    else{
+        cursor->bufferIndex = 0;
+        cursor->offset = 0;
+        PrefetchBuffer(v, 1u);
+    }
+    return (ULIB_SUCCESS);
+}
+
+void* UlibVectorCursorNext(ulib_vector_cursor* cursor, ulib__SizeType* length){
+    ulib_vector* v = cursor->vector;
+    buffer* buff;
+    ulib__SizeType startOffset;
+    if (!cursor->reverse){
+        while (cursor->bufferIndex < v->bufferCount){
+            buff = BufferAt(v, cursor->bufferIndex);
+            if (cursor->offset < buff->lastIndex){
+                cursor->offset += v->elemSize;
+                if (length){
+                    *length = v->elemSize;
+                }
+                return (&buff->data[cursor->offset - v->elemSize]);
+            }
+            ++(cursor->bufferIndex);
+            cursor->offset = 0;
+            PrefetchBuffer(v, cursor->bufferIndex + 1u);
+        }
+        return (ULIB_NULL);
+    }
+    for (;;){
+        buff = BufferAt(v, cursor->bufferIndex);
+        if (cursor->offset != 0){
+            if (v->fixedStride){
+                startOffset = cursor->offset - v->elemSize;
+            }
+            else{
+                memcpy(&startOffset,
+                       &buff->data[cursor->offset - v->lastIndexSize],
+                       v->lastIndexSize);
+            }
+            if (length){
+                *length = cursor->offset - v->lastIndexSize - startOffset;
+            }
+            cursor->offset = startOffset;
+            return (&buff->data[startOffset]);
+        }
+        if (cursor->bufferIndex == 0){
+            return (ULIB_NULL);
+        }
+        --(cursor->bufferIndex);
+        cursor->offset = BufferAt(v, cursor->bufferIndex)->lastIndex;
+        PrefetchBuffer(v, cursor->bufferIndex - 1u);
+    }
+}
+
+#endif // IMPLEMENTATION
+#ifdef __cplusplus
+} // namespace ulib
+#endif
+#endif // _ulib_vector_h_
@@ -0,0 +1,278 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  C++ typed facade over ulib_vector (C++11)
+*  ulib::Vector<T> is a fixed stride ulib_vector of sizeof(T) elements.
+*  Elements are constructed in place in the vector buffers and destroyed when
+*  popped, so move-only and non trivial types are supported.
+*  Pushing and popping inside a buffer is done inline, the C functions are
+*  called only when a buffer boundary is crossed.
+*  Example:
+*   ulib::Vector<Data> vec;
+*   vec.emplace(1, 2.0f);
+*   Data d;
+*   while (vec.pop(d) == ULIB_SUCCESS)
+* NOTES:
+*   1. Iteration with begin() / end() goes from the top of the vector down,
+*      in the order pop() would return the elements.
+*   2. Pointers and iterators are valid until the next push or pop.
+*   3. In case of an error, the error code is stored in ulibError.
+***********************************************************************************/
+#ifndef _ulib_vector_hpp_
+#define _ulib_vector_hpp_
+
+#ifndef __cplusplus
+#error ulib_vector.hpp requires C++
+#endif
+
+#include "ulib_vector.h"
+#include <new>
+#include <utility>
+#include <iterator>
+
+namespace ulib{
+
+template <typename T>
+class Vector{
+public:
+    // Buffer size used when the number of elements per buffer is not given
+    static const ulib__SizeType defaultBufferSize = 64u * ULIB_KILOBYTE;
+
+    class iterator{
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T                         value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef T*                        pointer;
+        typedef T&                        reference;
+
+        iterator() : buff_(ULIB_NULL), index_(0){}
+        iterator(buffer* buff, ulib__SizeType index)
+            : buff_(buff), index_(index){}
+
+        T& operator*() const { return *reinterpret_cast<T*>(&buff_->data[index_]); }
+        T* operator->() const { return reinterpret_cast<T*>(&buff_->data[index_]); }
+        iterator& operator++(){
+            if (index_ != 0){
+                index_ -= sizeof(T);
+            }
+            else{
+                *this = Top(buff_->previousBuffer);
+            }
+            return (*this);
+        }
+        iterator operator++(int){
+            iterator old = *this;
+            ++(*this);
+            return (old);
+        }
+        bool operator==(const iterator& other) const {
+            return (buff_ == other.buff_ && index_ == other.index_);
+        }
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+        // Iterator to the top element stored in buff or older buffers
+        static iterator Top(buffer* buff){
+            while (buff && buff->lastIndex == 0){
+                buff = buff->previousBuffer;
+            }
+            if (buff){
+                return (iterator(buff, buff->lastIndex - sizeof(T)));
+            }
+            return (iterator());
+        }
+    private:
+        buffer*        buff_;
+        ulib__SizeType index_;
+    };
+
+    // With an arena the buffers are allocated from it, see ulib_arena.h
+    explicit Vector(ulib__SizeType elementsPerBuffer =
+                    defaultBufferSize / sizeof(T) ? defaultBufferSize / sizeof(T) : 1u,
+                    ulib_arena* arena = ULIB_NULL){
+        static_assert(alignof(T) <= 16u, "ulib::Vector buffers are 16 byte aligned");
+        INIT_ULIB_VECTOR_FIXED_ARENA(vec_, elementsPerBuffer * sizeof(T), sizeof(T), arena);
+    }
+
+    Vector(Vector&& other) : vec_(other.vec_){
+        Detach(other);
+    }
+
+    Vector& operator=(Vector&& other){
+        if (this != &other){
+            Release();
+            vec_ = other.vec_;
+            Detach(other);
+        }
+        return (*this);
+    }
+
+    ~Vector(){
+        Release();
+    }
+
+    /**************************************************************************
+    * Constructs an element on top of the vector from args
+    * Return: pointer to the new element
+    *         ULIB_NULL if the allocation of a new buffer failed
+    **************************************************************************/
+    template <typename... Args>
+    T* emplace(Args&&... args){
+        T* element;
+        if (!Reserve()){
+            return (ULIB_NULL);
+        }
+        // Construct first, so a throwing constructor leaves the vector as is
+        element = ::new (&vec_.workBuffer->data[vec_.workBuffer->lastIndex])
+                        T(std::forward<Args>(args)...);
+        vec_.workBuffer->lastIndex += sizeof(T);
+        return (element);
+    }
+
+    ulib__bool push(const T& value){
+        return (emplace(value) ? ULIB_SUCCESS : ULIB_ERROR);
+    }
+
+    ulib__bool push(T&& value){
+        return (emplace(std::move(value)) ? ULIB_SUCCESS : ULIB_ERROR);
+    }
+
+    /**************************************************************************
+    * Moves the top element into output and destroys it in the vector
+    * Return: ULIB_SUCCESS if successful
+    *         ULIB_ERROR if the vector is empty
+    **************************************************************************/
+    ulib__bool pop(T& output){
+        T* element = peek();
+        if (element == ULIB_NULL){
+            return (ULIB_ERROR);
+        }
+        output = std::move(*element);
+        element->~T();
+        Drop();
+        return (ULIB_SUCCESS);
+    }
+
+    // Destroys the top element, ULIB_ERROR if the vector is empty
+    ulib__bool pop(){
+        T* element = peek();
+        if (element == ULIB_NULL){
+            return (ULIB_ERROR);
+        }
+        element->~T();
+        Drop();
+        return (ULIB_SUCCESS);
+    }
+
+    // Top element, ULIB_NULL if the vector is empty
+    T* peek(){
+        buffer* buff = vec_.workBuffer;
+        if (buff && buff->lastIndex){
+            return (reinterpret_cast<T*>(&buff->data[buff->lastIndex - sizeof(T)]));
+        }
+        return (buff ? static_cast<T*>(UlibVectorPeek(&vec_, ULIB_NULL)) : ULIB_NULL);
+    }
+
+    bool empty(){
+        return (peek() == ULIB_NULL);
+    }
+
+    // Number of elements, O(1)
+    ulib__SizeType size(){
+        return (UlibVectorCount(&vec_));
+    }
+
+    // Element at index in push order, 0 is the first pushed, O(1)
+    T& operator[](ulib__SizeType index){
+        return (*static_cast<T*>(UlibVectorAt(&vec_, index)));
+    }
+
+    // Destroys all elements, keeps the first buffer
+    void clear(){
+        while (pop() == ULIB_SUCCESS);
+    }
+
+    iterator begin(){
+        return (iterator::Top(vec_.workBuffer));
+    }
+
+    iterator end(){
+        return (iterator());
+    }
+
+    // The underlying C vector, for statistics and cache settings
+    ulib_vector* vector(){
+        return (&vec_);
+    }
+
+private:
+    Vector(const Vector&);
+    Vector& operator=(const Vector&);
+
+    // Makes sure the work buffer has room for one element
+    bool Reserve(){
+        buffer* buff = vec_.workBuffer;
+        if (buff && buff->lastIndex + sizeof(T) <= vec_.bufferSize){
+            return (true);
+        }
+        // New buffer from the C side, the slot it reserves is given back
+        if (UlibVectorEmplace(&vec_, 1u) == ULIB_NULL){
+            return (false);
+        }
+        vec_.workBuffer->lastIndex -= sizeof(T);
+        return (true);
+    }
+
+    // Removes the top slot, the element is already destroyed
+    void Drop(){
+        if (vec_.workBuffer->lastIndex){
+            vec_.workBuffer->lastIndex -= sizeof(T);
+        }
+        else{
+            UlibVectorPop(&vec_, ULIB_NULL);
+        }
+    }
+
+    // Leaves other without buffers after its buffers were taken
+    static void Detach(Vector& other){
+        other.vec_.workBuffer = ULIB_NULL;
+        other.vec_.freeBuffers = ULIB_NULL;
+        other.vec_.freeBuffersCount = 0u;
+        other.vec_.bufferTable = ULIB_NULL;
+        other.vec_.bufferCount = 0u;
+        other.vec_.bufferTableSize = 0u;
+        other.vec_.spill = ULIB_NULL;
+    }
+
+    void Release(){
+        if (vec_.workBuffer){
+            clear();
+            UlibVectorFree(&vec_);
+        }
+        UlibVectorSetMaxFreeBuffers(&vec_, 0u);
+        ULIB_FREE(vec_.bufferTable);
+    }
+
+    ulib_vector vec_;
+};
+
+} // namespace ulib
+#endif // _ulib_vector_hpp_
@@ -0,0 +1,316 @@
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  Visited set of files and directories
+*  Holds (device, file id) keys: the device and inode on Linux, the volume
+*  serial number and file index on Windows. ListDirData.visited uses it to
+*  open a directory once when bind mounts or junctions show it again, and
+*  to list a hard linked file once.
+*  Example:
+*   ulib_visited visited;
+*   UlibVisitedInit(&visited, 0);
+*   ulib__bool seen;
+*   if (UlibVisitedInsert(&visited, device, fileId, &seen) == ULIB_SUCCESS && !seen)
+*       Process(...);
+*   UlibVisitedFree(&visited);
+* NOTES:
+*   1. Open addressing with linear probing. A slot takes 12 bytes and the
+*      tables are kept between 3/8 and 3/4 full, 16 to 32 bytes per key.
+*   2. The keys are spread over ULIB_VISITED_SHARDS tables with a lock
+*      each, threads inserting at the same time seldom wait for each other.
+*   3. In case of an error, the error code is stored in ulibError global variable
+***********************************************************************************/
+#ifndef _ulib_visited_h_
+#define _ulib_visited_h_
+
+#include "ulib_common.h"
+#include "ulib_thread.h"
+
+#ifdef __cplusplus
+namespace ulib{
+#endif
+
+#define ULIB_VISITED_SHARDS 16u
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+    // Keys whose hash starts with the same bits. A slot is free when the
+    // id and the device are both 0, the key (0, 0) is kept in hasZero.
+    typedef struct ulib_visited_shard_ {
+        ulib_mutex          lock;
+        ulib__uint64*       ids;
+        ulib__uint32*       devices;
+        ulib__SizeType      size;        // Slots, a power of 2
+        ulib__SizeType      count;
+        ulib__bool          hasZero;
+    }ulib_visited_shard;
+
+    typedef struct ulib_visited_ {
+        ulib_visited_shard  shards[ULIB_VISITED_SHARDS];
+    }ulib_visited;
+
+/******************************************************************************
+* Function:
+*          ulib__bool UlibVisitedInit(OUT ulib_visited* set,
+*                                     IN const ulib__SizeType expected);
+* Makes an empty set with room for expected keys before it grows, 0 for
+* a small set
+* Return: ULIB_SUCCESS if successful
+*         ULIB_ERROR if the memory could not be allocated
+******************************************************************************/
+    ulib__bool UlibVisitedInit(OUT ulib_visited* set,
+                               IN const ulib__SizeType expected);
+
+/******************************************************************************
+* Function:
+*          ulib__bool UlibVisitedInsert(IN ulib_visited* set,
+*                                       IN const ulib__uint32 device,
+*                                       IN const ulib__uint64 id,
+*                                       OUT ulib__bool* seen);
+* Adds the key, seen is ULIB_TRUE if it was already in the set. Can be
+* called by several threads at once.
+* Return: ULIB_SUCCESS if successful
+*         ULIB_ERROR if the set could not grow, the key is not added
+******************************************************************************/
+    ulib__bool UlibVisitedInsert(IN ulib_visited* set,
+                                 IN const ulib__uint32 device,
+                                 IN const ulib__uint64 id,
+                                 OUT ulib__bool* seen);
+
+/******************************************************************************
+* Function:
+*          ulib__bool UlibVisitedContains(IN ulib_visited* set,
+*                                         IN const ulib__uint32 device,
+*                                         IN const ulib__uint64 id);
+* Return: ULIB_TRUE if the key is in the set
+******************************************************************************/
+    ulib__bool UlibVisitedContains(IN ulib_visited* set,
+                                   IN const ulib__uint32 device,
+                                   IN const ulib__uint64 id);
+
+/******************************************************************************
+* Function:
+*          ulib__SizeType UlibVisitedCount(IN ulib_visited* set);
+*          ulib__SizeType UlibVisitedBytes(IN ulib_visited* set);
+* Keys in the set / bytes allocated for them
+******************************************************************************/
+    ulib__SizeType UlibVisitedCount(IN ulib_visited* set);
+    ulib__SizeType UlibVisitedBytes(IN ulib_visited* set);
+
+/******************************************************************************
+* Function:
+*          void UlibVisitedClear(IN ulib_visited* set);
+*          void UlibVisitedFree(IN ulib_visited* set);
+* Clear removes the keys and keeps the memory for the next walk
+******************************************************************************/
+    void UlibVisitedClear(IN ulib_visited* set);
+    void UlibVisitedFree(IN ulib_visited* set);
+#ifdef __cplusplus
+} // extern "C" {
+#endif
+
+/* ========================================================================= */
+#ifdef IMPLEMENTATION
+// The key bits mixed, so ids that follow each other spread over the shards
+static ulib__uint64 VisitedHash(const ulib__uint32 device, const ulib__uint64 id){
+    ulib__uint64 x = id ^ ((ulib__uint64)device * 0x9E3779B97F4A7C15ull);
+    x ^= x >> 30u;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27u;
+    x *= 0x94D049BB133111EBull;
+    return (x ^ (x >> 31u));
+}
+
+static ulib__bool ShardAllocate(ulib_visited_shard* shard, const ulib__SizeType size){
+    shard->ids = (ulib__uint64*)calloc(size, sizeof(ulib__uint64));
+    shard->devices = (ulib__uint32*)calloc(size, sizeof(ulib__uint32));
+    if (shard->ids == ULIB_NULL || shard->devices == ULIB_NULL){
+        ULIB_FREE(shard->ids);
+        ULIB_FREE(shard->devices);
+        ulibError = ULIB_MALLOC_ERROR;
+        return (ULIB_ERROR);
+    }
+    shard->size = size;
+    return (ULIB_SUCCESS);
+}
+
+// Slot of the key, or the free slot where it goes
+static ulib__SizeType ShardFind(const ulib_visited_shard* shard,
+                                const ulib__uint64 hash,
+                                const ulib__uint32 device,
+                                const ulib__uint64 id){
+    ulib__SizeType mask = shard->size - 1u;
+    ulib__SizeType i = (ulib__SizeType)hash & mask;
+    while ((shard->ids[i] | shard->devices[i]) != 0 &&
+           (shard->ids[i] != id || shard->devices[i] != device)){
+        i = (i + 1u) & mask;
+    }
+    return (i);
+}
+
+// Doubles the slots, the keys are put again in the new tables
+static ulib__bool ShardGrow(ulib_visited_shard* shard){
+    ulib_visited_shard bigger;
+    ulib__SizeType i;
+    ulib__SizeType slot;
+    if (ShardAllocate(&bigger, shard->size << 1u)){
+        return (ULIB_ERROR);
+    }
+    for (i = 0; i < shard->size; ++i){
+        if ((shard->ids[i] | shard->devices[i]) != 0){
+            slot = ShardFind(&bigger, VisitedHash(shard->devices[i], shard->ids[i]),
+                             shard->devices[i], shard->ids[i]);
+            bigger.ids[slot] = shard->ids[i];
+            bigger.devices[slot] = shard->devices[i];
+        }
+    }
+    free(shard->ids);
+    free(shard->devices);
+    shard->ids = bigger.ids;
+    shard->devices = bigger.devices;
+    shard->size = bigger.size;
+    return (ULIB_SUCCESS);
+}
+
+ulib__bool UlibVisitedInit(ulib_visited* set, const ulib__SizeType expected){
+    ulib__SizeType size = 64u;
+    ulib__uint32 i;
+    // 3/4 full at most
+    while (size * 3u / 4u * ULIB_VISITED_SHARDS < expected){
+        size <<= 1u;
+    }
+    memset(set, 0, sizeof(*set));
+    for (i = 0; i < ULIB_VISITED_SHARDS; ++i){
+        if (ShardAllocate(&set->shards[i], size)){
+            UlibVisitedFree(set);
+            return (ULIB_ERROR);
+        }
+        UlibMutexInit(&set->shards[i].lock);
+    }
+    return (ULIB_SUCCESS);
+}
+
+ulib__bool UlibVisitedInsert(ulib_visited* set,
+                             const ulib__uint32 device,
+                             const ulib__uint64 id,
+                             ulib__bool* seen){
+    ulib__uint64 hash = VisitedHash(device, id);
+    ulib_visited_shard* shard = &set->shards[hash >> 60u];
+    ulib__SizeType slot;
+    ulib__bool result = ULIB_SUCCESS;
+    UlibMutexLock(&shard->lock);
+    if ((id | device) == 0){
+        *seen = shard->hasZero;
+        shard->hasZero = ULIB_TRUE;
+    }
+    else{
+        slot = ShardFind(shard, hash, device, id);
+        *seen = (shard->ids[slot] | shard->devices[slot]) != 0 ? ULIB_TRUE : ULIB_FALSE;
+        if (*seen == ULIB_FALSE && (shard->count + 1u) * 4u > shard->size * 3u){
+            if (ShardGrow(shard)){
+                result = ULIB_ERROR;
+            }
+            else{
+                slot = ShardFind(shard, hash, device, id);
+            }
+        }
+        if (*seen == ULIB_FALSE && result == ULIB_SUCCESS){
+            shard->ids[slot] = id;
+            shard->devices[slot] = device;
+            ++shard->count;
+        }
+    }
+    UlibMutexUnlock(&shard->lock);
+    return (result);
+}
+
+ulib__bool UlibVisitedContains(ulib_visited* set,
+                               const ulib__uint32 device,
+                               const ulib__uint64 id){
+    ulib__uint64 hash = VisitedHash(device, id);
+    ulib_visited_shard* shard = &set->shards[hash >> 60u];
+    ulib__SizeType slot;
+    ulib__bool found;
+    UlibMutexLock(&shard->lock);
+    if ((id | device) == 0){
+        found = shard->hasZero;
+    }
+    else{
+        slot = ShardFind(shard, hash, device, id);
+        found = (shard->ids[slot] | shard->devices[slot]) != 0 ? ULIB_TRUE : ULIB_FALSE;
+    }
+    UlibMutexUnlock(&shard->lock);
+    return (found);
+}
+
+ulib__SizeType UlibVisitedCount(ulib_visited* set){
+    ulib__SizeType count = 0;
+    ulib__uint32 i;
+    for (i = 0; i < ULIB_VISITED_SHARDS; ++i){
+        UlibMutexLock(&set->shards[i].lock);
+        count += set->shards[i].count + (set->shards[i].hasZero ? 1u : 0u);
+        UlibMutexUnlock(&set->shards[i].lock);
+    }
+    return (count);
+}
+
+ulib__SizeType UlibVisitedBytes(ulib_visited* set){
+    ulib__SizeType bytes = 0;
+    ulib__uint32 i;
+    for (i = 0; i < ULIB_VISITED_SHARDS; ++i){
+        UlibMutexLock(&set->shards[i].lock);
+        bytes += set->shards[i].size * (sizeof(ulib__uint64) + sizeof(ulib__uint32));
+        UlibMutexUnlock(&set->shards[i].lock);
+    }
+    return (bytes);
+}
+
+void UlibVisitedClear(ulib_visited* set){
+    ulib__uint32 i;
+    for (i = 0; i < ULIB_VISITED_SHARDS; ++i){
+        ulib_visited_shard* shard = &set->shards[i];
+        UlibMutexLock(&shard->lock);
+        memset(shard->ids, 0, shard->size * sizeof(ulib__uint64));
+        memset(shard->devices, 0, shard->size * sizeof(ulib__uint32));
+        shard->count = 0;
+        shard->hasZero = ULIB_FALSE;
+        UlibMutexUnlock(&shard->lock);
+    }
+}
+
+void UlibVisitedFree(ulib_visited* set){
+    ulib__uint32 i;
+    for (i = 0; i < ULIB_VISITED_SHARDS; ++i){
+        ulib_visited_shard* shard = &set->shards[i];
+        if (shard->ids){
+            UlibMutexDestroy(&shard->lock);
+        }
+        ULIB_FREE(shard->ids);
+        ULIB_FREE(shard->devices);
+        shard->size = 0;
+        shard->count = 0;
+    }
+}
+#endif // #ifdef IMPLEMENTATION
+#ifdef __cplusplus // namespace ulib{
+}
+#endif
+#endif // #ifndef _ulib_visited_h_
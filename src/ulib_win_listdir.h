@@ -1,189 +1,305 @@
-/*
-
-Copyright (c) 2018-2021, Croitor Cristian
-
-THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
-AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
-ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
-LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
-CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
-SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
-INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
-CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
-ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
-POSSIBILITY OF SUCH DAMAGE.
-
-For licensing, please check the LICENSE file included with the source code.
-*/
-
-#ifndef _ulib_win_listdir_h_
-#define _ulib_win_listdir_h_
-
-#include "ulib_common.h"
-//#define ULIB_VECTOR_DEBUG
-#include "ulib_vector.h"
-#ifdef __cplusplus
-namespace ulib {
-#endif
-
-#define INIT_LISTDIRDATA(listDirData)\
-    listDirData.processFile = ULIB_NULL;\
-    listDirData.processDirectory = ULIB_NULL;\
-    listDirData.totalFiles = 0;\
-    listDirData.totalDirs = 0;\
-    listDirData.dir = ULIB_NULL;\
-    listDirData.recurse = ULIB_FALSE;\
-    listDirData.shouldExit = ULIB_NULL;
-
-
-#define ULIB_MAX_WINDOWS_PATH 32768u * sizeof(_TCHAR)
-//
-// The callback for dirs and files.
-// fullPath is the file name with full path
-// fileName is only the file name
-//
-typedef void (*ProcessFileName)(_TCHAR* fullPath, _TCHAR* fileName);
-
-typedef struct ListDirData_
-{
-OUT   ulib__uint64            totalFiles;       /* Total number of files */
-OUT   ulib__uint64            totalDirs;        /* Total number of dirs */
-IN    ProcessFileName         processFile;      /* File callback */
-IN    ProcessFileName         processDirectory; /* Directory callback */
-IN    _TCHAR*                 dir;              /* Start dir */
-IN    volatile ulib__bool*    shouldExit;       /* This is a volatile byte set by CTRL-C handler */
-IN    ulib__bool              recurse;          /* Scan folders recursively */
-}ListDirData;
-
-/* Public functions */
-/******************************************************************************
-* Function: ulib__bool ListDir(ListDirData* dir)
-* Parameters:
-*      Input:  ListDirData* dir
-*              The structure can contain two function pointers to be called for
-*              files and directories, and the start directory
-*      Return: ULIB_SUCCESS if successful
-*              ULIB_FILE_NOT_FOUND in case of an error - the start directory
-*              is not found
-* NOTE: In case of an error, UlibGetSystemLastErrorString() can be used to get the
-* error formatted as string, or uint32_t dw = GetLastError() can be used to get
-* the error code.
-******************************************************************************/
-#ifdef __cplusplus
-extern "C" {
-#endif
-#pragma pack(1)
-    typedef struct _item
-    {
-        HANDLE handle;
-        _TCHAR parentPth[ULIB_MAX_WINDOWS_PATH];
-    }item;
-#pragma pack ()
-
-ulib__uint8 ListDir(ListDirData* dir);
-#ifdef __cplusplus
-}
-#endif
-
-/* ========================================================================= */
-#ifdef IMPLEMENTATION
-static item            it;
-static WIN32_FIND_DATA file;
-static ulib__SizeType  dirLength = 0;
-static ulib_vector     vector;
-static _TCHAR          searchPth[ULIB_MAX_WINDOWS_PATH];
-ulib__uint8 ListDir(ListDirData* listDirData){
-    it.handle = ULIB_NULL;
-    memset(it.parentPth, 0, ULIB_MAX_WINDOWS_PATH);
-    memset(searchPth, 0, ULIB_MAX_WINDOWS_PATH);
-    INIT_ULIB_VECTOR(vector, ULIB_MAX_WINDOWS_PATH << 8u, sizeof(_TCHAR));
-    dirLength = _tcslen(listDirData->dir);
-    _tcscpy(it.parentPth, listDirData->dir);
-    if ((it.parentPth[dirLength - 1] == _T("\\")[0]) ||
-        (it.parentPth[dirLength - 1] == _T("/")[0])){
-        it.parentPth[dirLength - 1] = _T('\0');
-    }
-    _tcscpy(searchPth, it.parentPth);
-    _tcscat(searchPth, TEXT("\\*"));
-    it.handle = FindFirstFile(searchPth, &file);
-    if (it.handle == INVALID_HANDLE_VALUE){
-        if (vector.workBuffer){
-            UlibVectorFree(&vector);
-        }
-        return (ULIB_FILE_NOT_FOUND);
-    }
-    for (;;){
-        for (;;){
-            if (listDirData->shouldExit && (*(listDirData->shouldExit))){
-                break;
-            }
-            if (it.handle  == INVALID_HANDLE_VALUE){
-                break;
-            }
-            if (_tcscmp(file.cFileName, TEXT(".")) != 0 &&
-                                      _tcscmp(file.cFileName, TEXT("..")) != 0){
-                if (file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY){// dir
-                    ++listDirData->totalDirs;
-                    _tcscpy(searchPth, it.parentPth);
-                    _tcscat(searchPth, TEXT("\\"));
-                    _tcscat(searchPth, file.cFileName);
-                    if (listDirData->processDirectory != ULIB_NULL){
-                        listDirData->processDirectory(searchPth, file.cFileName);
-                    }
-                    if (listDirData->recurse == ULIB_TRUE){
-                        if (UlibVectorPush(&vector, &it, sizeof(HANDLE) +
-                            _tcslen(it.parentPth)) != ULIB_SUCCESS){
-                            return (ULIB_ERROR);
-                        }
-                        _tcscpy(it.parentPth, searchPth);
-                        _tcscat(searchPth, TEXT("\\*"));// prepare for next run
-                        it.handle = FindFirstFile(searchPth, &file);
-                    }
-                    else if ((FindNextFile(it.handle, &file) == 0))
-                            break;
-                }
-                else{ // if (file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-                    ++listDirData->totalFiles;
-                    if (listDirData->processFile != ULIB_NULL){
-                        _tcscpy(searchPth, it.parentPth);
-                        _tcscat(searchPth, TEXT("\\"));
-                        _tcscat(searchPth, file.cFileName);
-                        listDirData->processFile(searchPth, file.cFileName);
-                    }
-                    if ((FindNextFile(it.handle, &file) == 0))
-                            break;
-                }
-            }// if (_tcscmp(file.cFileName, TEXT(".")) != 0 &&
-            else                // _tcscmp(file.cFileName, TEXT("..")) != 0)
-                if ((FindNextFile(it.handle, &file) == 0))
-                    break;
-        }// for (;;) - inner for
-    retry:
-        memset(it.parentPth, 0, ULIB_MAX_WINDOWS_PATH);
-        if(UlibVectorPop(&vector, &it) == ULIB_SUCCESS){
-            if (FindNextFile(it.handle, &file) == 0)
-                goto retry;
-        }
-        else
-            break;
-    }//for(;;) - main loop
-    if (vector.workBuffer){
-        UlibVectorFree(&vector);
-    }
-    if (it.handle){
-        FindClose(it.handle);
-    }
-#ifdef ULIB_VECTOR_DEBUG
-    _tprintf(_T("\nAllocations: %d\n"), vector.ulibVectorAllocations);
-    _tprintf(_T("Free:        %d\n"), vector.ulibVectorFree);
-    _tprintf(_T("Total mem:   %zd\n"), vector.ulibVectorAllocations *
-                                      vector.bufferSize);
-#endif
-    return (ULIB_SUCCESS);
-}
-#endif
-#ifdef __cplusplus
-} /* namespace ulib{ */
-#endif
-#endif // #ifndef _ulib_win_listdir_h_
+/*
+
+Copyright (c) 2018-2021, Croitor Cristian
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+For licensing, please check the LICENSE file included with the source code.
+*/
+
+/***********************************************************************************
+*  Windows backend of ListDir, see ulib_listdir.h
+*  Directories are read with FindFirstFile / FindNextFile, by full path.
+* NOTES:
+*   1. Include ulib_listdir.h, this file only holds the backend.
+*   2. Junctions and directory symbolic links are listed as directories and
+*      walked into, ListDirData.visited keeps them from looping.
+***********************************************************************************/
+#ifndef _ulib_listdir_h_
+// Included directly, ulib_listdir.h includes this file back
+#include "ulib_listdir.h"
+#elif !defined(_ulib_win_listdir_h_)
+#define _ulib_win_listdir_h_
+
+#ifdef __cplusplus
+namespace ulib {
+#endif
+
+#define ULIB_DIR_SEPARATOR  _T('\\')
+#define ULIB_IS_DIR_SEPARATOR(c) ((c) == _T('\\') || (c) == _T('/'))
+#define ULIB_DIR_PATH_EXTRA 3u   // Room DirOpen needs after the path: "\\*"
+#define ULIB_NO_DIR_HANDLE  0
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    // Directories are opened by path, the handle is not used
+    typedef int dir_handle;
+
+    // An open directory being read
+    typedef struct dir_reader_
+    {
+        HANDLE         find;
+        ulib__bool     pending;     // The entry from FindFirstFile is not read
+        ulib__bool     error;       // FindNextFile failed, the listing is not complete
+        dir_handle     handle;
+    }dir_reader;
+
+    // Find data shared by the readers of one walk
+    typedef struct dir_buffer_
+    {
+        WIN32_FIND_DATA data;
+        ulib__uint64    systemCalls; // Made by the readers, for benchmarks
+    }dir_buffer;
+
+    // Entry returned by DirNext, valid until the next call.
+    // size and the times are set by DirStat, the key by DirKey.
+    typedef struct dir_entry_
+    {
+        _TCHAR*         name;
+        ulib__SizeType  nameLength;
+        ulib__bool      isDir;
+        ulib__uint8     type;       // ULIB_ENTRY_FILE, ...
+        ulib__uint64    fileId;     // Not returned by FindNextFile, 0
+        ulib__uint64    size;
+        ulib__int64     modifiedTime;
+        ulib__int64     creationTime;
+        ulib__bool      keyed;      // keyDevice, keyId and links are set
+        ulib__uint32    keyDevice;  // Volume serial number
+        ulib__uint64    keyId;      // File index
+        ulib__uint32    links;
+    }dir_entry;
+#ifdef __cplusplus
+}
+#endif
+
+/* ========================================================================= */
+#ifdef IMPLEMENTATION
+static ulib__bool DirBufferInit(dir_buffer* b){
+    b->systemCalls = 0;
+    return (ULIB_SUCCESS);
+}
+
+static void DirBufferFree(dir_buffer* b){
+    ULIB_UNUSED(b);
+}
+
+// What a failed open means for the walk. A directory that is gone or
+// can't be read is skipped, other errors set ulibError and end the walk.
+static ulib__uint8 DirOpenError(void){
+    switch (GetLastError()){
+    case ERROR_ACCESS_DENIED:
+    case ERROR_FILE_NOT_FOUND:
+    case ERROR_PATH_NOT_FOUND:
+    case ERROR_DIRECTORY:
+    case ERROR_INVALID_NAME:
+    case ERROR_CANT_ACCESS_FILE:
+    case ERROR_SHARING_VIOLATION:
+    case ERROR_NOT_READY:
+        return (ULIB_FILE_NOT_FOUND);
+    case ERROR_TOO_MANY_OPEN_FILES:
+        ulibError = ULIB_TOO_MANY_OPEN_FILES;
+        return (ULIB_ERROR);
+    default:
+        ulibError = ULIB_ERROR;
+        return (ULIB_ERROR);
+    }
+}
+
+// Opens the directory at path. path has pathLength chars, and room for
+// ULIB_DIR_PATH_EXTRA more. The first entry is read into the buffer.
+// Returns ULIB_FILE_NOT_FOUND for a directory to skip, see DirOpenError().
+static ulib__uint8 DirOpen(dir_reader* r,
+                          dir_buffer* b,
+                          const dir_handle parent,
+                          const _TCHAR* name,
+                          _TCHAR* path,
+                          const ulib__SizeType pathLength){
+    ULIB_UNUSED(parent);
+    ULIB_UNUSED(name);
+    path[pathLength] = _T('\\');
+    path[pathLength + 1u] = _T('*');
+    path[pathLength + 2u] = _T('\0');
+    r->find = FindFirstFile(path, &b->data);
+    path[pathLength] = _T('\0');
+    r->pending = ULIB_TRUE;
+    r->error = ULIB_FALSE;
+    r->handle = ULIB_NO_DIR_HANDLE;
+    if (r->find == INVALID_HANDLE_VALUE){
+        ++b->systemCalls;
+        return (DirOpenError());
+    }
+    // The FindClose is counted with the open
+    b->systemCalls += 2u;
+    return (ULIB_SUCCESS);
+}
+
+// Next entry of the directory, ULIB_FALSE when there are no more or when
+// the read failed, then r->error is set
+static ulib__bool DirNext(dir_reader* r, dir_buffer* b, dir_entry* entry){
+    _TCHAR* name = b->data.cFileName;
+    for (;;){
+        if (r->pending){
+            r->pending = ULIB_FALSE;
+        }
+        else{
+            ++b->systemCalls;
+            if (FindNextFile(r->find, &b->data) == 0){
+                if (GetLastError() != ERROR_NO_MORE_FILES){
+                    r->error = ULIB_TRUE;
+                    ulibError = ULIB_ERROR;
+                }
+                return (ULIB_FALSE);
+            }
+        }
+        if (name[0] == _T('.') && (name[1] == _T('\0') ||
+            (name[1] == _T('.') && name[2] == _T('\0')))){
+            continue;
+        }
+        entry->name = name;
+        entry->nameLength = _tcslen(name);
+        entry->isDir = (b->data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ?
+                       ULIB_TRUE : ULIB_FALSE;
+        if (entry->isDir){
+            entry->type = ULIB_ENTRY_DIR;
+        }
+        else{
+            entry->type = (b->data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ?
+                          ULIB_ENTRY_LINK : ULIB_ENTRY_FILE;
+        }
+        entry->fileId = 0;
+        entry->keyed = ULIB_FALSE;
+        return (ULIB_TRUE);
+    }
+}
+
+// FILETIME (100 ns since 1601) to ns since 1970
+static ulib__int64 FileTimeToNs(const FILETIME* t){
+    ulib__int64 ticks = ((ulib__int64)t->dwHighDateTime << 32) | t->dwLowDateTime;
+    return ((ticks - 116444736000000000LL) * 100);
+}
+
+// The metadata came with the find data, no system call is made
+static void DirStat(dir_reader* r, dir_buffer* b, dir_entry* entry){
+    ULIB_UNUSED(r);
+    entry->size = ((ulib__uint64)b->data.nFileSizeHigh << 32) | b->data.nFileSizeLow;
+    entry->modifiedTime = FileTimeToNs(&b->data.ftLastWriteTime);
+    entry->creationTime = FileTimeToNs(&b->data.ftCreationTime);
+}
+
+// The find handle keeps its position, nothing to save
+static ulib__bool DirSuspend(dir_reader* r, dir_buffer* b){
+    ULIB_UNUSED(r);
+    ULIB_UNUSED(b);
+    return (ULIB_SUCCESS);
+}
+
+static void DirResume(dir_reader* r, dir_buffer* b){
+    ULIB_UNUSED(r);
+    ULIB_UNUSED(b);
+}
+
+// Type, size and times of the file at path, the file id is 0
+static ULIB_INLINE ulib__bool PathStat(const _TCHAR* path, dir_entry* entry){
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (GetFileAttributesEx(path, GetFileExInfoStandard, &info) == 0){
+        return (ULIB_ERROR);
+    }
+    entry->isDir = (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ?
+                   ULIB_TRUE : ULIB_FALSE;
+    if (entry->isDir){
+        entry->type = ULIB_ENTRY_DIR;
+    }
+    else{
+        entry->type = (info.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ?
+                      ULIB_ENTRY_LINK : ULIB_ENTRY_FILE;
+    }
+    entry->fileId = 0;
+    entry->keyed = ULIB_FALSE;
+    entry->size = ((ulib__uint64)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    entry->modifiedTime = FileTimeToNs(&info.ftLastWriteTime);
+    entry->creationTime = FileTimeToNs(&info.ftCreationTime);
+    return (ULIB_SUCCESS);
+}
+
+// Volume, file index and link count of the file at path. A directory is
+// followed if it is a junction, so the key is the one of its target.
+static ULIB_INLINE ulib__bool PathKeyOpen(const _TCHAR* path,
+                                          const ulib__bool follow,
+                                          dir_entry* entry){
+    BY_HANDLE_FILE_INFORMATION info;
+    HANDLE file;
+    BOOL result;
+    file = CreateFile(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                      ULIB_NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS |
+                      (follow ? 0 : FILE_FLAG_OPEN_REPARSE_POINT), ULIB_NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        return (ULIB_ERROR);
+    }
+    result = GetFileInformationByHandle(file, &info);
+    CloseHandle(file);
+    if (result == 0){
+        return (ULIB_ERROR);
+    }
+    entry->keyDevice = info.dwVolumeSerialNumber;
+    entry->keyId = ((ulib__uint64)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    entry->links = info.nNumberOfLinks;
+    entry->keyed = ULIB_TRUE;
+    return (ULIB_SUCCESS);
+}
+
+// The find data has no file index, the entry is opened by its full path
+static ULIB_INLINE ulib__bool DirKey(dir_reader* r,
+                                     dir_buffer* b,
+                                     dir_entry* entry,
+                                     const _TCHAR* path){
+    ULIB_UNUSED(r);
+    if (entry->keyed){
+        return (ULIB_SUCCESS);
+    }
+    // CreateFile, GetFileInformationByHandle and CloseHandle
+    b->systemCalls += 3u;
+    return (PathKeyOpen(path, entry->isDir, entry));
+}
+
+// DirKey() of the directory at path
+static ULIB_INLINE ulib__bool PathKey(const _TCHAR* path, dir_entry* entry){
+    return (PathKeyOpen(path, ULIB_TRUE, entry));
+}
+
+// A find handle can't be opened again where it stopped, it is kept
+static ulib__bool DirRelease(dir_reader* r, dir_buffer* b){
+    ULIB_UNUSED(r);
+    ULIB_UNUSED(b);
+    return (ULIB_ERROR);
+}
+
+static ulib__uint8 DirReopen(dir_reader* r, dir_buffer* b, const _TCHAR* path){
+    ULIB_UNUSED(r);
+    ULIB_UNUSED(b);
+    ULIB_UNUSED(path);
+    return (ULIB_ERROR);
+}
+
+static void DirClose(dir_reader* r){
+    FindClose(r->find);
+}
+
+static void DirHandleClose(const dir_handle handle){
+    ULIB_UNUSED(handle);
+}
+#endif
+#ifdef __cplusplus
+} /* namespace ulib{ */
+#endif
+#endif // #ifndef _ulib_win_listdir_h_